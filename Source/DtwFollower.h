@@ -0,0 +1,206 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+
+// Online DTW score follower over reference clusters (after Dixon 2005 / Dannenberg).
+// Each user note-on adds one row to the cost matrix, computed only inside a fixed band
+// of kBandWidth clusters that recentres on the cheapest cell. A note either advances
+// diagonally (optionally skipping clusters at a cost) or stays on the same cluster. The
+// cheapest cell of a row can still fall behind the previous one as costs settle, so the
+// reported position is held at its furthest point and never moves back. Per-note cost
+// and memory are independent of the length of the piece; safe on the audio thread.
+//
+// Reference must expose clusters[i].startIndex / noteCount and notes[j].noteNumber / channel.
+template <typename Reference>
+class DtwFollower
+{
+public:
+    static constexpr int kBandWidth = 48;
+    static constexpr int kBandBack = 8;
+    // The position only moves forward; going back is left to relocalisation.
+    static constexpr bool kJumpsBack = false;
+
+    struct Result
+    {
+        int clusterIndex = -1;
+        int noteIndex = -1;
+    };
+
+    DtwFollower() noexcept
+    {
+        reset (0);
+    }
+
+    void reset (int startCluster) noexcept
+    {
+        startPosition = std::max (0, startCluster);
+        position = startPosition;
+        bandStart = std::max (0, startPosition - kBandBack);
+        primed = false;
+        previous.fill (kUnreachable);
+    }
+
+    int getPosition() const noexcept
+    {
+        return position;
+    }
+
+    Result observe (const Reference& reference,
+                    const uint8_t* matched,
+                    int noteNumber,
+                    int channel,
+                    int pitchTolerance) noexcept
+    {
+        Result result;
+        const int totalClusters = static_cast<int> (reference.clusters.size());
+        if (totalClusters <= 0 || startPosition >= totalClusters)
+            return result;
+
+        const int tolerance = std::max (0, pitchTolerance);
+        float bestCost = kUnreachable;
+        int bestSlot = -1;
+        int bestNote = -1;
+        // Cheapest way to arrive just before this slot: a diagonal step, possibly skipping clusters.
+        float arrival = kUnreachable;
+
+        for (int slot = 0; slot < kBandWidth; ++slot)
+        {
+            const int cluster = bandStart + slot;
+            if (cluster >= totalClusters)
+            {
+                current[static_cast<size_t> (slot)] = kUnreachable;
+                continue;
+            }
+
+            const int noteIndex = findNote (reference, matched, cluster, noteNumber, channel, tolerance);
+            float localCost = kMismatchCost;
+            if (noteIndex >= 0)
+                localCost = (matched != nullptr && matched[noteIndex] != 0) ? kRepeatCost : 0.0f;
+
+            float cost = kUnreachable;
+            if (! primed)
+            {
+                // The first note may start anywhere at or after the start position.
+                if (cluster >= startPosition)
+                    cost = localCost + kSkipCost * static_cast<float> (cluster - startPosition);
+            }
+            else
+            {
+                if (slot > 0)
+                    arrival = std::min (arrival + kSkipCost, previous[static_cast<size_t> (slot - 1)]);
+                cost = localCost + std::min (arrival, previous[static_cast<size_t> (slot)] + kStayCost);
+                cost = std::min (cost, kUnreachable);
+            }
+
+            current[static_cast<size_t> (slot)] = cost;
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestSlot = slot;
+                bestNote = noteIndex;
+            }
+        }
+
+        if (bestSlot < 0)
+            return result;
+
+        // Keep the numbers small; only differences along the row matter.
+        for (int slot = 0; slot < kBandWidth; ++slot)
+        {
+            const float cost = current[static_cast<size_t> (slot)];
+            previous[static_cast<size_t> (slot)] = (cost >= kUnreachable) ? kUnreachable : cost - bestCost;
+        }
+
+        const int bestCluster = bandStart + bestSlot;
+        if (primed && bestCluster < position)
+        {
+            // Behind the reported position: only a note still open at the position itself counts.
+            bestNote = findNote (reference, matched, position, noteNumber, channel, tolerance);
+            if (bestNote >= 0 && matched != nullptr && matched[bestNote] != 0)
+                bestNote = -1;
+        }
+
+        primed = true;
+        position = std::max (position, bestCluster);
+        recentre (totalClusters);
+
+        if (bestNote >= 0)
+        {
+            result.clusterIndex = position;
+            result.noteIndex = bestNote;
+        }
+
+        return result;
+    }
+
+private:
+    static constexpr float kUnreachable = 1.0e9f;
+    static constexpr float kMismatchCost = 1.0f;
+    static constexpr float kRepeatCost = 0.6f;
+    static constexpr float kStayCost = 0.3f;
+    static constexpr float kSkipCost = 0.6f;
+
+    static int findNote (const Reference& reference,
+                         const uint8_t* matched,
+                         int clusterIndex,
+                         int noteNumber,
+                         int channel,
+                         int tolerance) noexcept
+    {
+        const auto& cluster = reference.clusters[static_cast<size_t> (clusterIndex)];
+        const int totalNotes = static_cast<int> (reference.notes.size());
+        const int endIndex = std::min (totalNotes, cluster.startIndex + cluster.noteCount);
+        int bestIndex = -1;
+        int bestScore = 0;
+
+        for (int i = std::max (0, cluster.startIndex); i < endIndex; ++i)
+        {
+            const auto& note = reference.notes[static_cast<size_t> (i)];
+            if (note.channel != channel)
+                continue;
+
+            const int delta = std::abs (note.noteNumber - noteNumber);
+            if (delta > tolerance)
+                continue;
+
+            const int score = (tolerance + 1 - delta) * 2
+                + ((matched == nullptr || matched[i] == 0) ? 1 : 0);
+            if (score > bestScore)
+            {
+                bestScore = score;
+                bestIndex = i;
+            }
+        }
+
+        return bestIndex;
+    }
+
+    void recentre (int totalClusters) noexcept
+    {
+        const int maxStart = std::max (0, totalClusters - kBandWidth);
+        const int newStart = std::clamp (position - kBandBack, 0, maxStart);
+        const int shift = newStart - bandStart;
+        if (shift == 0)
+            return;
+
+        for (int slot = 0; slot < kBandWidth; ++slot)
+        {
+            const int from = slot + shift;
+            current[static_cast<size_t> (slot)] = (from >= 0 && from < kBandWidth)
+                ? previous[static_cast<size_t> (from)]
+                : kUnreachable;
+        }
+
+        previous = current;
+        bandStart = newStart;
+    }
+
+    std::array<float, kBandWidth> previous {};
+    std::array<float, kBandWidth> current {};
+    int bandStart = 0;
+    int startPosition = 0;
+    int position = 0;
+    bool primed = false;
+};
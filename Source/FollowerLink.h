@@ -0,0 +1,98 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Follower position shared by the instances in one process that join the same link group, e.g.
+// one per hand on separate tracks following the same reference. Each group is one atomic word
+// holding the furthest cluster any member has matched a note in, a tag of the reference it
+// belongs to and the host time it was matched at (in kTimeQuantum-sample steps, wrapping).
+// Members publish as they match and read it at block starts; nothing locks or allocates, so
+// both happen on the audio thread. Shared through a juce::SharedResourcePointer.
+class FollowerLink
+{
+public:
+    static constexpr int kNumGroups = 8;
+    static constexpr int kMaxClusters = (1 << 24) - 1;
+    static constexpr int kTimeQuantum = 64;
+
+    struct Position
+    {
+        int cluster = -1;
+        uint8_t referenceTag = 0;
+        uint32_t time = 0;
+    };
+
+    static uint32_t toTime (uint64_t sample) noexcept
+    {
+        return static_cast<uint32_t> (sample / kTimeQuantum);
+    }
+
+    // Samples from time to nowSample, negative when time is later (another member may be a
+    // block ahead, or the host looped back since). Exact to within kTimeQuantum.
+    static int64_t elapsed (uint32_t time, uint64_t nowSample) noexcept
+    {
+        return static_cast<int64_t> (static_cast<int32_t> (toTime (nowSample) - time)) * kTimeQuantum;
+    }
+
+    static bool isRecent (uint32_t time, uint64_t nowSample, uint64_t staleSamples) noexcept
+    {
+        const int64_t delta = elapsed (time, nowSample);
+        return (delta >= 0 ? delta : -delta) <= static_cast<int64_t> (staleSamples);
+    }
+
+    // group is 1-based; 0 means not linked.
+    Position read (int group) const noexcept
+    {
+        if (group <= 0 || group > kNumGroups)
+            return {};
+
+        return unpack (positions[static_cast<size_t> (group - 1)].load (std::memory_order_acquire));
+    }
+
+    // Moves the group's position to cluster if that is further on, or if the current position is
+    // for another reference, older than staleSamples or later than sample (the host looped back).
+    void publish (int group, uint8_t referenceTag, int cluster, uint64_t sample, uint64_t staleSamples) noexcept
+    {
+        if (group <= 0 || group > kNumGroups || cluster < 0 || cluster >= kMaxClusters)
+            return;
+
+        auto& word = positions[static_cast<size_t> (group - 1)];
+        const uint64_t desired = pack ({ cluster, referenceTag, toTime (sample) });
+        uint64_t expected = word.load (std::memory_order_relaxed);
+        for (;;)
+        {
+            const auto current = unpack (expected);
+            const bool replace = current.cluster < 0
+                || current.referenceTag != referenceTag
+                || ! isRecent (current.time, sample, staleSamples)
+                || elapsed (current.time, sample) < 0
+                || cluster > current.cluster;
+            if (! replace)
+                return;
+            if (word.compare_exchange_weak (expected, desired, std::memory_order_release, std::memory_order_relaxed))
+                return;
+        }
+    }
+
+private:
+    // cluster + 1 in the top 24 bits (0 = nothing published), then the tag, then the time.
+    static uint64_t pack (const Position& position) noexcept
+    {
+        return (static_cast<uint64_t> (position.cluster + 1) << 40)
+            | (static_cast<uint64_t> (position.referenceTag) << 32)
+            | position.time;
+    }
+
+    static Position unpack (uint64_t word) noexcept
+    {
+        Position position;
+        position.cluster = static_cast<int> (word >> 40) - 1;
+        position.referenceTag = static_cast<uint8_t> (word >> 32);
+        position.time = static_cast<uint32_t> (word);
+        return position;
+    }
+
+    std::array<std::atomic<uint64_t>, kNumGroups> positions {};
+};
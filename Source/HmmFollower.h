@@ -0,0 +1,217 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+
+// Beam-pruned HMM score follower over reference clusters (after Nakamura et al. 2016).
+// Each user note-on runs one forward step: the state distribution is advanced by a
+// left-to-right transition with skips and short back-jumps, then weighted by how well
+// each cluster explains the pitch. An insertion branch lets ornaments and wrong notes
+// leave the position untouched. Cost per note is O(kBeamWidth * (kMaxSkip + kMaxBack)),
+// all storage is fixed-size, so it is safe on the audio thread.
+//
+// Reference must expose clusters[i].startIndex / noteCount and notes[j].noteNumber / channel.
+template <typename Reference>
+class HmmFollower
+{
+public:
+    static constexpr int kBeamWidth = 64;
+    static constexpr int kBeamBack = 16;
+    static constexpr int kMaxSkip = 4;
+    static constexpr int kMaxBack = 8;
+    // Short back-jumps are part of the model (repeats, restarted phrases).
+    static constexpr bool kJumpsBack = true;
+
+    struct Result
+    {
+        int clusterIndex = -1;
+        int noteIndex = -1;
+    };
+
+    HmmFollower() noexcept
+    {
+        // Relative transition weights, normalised once: stay, advance, skip ahead, jump back.
+        std::array<float, kMaxSkip + kMaxBack + 1> weights {};
+        weights[kMaxBack] = 0.15f;
+        weights[kMaxBack + 1] = 0.6f;
+        float skipWeight = 0.12f;
+        for (int d = 2; d <= kMaxSkip; ++d)
+        {
+            weights[static_cast<size_t> (kMaxBack + d)] = skipWeight;
+            skipWeight *= 0.5f;
+        }
+        for (int d = 1; d <= kMaxBack; ++d)
+            weights[static_cast<size_t> (kMaxBack - d)] = 0.04f / static_cast<float> (kMaxBack);
+
+        float sum = 0.0f;
+        for (auto weight : weights)
+            sum += weight;
+        for (size_t i = 0; i < weights.size(); ++i)
+            transition[i] = weights[i] / sum;
+
+        reset (0);
+    }
+
+    void reset (int startCluster) noexcept
+    {
+        beamStart = std::max (0, startCluster - kBeamBack);
+        alpha.fill (0.0f);
+        alpha[static_cast<size_t> (startCluster - beamStart)] = 1.0f;
+        primed = false;
+        position = startCluster;
+    }
+
+    int getPosition() const noexcept
+    {
+        return position;
+    }
+
+    Result observe (const Reference& reference,
+                    const uint8_t* matched,
+                    int noteNumber,
+                    int channel,
+                    int pitchTolerance) noexcept
+    {
+        Result result;
+        const int totalClusters = static_cast<int> (reference.clusters.size());
+        if (totalClusters <= 0)
+            return result;
+
+        const int tolerance = std::max (0, pitchTolerance);
+        float total = 0.0f;
+        float bestMass = 0.0f;
+        int bestSlot = -1;
+        int bestNote = -1;
+        bool bestIsMove = false;
+
+        for (int slot = 0; slot < kBeamWidth; ++slot)
+        {
+            const int cluster = beamStart + slot;
+            if (cluster >= totalClusters)
+            {
+                next[static_cast<size_t> (slot)] = 0.0f;
+                continue;
+            }
+
+            // The very first note may land on the start cluster itself, not only after it.
+            float predicted = primed ? 0.0f : alpha[static_cast<size_t> (slot)] * transition[kMaxBack + 1];
+            for (int d = -kMaxSkip; d <= kMaxBack; ++d)
+            {
+                const int from = slot + d;
+                if (from < 0 || from >= kBeamWidth)
+                    continue;
+                predicted += alpha[static_cast<size_t> (from)] * transition[static_cast<size_t> (kMaxBack - d)];
+            }
+
+            const int noteIndex = findNote (reference, matched, cluster, noteNumber, channel, tolerance);
+            float emission = kWrongNoteProbability;
+            if (noteIndex >= 0)
+            {
+                const bool alreadyMatched = matched != nullptr && matched[noteIndex] != 0;
+                emission = alreadyMatched ? kRepeatProbability : kHitProbability;
+            }
+
+            const float moveMass = (1.0f - kInsertionProbability) * emission * predicted;
+            const float insertMass = kInsertionProbability * kWrongNoteProbability * alpha[static_cast<size_t> (slot)];
+            const float mass = moveMass + insertMass;
+            next[static_cast<size_t> (slot)] = mass;
+            total += mass;
+
+            if (mass > bestMass)
+            {
+                bestMass = mass;
+                bestSlot = slot;
+                bestNote = noteIndex;
+                bestIsMove = noteIndex >= 0 && moveMass > insertMass;
+            }
+        }
+
+        if (total <= 0.0f || bestSlot < 0)
+            return result;
+
+        for (int slot = 0; slot < kBeamWidth; ++slot)
+            alpha[static_cast<size_t> (slot)] = next[static_cast<size_t> (slot)] / total;
+
+        primed = true;
+        position = beamStart + bestSlot;
+        recentre (totalClusters);
+
+        if (bestIsMove)
+        {
+            result.clusterIndex = position;
+            result.noteIndex = bestNote;
+        }
+
+        return result;
+    }
+
+private:
+    static constexpr float kHitProbability = 0.9f;
+    static constexpr float kRepeatProbability = 0.2f;
+    static constexpr float kWrongNoteProbability = 1.0f / 128.0f;
+    static constexpr float kInsertionProbability = 0.1f;
+
+    static int findNote (const Reference& reference,
+                         const uint8_t* matched,
+                         int clusterIndex,
+                         int noteNumber,
+                         int channel,
+                         int tolerance) noexcept
+    {
+        const auto& cluster = reference.clusters[static_cast<size_t> (clusterIndex)];
+        const int totalNotes = static_cast<int> (reference.notes.size());
+        const int endIndex = std::min (totalNotes, cluster.startIndex + cluster.noteCount);
+        int bestIndex = -1;
+        int bestScore = 0;
+
+        for (int i = std::max (0, cluster.startIndex); i < endIndex; ++i)
+        {
+            const auto& note = reference.notes[static_cast<size_t> (i)];
+            if (note.channel != channel)
+                continue;
+
+            const int delta = std::abs (note.noteNumber - noteNumber);
+            if (delta > tolerance)
+                continue;
+
+            // Prefer exact pitch, then unmatched notes.
+            const int score = (tolerance + 1 - delta) * 2
+                + ((matched == nullptr || matched[i] == 0) ? 1 : 0);
+            if (score > bestScore)
+            {
+                bestScore = score;
+                bestIndex = i;
+            }
+        }
+
+        return bestIndex;
+    }
+
+    void recentre (int totalClusters) noexcept
+    {
+        const int maxStart = std::max (0, totalClusters - kBeamWidth);
+        const int newStart = std::clamp (position - kBeamBack, 0, maxStart);
+        const int shift = newStart - beamStart;
+        if (shift == 0)
+            return;
+
+        for (int slot = 0; slot < kBeamWidth; ++slot)
+        {
+            const int from = slot + shift;
+            next[static_cast<size_t> (slot)] = (from >= 0 && from < kBeamWidth)
+                ? alpha[static_cast<size_t> (from)]
+                : 0.0f;
+        }
+
+        alpha = next;
+        beamStart = newStart;
+    }
+
+    std::array<float, kBeamWidth> alpha {};
+    std::array<float, kBeamWidth> next {};
+    std::array<float, kMaxSkip + kMaxBack + 1> transition {};
+    int beamStart = 0;
+    int position = 0;
+    bool primed = false;
+};
@@ -0,0 +1,132 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Hash index of pitch-interval n-grams over the whole reference, used to relocalise the
+// follower after the performer jumps (e.g. back to rehearse a phrase). Each cluster is
+// reduced to one representative pitch (its highest note); the n-gram ending at cluster i
+// is the kLength - 1 intervals between clusters i - kLength + 1 .. i, so it is transposition
+// invariant. build() allocates and runs at load time. Each bucket is sorted by key and then
+// cluster, so find() is allocation-free and costs two binary searches plus one step per match,
+// however often the n-gram repeats in the piece.
+class PitchNgramIndex
+{
+public:
+    static constexpr int kLength = 4;
+
+    void build (const std::vector<int>& clusterPitches)
+    {
+        const int totalClusters = static_cast<int> (clusterPitches.size());
+        const int totalGrams = std::max (0, totalClusters - kLength + 1);
+
+        uint32_t bucketCount = 64;
+        while (bucketCount < static_cast<uint32_t> (totalGrams))
+            bucketCount <<= 1;
+        bucketMask = bucketCount - 1;
+
+        bucketStarts.assign (bucketCount + 1, 0);
+        entryKeys.assign (static_cast<size_t> (totalGrams), 0);
+        entryClusters.assign (static_cast<size_t> (totalGrams), 0);
+
+        struct Gram
+        {
+            uint32_t bucket;
+            uint32_t key;
+            int cluster;
+        };
+
+        std::vector<Gram> grams (static_cast<size_t> (totalGrams));
+        for (int gram = 0; gram < totalGrams; ++gram)
+        {
+            const uint32_t key = makeKey (clusterPitches.data() + gram);
+            grams[static_cast<size_t> (gram)] = { bucketOf (key), key, gram + kLength - 1 };
+            ++bucketStarts[bucketOf (key) + 1];
+        }
+
+        std::sort (grams.begin(), grams.end(), [] (const Gram& a, const Gram& b)
+        {
+            if (a.bucket != b.bucket)
+                return a.bucket < b.bucket;
+            if (a.key != b.key)
+                return a.key < b.key;
+            return a.cluster < b.cluster;
+        });
+
+        for (uint32_t bucket = 0; bucket < bucketCount; ++bucket)
+            bucketStarts[bucket + 1] += bucketStarts[bucket];
+
+        for (size_t slot = 0; slot < grams.size(); ++slot)
+        {
+            entryKeys[slot] = grams[slot].key;
+            entryClusters[slot] = grams[slot].cluster;
+        }
+    }
+
+    bool isEmpty() const noexcept
+    {
+        return entryKeys.empty();
+    }
+
+    // Calls fn (data, bytes) for each storage buffer, e.g. to prefault them before use.
+    template <typename Fn>
+    void forEachBuffer (Fn&& fn) const
+    {
+        fn (bucketStarts.data(), bucketStarts.size() * sizeof (uint32_t));
+        fn (entryKeys.data(), entryKeys.size() * sizeof (uint32_t));
+        fn (entryClusters.data(), entryClusters.size() * sizeof (int));
+    }
+
+    // pitches holds the last kLength onset pitches, oldest first. Writes up to maxMatches
+    // clusters whose n-gram matches, preferring those closest to nearCluster.
+    int find (const int* pitches, int nearCluster, int* matches, int maxMatches) const noexcept
+    {
+        if (isEmpty() || maxMatches <= 0)
+            return 0;
+
+        const uint32_t key = makeKey (pitches);
+        const uint32_t bucket = bucketOf (key);
+        const auto keys = std::equal_range (entryKeys.data() + bucketStarts[bucket],
+                                            entryKeys.data() + bucketStarts[bucket + 1],
+                                            key);
+        const int* first = entryClusters.data() + (keys.first - entryKeys.data());
+        const int* last = entryClusters.data() + (keys.second - entryKeys.data());
+
+        // The slice is in cluster order: walk outwards from nearCluster, nearest first (the
+        // earlier cluster on a tie).
+        const int* after = std::lower_bound (first, last, nearCluster);
+        const int* before = after;
+        int count = 0;
+
+        while (count < maxMatches && (before != first || after != last))
+        {
+            const bool takeBefore = after == last
+                || (before != first && nearCluster - before[-1] <= *after - nearCluster);
+            matches[count++] = takeBefore ? *--before : *after++;
+        }
+
+        return count;
+    }
+
+private:
+    static uint32_t makeKey (const int* pitches) noexcept
+    {
+        uint32_t key = 0;
+        for (int i = 1; i < kLength; ++i)
+        {
+            const int interval = std::clamp (pitches[i] - pitches[i - 1], -63, 63) + 64;
+            key = (key << 7) | static_cast<uint32_t> (interval);
+        }
+        return key;
+    }
+
+    uint32_t bucketOf (uint32_t key) const noexcept
+    {
+        return (key * 2654435761u >> 7) & bucketMask;
+    }
+
+    std::vector<uint32_t> bucketStarts;
+    std::vector<uint32_t> entryKeys;
+    std::vector<int> entryClusters;
+    uint32_t bucketMask = 0;
+};
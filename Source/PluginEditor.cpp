@@ -49,6 +49,7 @@ namespace
     constexpr const char* kFallbackDisplayFontName = ".SF NS Display";
     constexpr const char* kFallbackDisplayFontNameAlt = "SF Pro Text";
     constexpr double kDeveloperFadeDurationMs = 500.0;
+    constexpr double kIdleRefreshIntervalMs = 500.0;
     constexpr const char* kParamDelayMs = "delay_ms";
     constexpr const char* kParamClusterWindowMs = "match_window_ms";
     constexpr const char* kParamCorrection = "correction";
@@ -58,6 +59,13 @@ namespace
     constexpr const char* kParamMute = "mute";
     constexpr const char* kParamBypass = "bypass";
     constexpr const char* kParamVelocityCorrection = "velocity_correction";
+    constexpr const char* kParamPredictiveOutput = "predictive_output";
+    constexpr const char* kParamAutoSlack = "auto_slack";
+    constexpr const char* kParamAutoSlackPercentile = "auto_slack_percentile";
+    constexpr const char* kParamFollowerEngine = "follower_engine";
+    constexpr const char* kParamHostLock = "host_lock";
+    constexpr const char* kParamFollowHostTempo = "follow_host_tempo";
+    constexpr const char* kParamWorkBudget = "work_budget";
 
     const juce::String kChooseLabel = juce::String::fromUTF8 ("Choose\xe2\x80\xa6");
 
@@ -114,6 +122,41 @@ namespace
         value = static_cast<float> (parsed);
         return true;
     }
+
+    // Channel lists like "10" or "10, 11"; empty or "-" means none.
+    bool tryParseChannelMask (const juce::String& text, uint16_t& mask)
+    {
+        juce::StringArray tokens;
+        tokens.addTokens (text, ", ", "");
+        tokens.removeEmptyStrings();
+
+        uint16_t parsed = 0;
+        for (const auto& token : tokens)
+        {
+            if (token == "-")
+                continue;
+            if (! token.containsOnly ("0123456789"))
+                return false;
+            const int channel = token.getIntValue();
+            if (channel < 1 || channel > 16)
+                return false;
+            parsed = static_cast<uint16_t> (parsed | (1u << (channel - 1)));
+        }
+
+        mask = parsed;
+        return true;
+    }
+
+    juce::String formatChannelMask (uint16_t mask)
+    {
+        juce::StringArray channels;
+        for (int channel = 1; channel <= 16; ++channel)
+        {
+            if ((mask >> (channel - 1)) & 1u)
+                channels.add (juce::String (channel));
+        }
+        return channels.isEmpty() ? juce::String ("-") : channels.joinIntoString (", ");
+    }
 }
 
 void PluginEditor::PulseIndicator::paint (juce::Graphics& g)
@@ -349,6 +392,14 @@ void PluginEditor::CorrectionDisplay::setValues (float noteOnDeltaMs,
     const float targetOn = juce::jlimit (-1.0f, 1.0f, noteOnDeltaMs / timeScale);
     const float targetOff = juce::jlimit (-1.0f, 1.0f, noteOffDeltaMs / timeScale);
     const float targetVel = juce::jlimit (-1.0f, 1.0f, velocityDelta / 127.0f);
+    const bool moving = std::abs (targetOn - smoothedOn) > 1.0e-4f
+        || std::abs (targetOff - smoothedOff) > 1.0e-4f
+        || std::abs (targetVel - smoothedVel) > 1.0e-4f;
+
+    if (moving)
+        settledFrames = 0;
+    else if (settledFrames <= kTrailLength)
+        ++settledFrames;
 
     smoothedOn += 0.18f * (targetOn - smoothedOn);
     smoothedOff += 0.18f * (targetOff - smoothedOff);
@@ -362,7 +413,9 @@ void PluginEditor::CorrectionDisplay::setValues (float noteOnDeltaMs,
     if (trailCount < kTrailLength)
         ++trailCount;
 
-    repaint();
+    // Once the trail has filled with identical points there is nothing new to draw.
+    if (settledFrames <= kTrailLength)
+        repaint();
 }
 
 PluginEditor::ExpandButton::ExpandButton()
@@ -427,13 +480,13 @@ void PluginEditor::PianoRollComponent::paint (juce::Graphics& g)
         {
             info = "No reference data";
         }
-        else if (referenceData->notes.empty())
+        else if (referenceData->isEmpty())
         {
             info = "Reference notes: 0";
         }
         else if (hasPitchRange)
         {
-            info = "Notes: " + juce::String (static_cast<int> (referenceData->notes.size()))
+            info = "Notes: " + juce::String (static_cast<int> (referenceData->getNumNotes()))
                 + " Range: " + juce::String (minNote) + "-" + juce::String (maxNote);
         }
         else
@@ -444,7 +497,7 @@ void PluginEditor::PianoRollComponent::paint (juce::Graphics& g)
         g.drawText (info, bounds.reduced (4.0f), juce::Justification::topLeft, false);
     }
 
-    if (! referenceData || referenceData->notes.empty() || ! hasPitchRange || sampleRate <= 0.0)
+    if (! referenceData || referenceData->isEmpty() || ! hasPitchRange || sampleRate <= 0.0)
         return;
 
     g.reduceClipRegion (getLocalBounds());
@@ -483,15 +536,16 @@ void PluginEditor::PianoRollComponent::paint (juce::Graphics& g)
     const juce::Colour userColour (0xff4dd1ff);
     const juce::Colour overlapColour (0xff555ed2);
 
-    for (size_t i = 0; i < referenceData->notes.size(); ++i)
+    const auto firstNoteSample = static_cast<double> (referenceData->getFirstNoteSample (sampleRate));
+    for (size_t i = 0; i < referenceData->getNumNotes(); ++i)
     {
-        const auto& note = referenceData->notes[i];
+        const auto note = referenceData->getNote (i, sampleRate);
         const double alignedOn = static_cast<double> (referenceTransportStartSample)
             + static_cast<double> (note.onSample)
-            - static_cast<double> (referenceData->firstNoteSample);
+            - firstNoteSample;
         const double alignedOff = static_cast<double> (referenceTransportStartSample)
             + static_cast<double> (note.offSample)
-            - static_cast<double> (referenceData->firstNoteSample);
+            - firstNoteSample;
         const auto rect = makeNoteRect (note.noteNumber, alignedOn, alignedOff);
         if (rect.isEmpty())
             continue;
@@ -525,16 +579,16 @@ void PluginEditor::PianoRollComponent::paint (juce::Graphics& g)
     {
         if (! note.matched || note.refIndex < 0 || ! referenceData)
             continue;
-        if (! juce::isPositiveAndBelow (note.refIndex, static_cast<int> (referenceData->notes.size())))
+        if (! juce::isPositiveAndBelow (note.refIndex, static_cast<int> (referenceData->getNumNotes())))
             continue;
 
-        const auto& refNote = referenceData->notes[static_cast<size_t> (note.refIndex)];
+        const auto refNote = referenceData->getNote (static_cast<size_t> (note.refIndex), sampleRate);
         const double alignedOn = static_cast<double> (referenceTransportStartSample)
             + static_cast<double> (refNote.onSample)
-            - static_cast<double> (referenceData->firstNoteSample);
+            - firstNoteSample;
         const double alignedOff = static_cast<double> (referenceTransportStartSample)
             + static_cast<double> (refNote.offSample)
-            - static_cast<double> (referenceData->firstNoteSample);
+            - firstNoteSample;
         const auto refRect = makeNoteRect (refNote.noteNumber, alignedOn, alignedOff);
         const double userOff = note.isActive ? static_cast<double> (nowSample)
             : static_cast<double> (note.offSample);
@@ -561,67 +615,117 @@ void PluginEditor::PianoRollComponent::setReferenceData (
     userNotes.clear();
     orderCounter = 0;
     if (referenceData)
-        referenceMatched.assign (referenceData->notes.size(), 0);
+        referenceMatched.assign (referenceData->getNumNotes(), 0);
     rebuildPitchRange();
     repaint();
 }
 
-void PluginEditor::PianoRollComponent::addUiEvents (const std::vector<PluginProcessor::UiNoteEvent>& events)
+void PluginEditor::PianoRollComponent::addUiEvents (const std::vector<PluginProcessor::UiNoteEvent>& events,
+                                                    const PluginProcessor::UiNoteSnapshot& snapshot)
 {
-    if (events.empty())
+    if (events.empty() && ! snapshot.valid)
         return;
 
-    for (const auto& event : events)
+    for (size_t i = 0; i < events.size(); ++i)
     {
+        if (snapshot.valid && snapshot.eventIndex == i)
+            resyncActiveNotes (snapshot);
+
+        const auto& event = events[i];
         if (event.isNoteOn)
+            addUserNote (event);
+        else
+            releaseUserNote (event);
+    }
+
+    if (snapshot.valid && snapshot.eventIndex >= events.size())
+        resyncActiveNotes (snapshot);
+
+    pruneOldNotes();
+}
+
+void PluginEditor::PianoRollComponent::addUserNote (const PluginProcessor::UiNoteEvent& event)
+{
+    UserNote note;
+    note.noteNumber = event.noteNumber;
+    note.channel = event.channel;
+    note.refIndex = event.refIndex;
+    note.onSample = event.sample;
+    note.offSample = event.sample;
+    note.order = orderCounter++;
+    note.isActive = true;
+    note.matched = event.refIndex >= 0;
+    userNotes.push_back (note);
+
+    if (note.refIndex >= 0
+        && juce::isPositiveAndBelow (note.refIndex, static_cast<int> (referenceMatched.size())))
+    {
+        referenceMatched[static_cast<size_t> (note.refIndex)] = 1;
+    }
+}
+
+void PluginEditor::PianoRollComponent::releaseUserNote (const PluginProcessor::UiNoteEvent& event)
+{
+    int matchIndex = -1;
+    uint64_t oldestOrder = 0;
+    for (size_t i = 0; i < userNotes.size(); ++i)
+    {
+        const auto& candidate = userNotes[i];
+        if (! candidate.isActive)
+            continue;
+        if (candidate.noteNumber != event.noteNumber || candidate.channel != event.channel)
+            continue;
+
+        if (matchIndex < 0 || candidate.order < oldestOrder)
         {
-            UserNote note;
-            note.noteNumber = event.noteNumber;
-            note.channel = event.channel;
-            note.refIndex = event.refIndex;
-            note.onSample = event.sample;
-            note.offSample = event.sample;
-            note.order = orderCounter++;
-            note.isActive = true;
-            note.matched = event.refIndex >= 0;
-            userNotes.push_back (note);
-
-            if (note.refIndex >= 0
-                && juce::isPositiveAndBelow (note.refIndex, static_cast<int> (referenceMatched.size())))
-            {
-                referenceMatched[static_cast<size_t> (note.refIndex)] = 1;
-            }
+            matchIndex = static_cast<int> (i);
+            oldestOrder = candidate.order;
         }
-        else
+    }
+
+    if (matchIndex >= 0)
+    {
+        auto& note = userNotes[static_cast<size_t> (matchIndex)];
+        note.isActive = false;
+        note.offSample = event.sample;
+    }
+}
+
+void PluginEditor::PianoRollComponent::resyncActiveNotes (const PluginProcessor::UiNoteSnapshot& snapshot)
+{
+    // The snapshot is authoritative: anything we think is held but the processor does not
+    // was released while events were being dropped.
+    std::vector<uint8_t> claimed (snapshot.heldNotes.size(), 0);
+
+    for (auto& note : userNotes)
+    {
+        if (! note.isActive)
+            continue;
+
+        bool stillHeld = false;
+        for (size_t i = 0; i < snapshot.heldNotes.size(); ++i)
         {
-            int matchIndex = -1;
-            uint64_t oldestOrder = 0;
-            for (size_t i = 0; i < userNotes.size(); ++i)
+            const auto& held = snapshot.heldNotes[i];
+            if (claimed[i] == 0 && held.noteNumber == note.noteNumber && held.channel == note.channel)
             {
-                const auto& candidate = userNotes[i];
-                if (! candidate.isActive)
-                    continue;
-                if (candidate.noteNumber != event.noteNumber || candidate.channel != event.channel)
-                    continue;
-
-                if (matchIndex < 0 || candidate.order < oldestOrder)
-                {
-                    matchIndex = static_cast<int> (i);
-                    oldestOrder = candidate.order;
-                }
+                claimed[i] = 1;
+                stillHeld = true;
+                break;
             }
+        }
 
-            if (matchIndex >= 0)
-            {
-                auto& note = userNotes[static_cast<size_t> (matchIndex)];
-                note.isActive = false;
-                note.offSample = event.sample;
-            }
+        if (! stillHeld)
+        {
+            note.isActive = false;
+            note.offSample = juce::jmax (note.onSample, snapshot.sample);
         }
     }
 
-    pruneOldNotes();
-    repaint();
+    for (size_t i = 0; i < snapshot.heldNotes.size(); ++i)
+    {
+        if (claimed[i] == 0)
+            addUserNote (snapshot.heldNotes[i]);
+    }
 }
 
 void PluginEditor::PianoRollComponent::setTimeline (uint64_t nowSampleIn,
@@ -649,7 +753,7 @@ void PluginEditor::PianoRollComponent::reset()
     userNotes.clear();
     orderCounter = 0;
     if (referenceData)
-        referenceMatched.assign (referenceData->notes.size(), 0);
+        referenceMatched.assign (referenceData->getNumNotes(), 0);
     else
         referenceMatched.clear();
     repaint();
@@ -679,15 +783,15 @@ void PluginEditor::PianoRollComponent::rebuildPitchRange()
     minNote = 0;
     maxNote = 127;
 
-    if (! referenceData || referenceData->notes.empty())
+    if (! referenceData || referenceData->isEmpty())
         return;
 
     minNote = 127;
     maxNote = 0;
-    for (const auto& note : referenceData->notes)
+    for (size_t i = 0; i < referenceData->getNumNotes(); ++i)
     {
-        minNote = juce::jmin (minNote, note.noteNumber);
-        maxNote = juce::jmax (maxNote, note.noteNumber);
+        minNote = juce::jmin (minNote, referenceData->getNoteNumber (i));
+        maxNote = juce::jmax (maxNote, referenceData->getNoteNumber (i));
     }
 
     if (minNote <= maxNote)
@@ -999,6 +1103,21 @@ PluginEditor::PluginEditor (PluginProcessor& p)
     referenceStatusLabel.setJustificationType (juce::Justification::centredLeft);
     addAndMakeVisible (referenceStatusLabel);
 
+    bypassChannelsLabel.setText ("Bypass Channels", juce::dontSendNotification);
+    bypassChannelsLabel.setJustificationType (juce::Justification::centredLeft);
+    addAndMakeVisible (bypassChannelsLabel);
+
+    configureNumberEntry (bypassChannelsEntry);
+    bypassChannelsEntry.setText (formatChannelMask (processor.getBypassChannelMask()), juce::dontSendNotification);
+    bypassChannelsEntry.onTextChange = [this]()
+    {
+        uint16_t mask = 0;
+        if (tryParseChannelMask (bypassChannelsEntry.getText(), mask))
+            processor.setBypassChannelMask (mask);
+        lastBypassChannelMask = -1;
+    };
+    addAndMakeVisible (bypassChannelsEntry);
+
     referenceLoadedIndicator.setColours (juce::Colours::green, juce::Colours::darkgrey);
     referenceLoadedIndicator.setActive (false);
     addAndMakeVisible (referenceLoadedIndicator);
@@ -1078,11 +1197,14 @@ PluginEditor::PluginEditor (PluginProcessor& p)
         if (! juce::isPositiveAndBelow (index, referenceFiles.size()))
             return;
 
+        referenceBox.setTooltip (referenceDescriptions[index]);
+
         juce::String errorMessage;
         if (processor.loadReferenceFromFile (referenceFiles[index], errorMessage))
         {
             referenceStatusLabel.setText ("", juce::dontSendNotification);
             referenceLoadedIndicator.setActive (true);
+            preloadAdjacentReferences();
         }
         else
         {
@@ -1092,19 +1214,11 @@ PluginEditor::PluginEditor (PluginProcessor& p)
     };
 
     const auto currentPath = processor.getReferencePath();
-    if (currentPath.isNotEmpty())
+    if (referenceBox.getSelectedId() > 0)
     {
-        for (int i = 0; i < referenceFiles.size(); ++i)
-        {
-            if (referenceFiles[i].getFullPathName() == currentPath)
-            {
-                referenceBox.setSelectedId (i + 1, juce::dontSendNotification);
-                referenceBox.setColour (juce::ComboBox::textColourId, juce::Colour (0xff555ed2));
-                referenceStatusLabel.setText ("", juce::dontSendNotification);
-                referenceLoadedIndicator.setActive (true);
-                break;
-            }
-        }
+        referenceStatusLabel.setText ("", juce::dontSendNotification);
+        referenceLoadedIndicator.setActive (true);
+        preloadAdjacentReferences();
     }
 
     if (! referenceFiles.isEmpty() && referenceStatusLabel.getText().isEmpty())
@@ -1181,6 +1295,28 @@ PluginEditor::PluginEditor (PluginProcessor& p)
     };
     addAndMakeVisible (pitchToleranceEntry);
 
+    autoSlackTargetLabel.setText ("Auto Slack Target (%)", juce::dontSendNotification);
+    autoSlackTargetLabel.setJustificationType (juce::Justification::centredLeft);
+    addAndMakeVisible (autoSlackTargetLabel);
+
+    configureNumberEntry (autoSlackTargetEntry);
+    autoSlackTargetEntry.onTextChange = [this]()
+    {
+        commitNumberEntry (autoSlackTargetEntry, kParamAutoSlackPercentile);
+    };
+    addAndMakeVisible (autoSlackTargetEntry);
+
+    workBudgetLabel.setText ("Work Budget (ops)", juce::dontSendNotification);
+    workBudgetLabel.setJustificationType (juce::Justification::centredLeft);
+    addAndMakeVisible (workBudgetLabel);
+
+    configureNumberEntry (workBudgetEntry);
+    workBudgetEntry.onTextChange = [this]()
+    {
+        commitNumberEntry (workBudgetEntry, kParamWorkBudget);
+    };
+    addAndMakeVisible (workBudgetEntry);
+
     inputIndicator.setImages (midiInActiveImage, midiInInactiveImage);
     outputIndicator.setImages (midiOutActiveImage, midiOutInactiveImage);
     addAndMakeVisible (inputIndicator);
@@ -1240,10 +1376,58 @@ PluginEditor::PluginEditor (PluginProcessor& p)
     startOffsetValueLabel.setColour (juce::Label::textColourId, juce::Colours::lightgrey);
     addAndMakeVisible (startOffsetValueLabel);
 
+    uiDropsLabel.setText ("Drops (UI/Degraded)", juce::dontSendNotification);
+    uiDropsLabel.setJustificationType (juce::Justification::centredLeft);
+    addAndMakeVisible (uiDropsLabel);
+
+    uiDropsValueLabel.setText ("0 / 0", juce::dontSendNotification);
+    uiDropsValueLabel.setJustificationType (juce::Justification::centredLeft);
+    uiDropsValueLabel.setColour (juce::Label::textColourId, juce::Colours::lightgrey);
+    addAndMakeVisible (uiDropsValueLabel);
+
+    liveSlackLabel.setText ("Live Slack (ms)", juce::dontSendNotification);
+    liveSlackLabel.setJustificationType (juce::Justification::centredLeft);
+    addAndMakeVisible (liveSlackLabel);
+
+    liveSlackValueLabel.setText ("--", juce::dontSendNotification);
+    liveSlackValueLabel.setJustificationType (juce::Justification::centredLeft);
+    liveSlackValueLabel.setColour (juce::Label::textColourId, juce::Colours::lightgrey);
+    addAndMakeVisible (liveSlackValueLabel);
+
+    tempoEstimateLabel.setText ("Tempo Est. (x/drift)", juce::dontSendNotification);
+    tempoEstimateLabel.setJustificationType (juce::Justification::centredLeft);
+    addAndMakeVisible (tempoEstimateLabel);
+
+    tempoEstimateValueLabel.setText ("--", juce::dontSendNotification);
+    tempoEstimateValueLabel.setJustificationType (juce::Justification::centredLeft);
+    tempoEstimateValueLabel.setColour (juce::Label::textColourId, juce::Colours::lightgrey);
+    addAndMakeVisible (tempoEstimateValueLabel);
+
     velocityButton.setButtonText ("Vel Corr");
     velocityButton.setClickingTogglesState (true);
     addAndMakeVisible (velocityButton);
 
+    predictiveButton.setButtonText ("Predictive");
+    predictiveButton.setClickingTogglesState (true);
+    addAndMakeVisible (predictiveButton);
+
+    autoSlackButton.setButtonText ("Auto Slack");
+    autoSlackButton.setClickingTogglesState (true);
+    addAndMakeVisible (autoSlackButton);
+
+    followerEngineBox.addItem ("Cluster", 1);
+    followerEngineBox.addItem ("HMM", 2);
+    followerEngineBox.addItem ("DTW", 3);
+    addAndMakeVisible (followerEngineBox);
+
+    hostLockButton.setButtonText ("Host Lock");
+    hostLockButton.setClickingTogglesState (true);
+    addAndMakeVisible (hostLockButton);
+
+    followHostTempoButton.setButtonText ("Host Tempo");
+    followHostTempoButton.setClickingTogglesState (true);
+    addAndMakeVisible (followHostTempoButton);
+
     resetStartOffsetButton.setButtonText ("Reset Start Offset");
     addAndMakeVisible (resetStartOffsetButton);
 
@@ -1300,6 +1484,16 @@ PluginEditor::PluginEditor (PluginProcessor& p)
         processor.apvts, kParamCorrection, correctionSlider);
     velocityAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
         processor.apvts, kParamVelocityCorrection, velocityButton);
+    predictiveAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        processor.apvts, kParamPredictiveOutput, predictiveButton);
+    autoSlackAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        processor.apvts, kParamAutoSlack, autoSlackButton);
+    followerEngineAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
+        processor.apvts, kParamFollowerEngine, followerEngineBox);
+    hostLockAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        processor.apvts, kParamHostLock, hostLockButton);
+    followHostTempoAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        processor.apvts, kParamFollowHostTempo, followHostTempoButton);
     muteAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
         processor.apvts, kParamMute, muteButton);
     bypassAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
@@ -1313,11 +1507,8 @@ PluginEditor::PluginEditor (PluginProcessor& p)
         applyClusterWindowFromUi();
     };
 
-    syncNumberEntry (slackEntry, kParamDelayMs);
-    syncNumberEntry (clusterWindowEntry, kParamClusterWindowMs);
-    syncNumberEntry (missingTimeoutEntry, kParamMissingTimeoutMs);
-    syncNumberEntry (extraNoteBudgetEntry, kParamExtraNoteBudget);
-    syncNumberEntry (pitchToleranceEntry, kParamPitchTolerance);
+    lastParameterChangeSequence = processor.getParameterChangeSequence();
+    syncParameterEntries();
     if (auto* value = processor.apvts.getRawParameterValue (kParamClusterWindowMs))
         lastClusterWindowMs = value->load();
 
@@ -1423,8 +1614,23 @@ PluginEditor::PluginEditor (PluginProcessor& p)
 
     correctionDisplay.setMinimalStyle (true);
     advancedUserOptions.setDebugOverlayEnabled (boundsOverlayEnabled);
+    lastReferenceChangeSequence = processor.getReferenceChangeSequence();
+    advancedUserOptions.setReferenceData (processor.getReferenceDisplayDataForUi());
+    const auto initialLoadError = processor.getReferenceLoadError();
+    advancedUserOptions.setStatusMessage (initialLoadError.isNotEmpty() ? "Load error: " + initialLoadError
+                                                                        : juce::String());
     updateUiVisibility();
 
+    pianoRollVBlank = std::make_unique<juce::VBlankAttachment> (&advancedUserOptions, [this]
+    {
+        if (! pianoRollRepaintPending)
+            return;
+
+        pianoRollRepaintPending = false;
+        if (advancedUserOptions.isVisible())
+            advancedUserOptions.repaint();
+    });
+
     tabContainer.toBack();
     developerBox.toBack();
     developerPanelBackdrop.toBack();
@@ -1555,9 +1761,24 @@ void PluginEditor::paintOverChildren (juce::Graphics& g)
     drawBounds (pitchToleranceEntry, "pitchToleranceEntry");
     drawBounds (pitchToleranceLabel, "pitchToleranceLabel");
     drawBounds (velocityButton, "velocityButton");
+    drawBounds (predictiveButton, "predictiveButton");
+    drawBounds (autoSlackButton, "autoSlackButton");
+    drawBounds (followerEngineBox, "followerEngineBox");
+    drawBounds (hostLockButton, "hostLockButton");
+    drawBounds (followHostTempoButton, "followHostTempoButton");
+    drawBounds (autoSlackTargetLabel, "autoSlackTargetLabel");
+    drawBounds (autoSlackTargetEntry, "autoSlackTargetEntry");
+    drawBounds (workBudgetLabel, "workBudgetLabel");
+    drawBounds (workBudgetEntry, "workBudgetEntry");
+    drawBounds (liveSlackLabel, "liveSlackLabel");
+    drawBounds (liveSlackValueLabel, "liveSlackValueLabel");
+    drawBounds (tempoEstimateLabel, "tempoEstimateLabel");
+    drawBounds (tempoEstimateValueLabel, "tempoEstimateValueLabel");
     drawBounds (resetStartOffsetButton, "resetStartOffsetButton");
     drawBounds (copyLogButton, "copyLogButton");
     drawBounds (referenceStatusLabel, "referenceStatusLabel");
+    drawBounds (bypassChannelsLabel, "bypassChannelsLabel");
+    drawBounds (bypassChannelsEntry, "bypassChannelsEntry");
     drawBounds (timingLabel, "timingLabel");
     drawBounds (timingValueLabel, "timingValueLabel");
     drawBounds (matchLabel, "matchLabel");
@@ -1727,7 +1948,7 @@ void PluginEditor::resized()
     const auto contentBounds = devPanelBounds.reduced (padding);
 
     const int rowHeight = juce::roundToInt (18.0f * scaleY);
-    const int rowGap = juce::roundToInt (6.0f * scaleY);
+    const int rowGap = juce::roundToInt (4.0f * scaleY);
     const int columnGap = juce::roundToInt (12.0f * scaleX);
     const int columnWidth = (contentBounds.getWidth() - columnGap) / 2;
     const int sliderGap = juce::roundToInt (8.0f * scaleX);
@@ -1735,14 +1956,16 @@ void PluginEditor::resized()
         columnWidth - sliderGap - 40,
         juce::roundToInt (120.0f * scaleX));
 
-    referenceStatusLabel.setBounds (contentBounds.getX(), contentBounds.getY(),
-        contentBounds.getWidth(), rowHeight);
-
     int leftY = contentBounds.getY() + rowHeight + rowGap;
     int rightY = leftY;
     const int leftX = contentBounds.getX();
     const int rightX = contentBounds.getX() + columnWidth + columnGap;
 
+    referenceStatusLabel.setBounds (leftX, contentBounds.getY(), columnWidth, rowHeight);
+    bypassChannelsLabel.setBounds (rightX, contentBounds.getY(), labelWidth, rowHeight);
+    bypassChannelsEntry.setBounds (rightX + labelWidth + sliderGap, contentBounds.getY(),
+        columnWidth - labelWidth - sliderGap, rowHeight);
+
     auto placeEntryRow = [&](juce::Label& label, juce::Label& entry)
     {
         label.setBounds (leftX, leftY, labelWidth, rowHeight);
@@ -1756,12 +1979,20 @@ void PluginEditor::resized()
     placeEntryRow (missingTimeoutLabel, missingTimeoutEntry);
     placeEntryRow (extraNoteBudgetLabel, extraNoteBudgetEntry);
     placeEntryRow (pitchToleranceLabel, pitchToleranceEntry);
+    placeEntryRow (autoSlackTargetLabel, autoSlackTargetEntry);
+    placeEntryRow (workBudgetLabel, workBudgetEntry);
+
+    const int halfWidth = (columnWidth - sliderGap) / 2;
+    auto placeHalfRow = [&](juce::Component& left, juce::Component& right)
+    {
+        left.setBounds (leftX, leftY, halfWidth, rowHeight);
+        right.setBounds (leftX + halfWidth + sliderGap, leftY, columnWidth - halfWidth - sliderGap, rowHeight);
+        leftY += rowHeight + rowGap;
+    };
 
-    velocityButton.setBounds (leftX, leftY, columnWidth, rowHeight);
-    leftY += rowHeight + rowGap;
-    resetStartOffsetButton.setBounds (leftX, leftY, columnWidth, rowHeight);
-    leftY += rowHeight + rowGap;
-    copyLogButton.setBounds (leftX, leftY, columnWidth, rowHeight);
+    placeHalfRow (velocityButton, predictiveButton);
+    placeHalfRow (autoSlackButton, followerEngineBox);
+    placeHalfRow (resetStartOffsetButton, copyLogButton);
 
     auto placeValueRow = [&](juce::Label& label, juce::Label& value)
     {
@@ -1777,6 +2008,12 @@ void PluginEditor::resized()
     placeValueRow (bpmLabel, bpmValueLabel);
     placeValueRow (refIoiLabel, refIoiValueLabel);
     placeValueRow (startOffsetLabel, startOffsetValueLabel);
+    placeValueRow (uiDropsLabel, uiDropsValueLabel);
+    placeValueRow (liveSlackLabel, liveSlackValueLabel);
+    placeValueRow (tempoEstimateLabel, tempoEstimateValueLabel);
+
+    hostLockButton.setBounds (rightX, rightY, halfWidth, rowHeight);
+    followHostTempoButton.setBounds (rightX + halfWidth, rightY, halfWidth, rowHeight);
 
     const int buildInfoX = juce::roundToInt (kBuildInfoX * kAssetScale);
     const int buildInfoY = juce::roundToInt (kBuildInfoY * kAssetScale);
@@ -1792,6 +2029,9 @@ bool PluginEditor::keyPressed (const juce::KeyPress& key)
     if (handleDeveloperShortcut (key))
         return true;
 
+    if (handleReferenceSearchKey (key))
+        return true;
+
     const auto keyChar = key.getTextCharacter();
     if (keyChar == 'o' || keyChar == 'O')
     {
@@ -1860,6 +2100,8 @@ void PluginEditor::updateUiVisibility()
     actualiserTabButton.setVisible (false);
 
     referenceStatusLabel.setVisible (isExpanded && showDeveloperConsole);
+    bypassChannelsLabel.setVisible (isExpanded && showDeveloperConsole);
+    bypassChannelsEntry.setVisible (isExpanded && showDeveloperConsole);
     slackLabel.setVisible (isExpanded && showDeveloperConsole);
     slackEntry.setVisible (isExpanded && showDeveloperConsole);
     clusterWindowLabel.setVisible (isExpanded && showDeveloperConsole);
@@ -1871,6 +2113,15 @@ void PluginEditor::updateUiVisibility()
     pitchToleranceLabel.setVisible (isExpanded && showDeveloperConsole);
     pitchToleranceEntry.setVisible (isExpanded && showDeveloperConsole);
     velocityButton.setVisible (isExpanded && showDeveloperConsole);
+    predictiveButton.setVisible (isExpanded && showDeveloperConsole);
+    autoSlackButton.setVisible (isExpanded && showDeveloperConsole);
+    followerEngineBox.setVisible (isExpanded && showDeveloperConsole);
+    hostLockButton.setVisible (isExpanded && showDeveloperConsole);
+    followHostTempoButton.setVisible (isExpanded && showDeveloperConsole);
+    autoSlackTargetLabel.setVisible (isExpanded && showDeveloperConsole);
+    autoSlackTargetEntry.setVisible (isExpanded && showDeveloperConsole);
+    workBudgetLabel.setVisible (isExpanded && showDeveloperConsole);
+    workBudgetEntry.setVisible (isExpanded && showDeveloperConsole);
     timingLabel.setVisible (isExpanded && showDeveloperConsole);
     timingValueLabel.setVisible (isExpanded && showDeveloperConsole);
     matchLabel.setVisible (isExpanded && showDeveloperConsole);
@@ -1883,6 +2134,12 @@ void PluginEditor::updateUiVisibility()
     refIoiValueLabel.setVisible (isExpanded && showDeveloperConsole);
     startOffsetLabel.setVisible (isExpanded && showDeveloperConsole);
     startOffsetValueLabel.setVisible (isExpanded && showDeveloperConsole);
+    uiDropsLabel.setVisible (isExpanded && showDeveloperConsole);
+    uiDropsValueLabel.setVisible (isExpanded && showDeveloperConsole);
+    liveSlackLabel.setVisible (isExpanded && showDeveloperConsole);
+    liveSlackValueLabel.setVisible (isExpanded && showDeveloperConsole);
+    tempoEstimateLabel.setVisible (isExpanded && showDeveloperConsole);
+    tempoEstimateValueLabel.setVisible (isExpanded && showDeveloperConsole);
     resetStartOffsetButton.setVisible (isExpanded && showDeveloperConsole);
     copyLogButton.setVisible (isExpanded && showDeveloperConsole);
 
@@ -2005,6 +2262,17 @@ void PluginEditor::syncNumberEntry (juce::Label& label, const char* paramId)
     }
 }
 
+void PluginEditor::syncParameterEntries()
+{
+    syncNumberEntry (slackEntry, kParamDelayMs);
+    syncNumberEntry (clusterWindowEntry, kParamClusterWindowMs);
+    syncNumberEntry (missingTimeoutEntry, kParamMissingTimeoutMs);
+    syncNumberEntry (extraNoteBudgetEntry, kParamExtraNoteBudget);
+    syncNumberEntry (pitchToleranceEntry, kParamPitchTolerance);
+    syncNumberEntry (autoSlackTargetEntry, kParamAutoSlackPercentile);
+    syncNumberEntry (workBudgetEntry, kParamWorkBudget);
+}
+
 void PluginEditor::applyClusterWindowFromUi()
 {
     if (processor.isTransportPlaying())
@@ -2039,48 +2307,89 @@ void PluginEditor::applyClusterWindowFromUi()
 void PluginEditor::rebuildReferenceList()
 {
     referenceFiles.clear();
+    referenceDescriptions.clear();
+    lastReferenceLibrarySequence = referenceLibrary->getChangeSequence();
 
-    const auto referenceDir = juce::File::getSpecialLocation (juce::File::userHomeDirectory)
-        .getChildFile ("Downloads")
-        .getChildFile ("PRISM");
-    if (referenceDir.isDirectory())
-        referenceDir.findChildFiles (referenceFiles, juce::File::findFiles, false, "*.mid;*.midi");
-
-    struct FileSorter
+    const auto snapshot = referenceLibrary->getSnapshot();
+    if (snapshot != nullptr)
     {
-        int compareElements (const juce::File& a, const juce::File& b) const
+        for (const auto index : ReferenceLibrary::search (*snapshot, referenceFilter))
         {
-            return a.getFileName().compareIgnoreCase (b.getFileName());
+            const auto& entry = (*snapshot)[static_cast<size_t> (index)];
+            referenceFiles.add (entry.file);
+            referenceDescriptions.add (ReferenceLibrary::describe (entry));
         }
-    };
-
-    FileSorter sorter;
-    referenceFiles.sort (sorter);
+    }
 
+    const auto currentPath = processor.getReferencePath();
+    int selectedId = 0;
     referenceBox.clear (juce::dontSendNotification);
     for (int i = 0; i < referenceFiles.size(); ++i)
-        referenceBox.addItem (referenceFiles[i].getFileNameWithoutExtension(), i + 1);
-
-    referenceBox.setTextWhenNoChoicesAvailable ("No personalities found");
-    if (referenceFiles.isEmpty())
     {
-        referenceBox.setTextWhenNothingSelected (kChooseLabel);
-        referenceBox.setSelectedId (0, juce::dontSendNotification);
-        referenceBox.setColour (juce::ComboBox::textColourId, juce::Colours::white);
-        referenceBox.setEnabled (false);
-    }
-    else
-    {
-        referenceBox.setTextWhenNothingSelected (kChooseLabel);
-        referenceBox.setColour (juce::ComboBox::textColourId, juce::Colours::white);
-        referenceBox.setEnabled (true);
-    }
+        referenceBox.addItem (referenceFiles[i].getFileNameWithoutExtension(), i + 1);
+        if (currentPath.isNotEmpty() && referenceFiles[i].getFullPathName() == currentPath)
+            selectedId = i + 1;
+    }
+
+    const auto chooseText = referenceFilter.isEmpty()
+        ? kChooseLabel
+        : "Search: " + referenceFilter + " (" + juce::String (referenceFiles.size()) + ")";
+    referenceBox.setTextWhenNoChoicesAvailable (referenceFilter.isEmpty()
+        ? (referenceLibrary->hasLoaded() ? "No personalities found" : "Indexing personalities")
+        : chooseText);
+    referenceBox.setTextWhenNothingSelected (chooseText);
+    referenceBox.setSelectedId (selectedId, juce::dontSendNotification);
+    referenceBox.setColour (juce::ComboBox::textColourId,
+        selectedId > 0 ? juce::Colour (0xff555ed2) : juce::Colours::white);
+    referenceBox.setEnabled (! referenceFiles.isEmpty() || referenceFilter.isNotEmpty());
+    referenceBox.setTooltip (selectedId > 0 ? referenceDescriptions[selectedId - 1] : juce::String());
 
     referenceBox.setColour (juce::ComboBox::backgroundColourId, juce::Colours::transparentBlack);
     referenceBox.setColour (juce::ComboBox::outlineColourId, juce::Colours::transparentBlack);
     referenceBox.setColour (juce::ComboBox::arrowColourId, juce::Colours::transparentBlack);
 }
 
+// The entries either side of the selection are the likeliest next picks; build them in the background.
+void PluginEditor::preloadAdjacentReferences()
+{
+    const int index = referenceBox.getSelectedId() - 1;
+    if (index < 0)
+        return;
+
+    juce::Array<juce::File> files;
+    if (index + 1 < referenceFiles.size())
+        files.add (referenceFiles[index + 1]);
+    if (index > 0)
+        files.add (referenceFiles[index - 1]);
+    processor.preloadReferences (files);
+}
+
+// Type-ahead search on the focused performer dropdown: printable keys narrow the list,
+// backspace removes a character and escape clears the filter.
+bool PluginEditor::handleReferenceSearchKey (const juce::KeyPress& key)
+{
+    if (! referenceBox.hasKeyboardFocus (false) || key.getModifiers().isCommandDown())
+        return false;
+
+    auto filter = referenceFilter;
+    const auto keyChar = key.getTextCharacter();
+    if (key == juce::KeyPress::backspaceKey)
+        filter = filter.dropLastCharacters (1);
+    else if (key == juce::KeyPress::escapeKey)
+        filter.clear();
+    else if (keyChar >= ' ' && keyChar != 127)
+        filter += juce::String::charToString (keyChar);
+    else
+        return false;
+
+    if (filter != referenceFilter)
+    {
+        referenceFilter = filter;
+        rebuildReferenceList();
+    }
+    return true;
+}
+
 void PluginEditor::resetParametersToDefaults()
 {
     for (auto* parameter : processor.getParameters())
@@ -2108,6 +2417,7 @@ void PluginEditor::resetPluginState()
     developerModeTargetAlpha = 0.0f;
     developerConsoleButton.setToggleState (false, juce::dontSendNotification);
 
+    referenceFilter.clear();
     rebuildReferenceList();
     referenceLoadedIndicator.setActive (false);
     referenceStatusLabel.setText (referenceFiles.isEmpty() ? "No personalities found." : "No reference loaded.",
@@ -2143,49 +2453,49 @@ void PluginEditor::timerCallback()
     const auto nowMs = juce::Time::getMillisecondCounterHiRes();
     updateDeveloperModeFade (nowMs);
 
-    if (! processor.isTransportPlaying())
+    const bool transportPlaying = processor.isTransportPlaying();
+
+    if (referenceLibrary->getChangeSequence() != lastReferenceLibrarySequence && ! referenceBox.isPopupActive())
+        rebuildReferenceList();
+
+    const auto referenceSequence = processor.getReferenceChangeSequence();
+    if (referenceSequence != lastReferenceChangeSequence)
     {
-        juce::String pendingPath;
-        if (processor.consumePendingReferencePath (pendingPath))
+        lastReferenceChangeSequence = referenceSequence;
+        advancedUserOptions.setReferenceData (processor.getReferenceDisplayDataForUi());
+        const auto loadError = processor.getReferenceLoadError();
+        advancedUserOptions.setStatusMessage (loadError.isNotEmpty() ? "Load error: " + loadError : juce::String());
+        // Uncached references finish loading (or fail) after the selection returned.
+        if (loadError.isNotEmpty())
         {
-            juce::String errorMessage;
-            if (processor.loadReferenceFromFile (juce::File (pendingPath), errorMessage))
-            {
-                referenceStatusLabel.setText ("", juce::dontSendNotification);
-                referenceLoadedIndicator.setActive (true);
-            }
-            else
-            {
-                referenceStatusLabel.setText ("Load failed: " + errorMessage, juce::dontSendNotification);
-                referenceLoadedIndicator.setActive (false);
-            }
+            referenceStatusLabel.setText ("Load failed: " + loadError, juce::dontSendNotification);
+            referenceLoadedIndicator.setActive (false);
         }
+        pianoRollRepaintPending = true;
     }
 
-    advancedUserOptions.setReferenceData (processor.getReferenceDisplayDataForUi());
-    const auto loadError = processor.getReferenceLoadError();
-    advancedUserOptions.setStatusMessage (loadError.isNotEmpty() ? "Load error: " + loadError : juce::String());
-    processor.popUiNoteEvents (uiNoteEvents, 512);
-    if (! uiNoteEvents.empty())
-        lastUiNoteSample = uiNoteEvents.back().sample;
+    const bool entryBeingEdited = slackEntry.isBeingEdited()
+        || clusterWindowEntry.isBeingEdited()
+        || missingTimeoutEntry.isBeingEdited()
+        || extraNoteBudgetEntry.isBeingEdited()
+        || pitchToleranceEntry.isBeingEdited()
+        || autoSlackTargetEntry.isBeingEdited()
+        || workBudgetEntry.isBeingEdited();
+    const auto parameterSequence = processor.getParameterChangeSequence();
+    if (parameterSequence != lastParameterChangeSequence && ! entryBeingEdited)
+    {
+        lastParameterChangeSequence = parameterSequence;
 
-    const auto timelineSample = processor.getTimelineSampleForUi();
-    const auto referenceStartSample = processor.getReferenceTransportStartSampleForUi();
-    const auto sampleRate = processor.getSampleRateForUi();
-    const bool transportPlaying = processor.isTransportPlaying();
-    const uint64_t halfWindowSamples = sampleRate > 0.0
-        ? static_cast<uint64_t> (std::llround (sampleRate * 2.5))
-        : 0;
-    const bool recentUserNote = ! transportPlaying
-        && lastUiNoteSample > 0
-        && timelineSample >= lastUiNoteSample
-        && (timelineSample - lastUiNoteSample) <= halfWindowSamples;
-    const uint64_t nowSample = (transportPlaying || recentUserNote) ? timelineSample : referenceStartSample;
+        const auto* clusterValue = processor.apvts.getRawParameterValue (kParamClusterWindowMs);
+        const float clusterWindowMs = (clusterValue != nullptr) ? clusterValue->load() : 0.0f;
+        if (std::abs (clusterWindowMs - lastClusterWindowMs) > 0.5f)
+        {
+            lastClusterWindowMs = clusterWindowMs;
+            applyClusterWindowFromUi();
+        }
 
-    advancedUserOptions.setTimeline (nowSample, referenceStartSample, sampleRate);
-    advancedUserOptions.addUiEvents (uiNoteEvents);
-    if (advancedUserOptions.isVisible())
-        advancedUserOptions.repaint();
+        syncParameterEntries();
+    }
 
     const auto inputCounter = processor.getInputNoteOnCounter();
     if (inputCounter != lastInputNoteOnCounter)
@@ -2207,6 +2517,38 @@ void PluginEditor::timerCallback()
     const bool outputActive = (nowMs - lastOutputFlashMs) <= 120.0;
     outputIndicator.setActive (outputActive);
 
+    const auto uiSequence = processor.getUiChangeSequence();
+    const bool hasNewData = uiSequence != lastUiChangeSequence;
+    const bool idleRefreshDue = developerConsoleOpen && (nowMs - lastIdleRefreshMs) >= kIdleRefreshIntervalMs;
+    if (! hasNewData && ! pianoRollFollowingTimeline && ! idleRefreshDue && correctionDisplay.isSettled())
+        return;
+
+    lastUiChangeSequence = uiSequence;
+    lastIdleRefreshMs = nowMs;
+
+    processor.popUiNoteEvents (uiNoteEvents, uiNoteSnapshot);
+    if (! uiNoteEvents.empty())
+        lastUiNoteSample = uiNoteEvents.back().sample;
+
+    const auto timelineSample = processor.getTimelineSampleForUi();
+    const auto referenceStartSample = processor.getReferenceTransportStartSampleForUi();
+    const auto sampleRate = processor.getSampleRateForUi();
+    const uint64_t halfWindowSamples = sampleRate > 0.0
+        ? static_cast<uint64_t> (std::llround (sampleRate * 2.5))
+        : 0;
+    const bool recentUserNote = ! transportPlaying
+        && lastUiNoteSample > 0
+        && timelineSample >= lastUiNoteSample
+        && (timelineSample - lastUiNoteSample) <= halfWindowSamples;
+    const bool wasFollowingTimeline = pianoRollFollowingTimeline;
+    pianoRollFollowingTimeline = transportPlaying || recentUserNote;
+    const uint64_t nowSample = pianoRollFollowingTimeline ? timelineSample : referenceStartSample;
+
+    advancedUserOptions.setTimeline (nowSample, referenceStartSample, sampleRate);
+    advancedUserOptions.addUiEvents (uiNoteEvents, uiNoteSnapshot);
+    if (hasNewData || pianoRollFollowingTimeline || wasFollowingTimeline)
+        pianoRollRepaintPending = true;
+
     const auto* slackValue = processor.apvts.getRawParameterValue (kParamDelayMs);
     const float slackMs = (slackValue != nullptr) ? slackValue->load() : 0.0f;
     correctionDisplay.setValues (processor.getLastTimingDeltaMs(),
@@ -2225,13 +2567,12 @@ void PluginEditor::timerCallback()
         timingValueLabel.setText (prefix + juce::String (deltaMs, 2), juce::dontSendNotification);
     }
 
-    const bool isPlaying = processor.isTransportPlaying();
-    if (isPlaying != lastTransportPlaying)
+    if (transportPlaying != lastTransportPlaying)
     {
-        lastTransportPlaying = isPlaying;
-        resetStartOffsetButton.setEnabled (! isPlaying);
-        copyLogButton.setEnabled (! isPlaying);
-        clusterWindowEntry.setEnabled (! isPlaying);
+        lastTransportPlaying = transportPlaying;
+        resetStartOffsetButton.setEnabled (! transportPlaying);
+        copyLogButton.setEnabled (! transportPlaying);
+        clusterWindowEntry.setEnabled (! transportPlaying);
     }
 
     const auto matched = processor.getMatchedNoteOnCounter();
@@ -2312,18 +2653,53 @@ void PluginEditor::timerCallback()
         }
     }
 
-    const auto* clusterValue = processor.apvts.getRawParameterValue (kParamClusterWindowMs);
-    const float clusterWindowMs = (clusterValue != nullptr) ? clusterValue->load() : 0.0f;
-    if (! clusterWindowEntry.isBeingEdited()
-        && std::abs (clusterWindowMs - lastClusterWindowMs) > 0.5f)
+    const int bypassMask = static_cast<int> (processor.getBypassChannelMask());
+    if (bypassMask != lastBypassChannelMask && ! bypassChannelsEntry.isBeingEdited())
     {
-        lastClusterWindowMs = clusterWindowMs;
-        applyClusterWindowFromUi();
+        lastBypassChannelMask = bypassMask;
+        bypassChannelsEntry.setText (formatChannelMask (static_cast<uint16_t> (bypassMask)), juce::dontSendNotification);
     }
 
-    syncNumberEntry (slackEntry, kParamDelayMs);
-    syncNumberEntry (clusterWindowEntry, kParamClusterWindowMs);
-    syncNumberEntry (missingTimeoutEntry, kParamMissingTimeoutMs);
-    syncNumberEntry (extraNoteBudgetEntry, kParamExtraNoteBudget);
-    syncNumberEntry (pitchToleranceEntry, kParamPitchTolerance);
+    const auto droppedUiEvents = processor.getDroppedUiNoteEventCount();
+    const auto degradedEvents = processor.getDegradedEventCount();
+    if (droppedUiEvents != lastDroppedUiNoteEvents || degradedEvents != lastDegradedEvents)
+    {
+        lastDroppedUiNoteEvents = droppedUiEvents;
+        lastDegradedEvents = degradedEvents;
+        uiDropsValueLabel.setText (juce::String (droppedUiEvents) + " / " + juce::String (degradedEvents),
+            juce::dontSendNotification);
+    }
+
+    const float liveSlackMs = processor.getCurrentSlackMs();
+    if (std::abs (liveSlackMs - lastLiveSlackMs) > 0.5f)
+    {
+        lastLiveSlackMs = liveSlackMs;
+        liveSlackValueLabel.setText (juce::String (liveSlackMs, 0), juce::dontSendNotification);
+    }
+
+    const bool tempoEstimateValid = processor.hasTempoEstimate();
+    const float tempoRatio = processor.getTempoEstimateRatio();
+    const float tempoDriftMs = processor.getTempoEstimateDriftMs();
+    const float tempoSpreadMs = processor.getTempoEstimateSpreadMs();
+    if (tempoEstimateValid != lastTempoEstimateValid
+        || std::abs (tempoRatio - lastTempoEstimateRatio) > 0.001f
+        || std::abs (tempoDriftMs - lastTempoEstimateDriftMs) > 0.5f
+        || std::abs (tempoSpreadMs - lastTempoEstimateSpreadMs) > 0.5f)
+    {
+        lastTempoEstimateValid = tempoEstimateValid;
+        lastTempoEstimateRatio = tempoRatio;
+        lastTempoEstimateDriftMs = tempoDriftMs;
+        lastTempoEstimateSpreadMs = tempoSpreadMs;
+        if (! tempoEstimateValid)
+        {
+            tempoEstimateValueLabel.setText ("--", juce::dontSendNotification);
+        }
+        else
+        {
+            const juce::String signPrefix = (tempoDriftMs >= 0.0f) ? "+" : "";
+            tempoEstimateValueLabel.setText ("x" + juce::String (tempoRatio, 3) + " / "
+                    + signPrefix + juce::String (tempoDriftMs, 0) + " ms (+/-" + juce::String (tempoSpreadMs, 0) + ")",
+                juce::dontSendNotification);
+        }
+    }
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "ReferenceLibrary.h"
 
 class PluginEditor final : public juce::AudioProcessorEditor, private juce::Timer
 {
@@ -50,6 +51,7 @@ private:
         void paint (juce::Graphics&) override;
         void setValues (float noteOnDeltaMs, float noteOffDeltaMs, float velocityDelta, float slackMs);
         void setMinimalStyle (bool shouldBeMinimal) { minimalStyle = shouldBeMinimal; repaint(); }
+        bool isSettled() const noexcept { return settledFrames > kTrailLength; }
 
     private:
         struct TrailPoint
@@ -68,6 +70,7 @@ private:
         std::array<TrailPoint, kTrailLength> trail {};
         int trailHead = 0;
         int trailCount = 0;
+        int settledFrames = 0;
         bool minimalStyle = false;
     };
 
@@ -82,7 +85,8 @@ private:
     public:
         void paint (juce::Graphics&) override;
         void setReferenceData (std::shared_ptr<const PluginProcessor::ReferenceDisplayData> data);
-        void addUiEvents (const std::vector<PluginProcessor::UiNoteEvent>& events);
+        void addUiEvents (const std::vector<PluginProcessor::UiNoteEvent>& events,
+                          const PluginProcessor::UiNoteSnapshot& snapshot);
         void setTimeline (uint64_t nowSample, uint64_t referenceStartSample, double sampleRate);
         void reset();
         void setDebugOverlayEnabled (bool shouldShow);
@@ -103,6 +107,9 @@ private:
 
         void rebuildPitchRange();
         void pruneOldNotes();
+        void addUserNote (const PluginProcessor::UiNoteEvent& event);
+        void releaseUserNote (const PluginProcessor::UiNoteEvent& event);
+        void resyncActiveNotes (const PluginProcessor::UiNoteSnapshot& snapshot);
 
         std::shared_ptr<const PluginProcessor::ReferenceDisplayData> referenceData;
         std::vector<UserNote> userNotes;
@@ -197,6 +204,8 @@ private:
     void timerCallback() override;
     void updateUiVisibility();
     void rebuildReferenceList();
+    void preloadAdjacentReferences();
+    bool handleReferenceSearchKey (const juce::KeyPress& key);
     void resetParametersToDefaults();
     void resetPluginState();
     void setDeveloperModeActive (bool shouldBeActive);
@@ -206,6 +215,7 @@ private:
     void configureNumberEntry (juce::Label& label);
     void commitNumberEntry (juce::Label& label, const char* paramId);
     void syncNumberEntry (juce::Label& label, const char* paramId);
+    void syncParameterEntries();
     void applyClusterWindowFromUi();
     bool handleDeveloperShortcut (const juce::KeyPress& key);
 
@@ -216,6 +226,8 @@ private:
     juce::ComboBox modeBox;
     juce::Label referenceLabel;
     juce::Label referenceStatusLabel;
+    juce::Label bypassChannelsLabel;
+    juce::Label bypassChannelsEntry;
     PulseIndicator referenceLoadedIndicator;
 
     juce::TextButton virtuosoTabButton;
@@ -240,6 +252,10 @@ private:
     juce::Label extraNoteBudgetEntry;
     juce::Label pitchToleranceLabel;
     juce::Label pitchToleranceEntry;
+    juce::Label autoSlackTargetLabel;
+    juce::Label autoSlackTargetEntry;
+    juce::Label workBudgetLabel;
+    juce::Label workBudgetEntry;
     juce::Label buildInfoLabel;
     ImageIndicator inputIndicator;
     ImageIndicator outputIndicator;
@@ -255,9 +271,20 @@ private:
     juce::Label refIoiValueLabel;
     juce::Label startOffsetLabel;
     juce::Label startOffsetValueLabel;
+    juce::Label uiDropsLabel;
+    juce::Label uiDropsValueLabel;
+    juce::Label liveSlackLabel;
+    juce::Label liveSlackValueLabel;
+    juce::Label tempoEstimateLabel;
+    juce::Label tempoEstimateValueLabel;
     juce::TextButton resetStartOffsetButton;
     juce::TextButton copyLogButton;
     juce::ToggleButton velocityButton;
+    juce::ToggleButton predictiveButton;
+    juce::ToggleButton autoSlackButton;
+    juce::ComboBox followerEngineBox;
+    juce::ToggleButton hostLockButton;
+    juce::ToggleButton followHostTempoButton;
     ImageToggleButton developerConsoleButton;
     ImageToggleButton muteButton;
     ImageToggleButton bypassButton;
@@ -298,9 +325,18 @@ private:
 
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> correctionAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> velocityAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> predictiveAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> autoSlackAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> followerEngineAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> hostLockAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> followHostTempoAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> muteAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> bypassAttachment;
+    juce::SharedResourcePointer<ReferenceLibrary> referenceLibrary;
     juce::Array<juce::File> referenceFiles;
+    juce::StringArray referenceDescriptions;
+    juce::String referenceFilter;
+    uint32_t lastReferenceLibrarySequence = 0;
     uint32_t lastInputNoteOnCounter = 0;
     double lastInputFlashMs = 0.0;
     uint32_t lastOutputNoteOnCounter = 0;
@@ -320,6 +356,22 @@ private:
     bool lastStartOffsetValid = false;
     uint64_t lastUiNoteSample = 0;
     std::vector<PluginProcessor::UiNoteEvent> uiNoteEvents;
+    PluginProcessor::UiNoteSnapshot uiNoteSnapshot;
+    uint32_t lastDroppedUiNoteEvents = 0;
+    uint32_t lastDegradedEvents = 0;
+    int lastBypassChannelMask = -1;
+    float lastLiveSlackMs = -1.0f;
+    bool lastTempoEstimateValid = false;
+    float lastTempoEstimateRatio = 0.0f;
+    float lastTempoEstimateDriftMs = 0.0f;
+    float lastTempoEstimateSpreadMs = 0.0f;
+    uint32_t lastUiChangeSequence = 0;
+    uint32_t lastReferenceChangeSequence = 0;
+    uint32_t lastParameterChangeSequence = 0;
+    double lastIdleRefreshMs = 0.0;
+    bool pianoRollFollowingTimeline = false;
+    bool pianoRollRepaintPending = false;
+    std::unique_ptr<juce::VBlankAttachment> pianoRollVBlank;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginEditor)
 };
@@ -1,10 +1,15 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "SmfReader.h"
 #include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <limits>
 
+#ifndef PERSONALITIES_LOCK_REALTIME_MEMORY
+ #define PERSONALITIES_LOCK_REALTIME_MEMORY 0
+#endif
+
 namespace
 {
     constexpr const char* kParamDelayMs = "delay_ms";
@@ -16,12 +21,135 @@ namespace
     constexpr const char* kParamMute = "mute";
     constexpr const char* kParamBypass = "bypass";
     constexpr const char* kParamVelocityCorrection = "velocity_correction";
+    constexpr const char* kParamPredictiveOutput = "predictive_output";
+    constexpr const char* kParamAutoSlack = "auto_slack";
+    constexpr const char* kParamAutoSlackPercentile = "auto_slack_percentile";
+    constexpr const char* kParamFollowerEngine = "follower_engine";
+    constexpr const char* kParamHostLock = "host_lock";
+    constexpr const char* kParamFollowHostTempo = "follow_host_tempo";
+    constexpr const char* kParamWorkBudget = "work_budget";
+    constexpr const char* kParamEmbedReference = "embed_reference";
+    constexpr const char* kParamLinkGroup = "link_group";
     constexpr const char* kReferencePathProperty = "reference_path";
+    constexpr const char* kBypassChannelsProperty = "bypass_channels";
+    constexpr const char* kReferenceBlobProperty = "reference_blob";
+    // Version 2 puts the inflated size in front of the compressed data.
+    constexpr int kReferenceBlobVersion = 2;
+    constexpr int kReferenceBlobHeaderBytes = 8;
+    constexpr int kMaxReferenceBlobBytes = 8 << 20;
+    constexpr int kReferenceBlobTempoBytes = 3 * 8;
+    constexpr int kReferenceBlobNoteBytes = 4 + 2 * 8;
+    constexpr int kMaxReferenceBlobEvents = kMaxReferenceBlobBytes / kReferenceBlobNoteBytes;
     constexpr float kMaxSlackMs = 2000.0f;
     constexpr float kMinClusterWindowMs = 20.0f;
     constexpr float kMaxClusterWindowMs = 1000.0f;
+    constexpr float kTempoTrackerMinSpanMs = 80.0f;
+    constexpr float kMaxTempoSpreadMs = 250.0f;
+    constexpr float kControllerWindowMs = 2.0f;
+    // Realtime buffer capacities per second of maximum delay. Long messages get about ten DIN
+    // MIDI cables' worth of bytes.
+    constexpr double kScheduledNotesPerSecond = 2048.0;
+    constexpr double kControlEventsPerSecond = 2048.0;
+    constexpr double kLongMessageBytesPerSecond = 32768.0;
+    constexpr int kMinScheduledEvents = 256;
+    // The editor drains the UI ring at 30 Hz; this leaves room for several missed drains.
+    constexpr double kUiRingSeconds = 0.25;
+    constexpr bool kLockRealtimeMemory = PERSONALITIES_LOCK_REALTIME_MEMORY != 0;
+    // Below this much track data a reference decodes faster on the loading thread alone.
+    constexpr size_t kParallelDecodeMinBytes = 256 * 1024;
+    constexpr float kAutoSlackPhraseGapMs = 300.0f;
+    constexpr float kCheckpointIntervalMs = 250.0f;
+    // A link group position older than this is neither followed nor kept over a lower cluster.
+    constexpr float kLinkedPositionStaleMs = 2000.0f;
+    // Slack moves by at most this many samples per sample of playback, so retimed output never runs backwards.
+    constexpr double kSlackSlewRate = 0.1;
     constexpr uint8_t kScheduledEventNoteFlag = 1u << 0;
     constexpr uint8_t kScheduledEventNoteOnFlag = 1u << 1;
+    constexpr uint8_t kScheduledEventArenaFlag = 1u << 2;
+
+    // UI note records: a two-word header (kind << 32 | count, base sample) followed by one
+    // packed word per note holding the signed offset from the base sample in the upper half.
+    constexpr uint64_t kUiRecordBlock = 1;
+    constexpr uint64_t kUiRecordSnapshot = 2;
+    constexpr int kUiRecordHeaderWords = 2;
+    constexpr int kUiPackedRefIndexLimit = (1 << 20) - 1;
+
+    uint64_t makeUiRecordHeader (uint64_t kind, int count) noexcept
+    {
+        return (kind << 32) | static_cast<uint32_t> (count);
+    }
+
+    uint64_t packUiNote (const PluginProcessor::UiNoteEvent& event, uint64_t baseSample) noexcept
+    {
+        const int64_t delta = juce::jlimit<int64_t> (std::numeric_limits<int32_t>::min(),
+            std::numeric_limits<int32_t>::max(),
+            static_cast<int64_t> (event.sample) - static_cast<int64_t> (baseSample));
+        const uint32_t ref = (event.refIndex >= 0 && event.refIndex < kUiPackedRefIndexLimit)
+            ? static_cast<uint32_t> (event.refIndex + 1)
+            : 0u;
+        const uint32_t low = (ref << 12)
+            | (static_cast<uint32_t> (event.noteNumber & 0x7f) << 5)
+            | (static_cast<uint32_t> ((juce::jlimit (1, 16, event.channel) - 1) & 0x0f) << 1)
+            | (event.isNoteOn ? 1u : 0u);
+        return (static_cast<uint64_t> (static_cast<uint32_t> (static_cast<int32_t> (delta))) << 32) | low;
+    }
+
+    PluginProcessor::UiNoteEvent unpackUiNote (uint64_t word, uint64_t baseSample) noexcept
+    {
+        const auto delta = static_cast<int32_t> (static_cast<uint32_t> (word >> 32));
+        const auto low = static_cast<uint32_t> (word & 0xffffffffu);
+        const int64_t sample = static_cast<int64_t> (baseSample) + delta;
+
+        PluginProcessor::UiNoteEvent event;
+        event.sample = static_cast<uint64_t> (juce::jmax<int64_t> (0, sample));
+        event.noteNumber = static_cast<int> ((low >> 5) & 0x7f);
+        event.channel = static_cast<int> ((low >> 1) & 0x0f) + 1;
+        event.refIndex = static_cast<int> (low >> 12) - 1;
+        event.isNoteOn = (low & 1u) != 0;
+        return event;
+    }
+
+    // Index of the tempo segment containing value (by key), stepping from hint, so lookups that
+    // move steadily through the piece are O(1).
+    template <typename Events, typename Key>
+    int findTempoSegment (const Events& events, double value, int hint, Key key) noexcept
+    {
+        const int count = static_cast<int> (events.size());
+        int index = juce::jlimit (0, juce::jmax (0, count - 1), hint);
+        while (index + 1 < count && value >= key (events[static_cast<size_t> (index + 1)]))
+            ++index;
+        while (index > 0 && value < key (events[static_cast<size_t> (index)]))
+            --index;
+        return index;
+    }
+
+    // Slot key of a continuous controller message, or -1 for messages that must not be thinned
+    // (switches, bank select, RPN/NRPN and data entry, channel mode messages, everything else).
+    int continuousControllerKey (const uint8_t* data, uint8_t size) noexcept
+    {
+        if (size < 2)
+            return -1;
+
+        const int status = data[0] & 0xF0;
+        const int channel = data[0] & 0x0F;
+        if (status == 0xE0)
+            return 2 * 16 * 128 + 16 + channel;
+        if (status == 0xD0)
+            return 2 * 16 * 128 + channel;
+        if (size < 3)
+            return -1;
+        if (status == 0xA0)
+            return 16 * 128 + channel * 128 + (data[1] & 0x7F);
+        if (status != 0xB0)
+            return -1;
+
+        const int controller = data[1] & 0x7F;
+        const bool isContinuous = controller != 0 && controller != 6 && controller != 32 && controller != 38
+            && (controller < 64 || controller > 69)
+            && (controller < 96 || controller > 101)
+            && controller < 120;
+        return isContinuous ? channel * 128 + controller : -1;
+    }
 
     uint64_t msToSamples (double sampleRate, float ms) noexcept
     {
@@ -30,6 +158,12 @@ namespace
         return static_cast<uint64_t> (juce::jmax (0LL, rounded));
     }
 
+    uint64_t secondsToSample (double seconds, double sampleRate) noexcept
+    {
+        const auto rounded = std::llround (seconds * sampleRate);
+        return static_cast<uint64_t> (juce::jmax (0LL, rounded));
+    }
+
     uint64_t lerpSamples (uint64_t a, uint64_t b, float t) noexcept
     {
         const double blended = (1.0 - static_cast<double> (t)) * static_cast<double> (a)
@@ -45,50 +179,109 @@ namespace
         return static_cast<uint8_t> (juce::jlimit (0, 127, rounded));
     }
 
-    double convertTicksToSeconds (double time,
-                                  const juce::MidiMessageSequence& tempoEvents,
-                                  int timeFormat)
+    // Touches one byte per page (and the last byte) so first use on the audio thread does not
+    // fault. Buffers the audio thread writes are written back, so untouched zero pages get
+    // their own frame now rather than on the first write.
+    size_t prefaultBytes (const void* data, size_t bytes, bool writable) noexcept
+    {
+        if (data == nullptr || bytes == 0)
+            return 0;
+
+        auto* base = static_cast<volatile uint8_t*> (const_cast<void*> (data));
+        const auto touch = [base, writable] (size_t index)
+        {
+            const uint8_t value = base[index];
+            if (writable)
+                base[index] = value;
+        };
+
+        for (size_t offset = 0; offset < bytes; offset += RealtimeArena::kPageBytes)
+            touch (offset);
+        touch (bytes - 1);
+        return bytes;
+    }
+
+    // Worker threads shared by every instance for decoding reference track chunks.
+    struct ReferenceDecodePool
     {
-        if (timeFormat < 0)
-            return time / (-(timeFormat >> 8) * (timeFormat & 0xff));
+        juce::ThreadPool pool { juce::jmax (1, juce::SystemStats::getNumCpus() - 1) };
+    };
+
+    // Decodes the reader's tracks on the shared pool, with the calling thread taking tracks too.
+    // Tracks are claimed largest first so a single big track does not finish last.
+    void decodeTracksInParallel (SmfReader& reader)
+    {
+        const int trackCount = reader.getNumTracks();
+        size_t totalBytes = 0;
+        for (int i = 0; i < trackCount; ++i)
+            totalBytes += reader.getTrackBytes (i);
 
-        double lastTime = 0.0;
-        double correctedTime = 0.0;
-        const auto ticksPerQuarter = static_cast<double> (timeFormat & 0x7fff);
-        const auto tickLen = 1.0 / ticksPerQuarter;
-        double secsPerTick = 0.5 * tickLen;
-        const auto numEvents = tempoEvents.getNumEvents();
+        if (trackCount < 2 || totalBytes < kParallelDecodeMinBytes)
+        {
+            reader.decodeAllTracks();
+            return;
+        }
 
-        for (int i = 0; i < numEvents; ++i)
+        std::vector<int> order (static_cast<size_t> (trackCount));
+        for (int i = 0; i < trackCount; ++i)
+            order[static_cast<size_t> (i)] = i;
+        std::sort (order.begin(), order.end(), [&reader] (int a, int b)
         {
-            auto& message = tempoEvents.getEventPointer (i)->message;
-            const auto eventTime = message.getTimeStamp();
+            return reader.getTrackBytes (a) > reader.getTrackBytes (b);
+        });
 
-            if (eventTime >= time)
-                break;
+        juce::SharedResourcePointer<ReferenceDecodePool> decodePool;
+        const int helperCount = juce::jmin (trackCount - 1, decodePool->pool.getNumThreads());
+        std::atomic<int> nextTrack { 0 };
 
-            correctedTime += (eventTime - lastTime) * secsPerTick;
-            lastTime = eventTime;
+        const auto decodeClaimedTracks = [&reader, &order, &nextTrack, trackCount]
+        {
+            for (int i = nextTrack.fetch_add (1); i < trackCount; i = nextTrack.fetch_add (1))
+                reader.decodeTrack (order[static_cast<size_t> (i)]);
+        };
 
-            if (message.isTempoMetaEvent())
-                secsPerTick = tickLen * message.getTempoSecondsPerQuarterNote();
+        struct HelperJob : public juce::ThreadPoolJob
+        {
+            explicit HelperJob (const std::function<void()>& decodeToUse)
+            : juce::ThreadPoolJob ("Reference track decode"), decode (decodeToUse) {}
 
-            while (i + 1 < numEvents)
+            JobStatus runJob() override
             {
-                auto& next = tempoEvents.getEventPointer (i + 1)->message;
-                if (! juce::approximatelyEqual (next.getTimeStamp(), eventTime))
-                    break;
+                decode();
+                return jobHasFinished;
+            }
 
-                if (next.isTempoMetaEvent())
-                    secsPerTick = tickLen * next.getTempoSecondsPerQuarterNote();
+            const std::function<void()>& decode;
+        };
 
-                ++i;
-            }
+        const std::function<void()> decode = decodeClaimedTracks;
+        std::vector<std::unique_ptr<HelperJob>> helpers;
+        helpers.reserve (static_cast<size_t> (helperCount));
+        for (int i = 0; i < helperCount; ++i)
+        {
+            helpers.push_back (std::make_unique<HelperJob> (decode));
+            decodePool->pool.addJob (helpers.back().get(), false);
         }
 
-        return correctedTime + (time - lastTime) * secsPerTick;
+        decodeClaimedTracks();
+
+        // Every track is claimed now: helpers still queued (e.g. behind another instance's load)
+        // are dropped, and only the ones already decoding are waited for.
+        for (auto& helper : helpers)
+            decodePool->pool.removeJob (helper.get(), false, -1);
+    }
+
+    template <typename Values>
+    size_t prefaultVector (const Values& values, bool writable) noexcept
+    {
+        return prefaultBytes (values.data(), values.size() * sizeof (*values.data()), writable);
     }
 
+    template <typename T, size_t N>
+    size_t prefaultArray (std::array<T, N>& values) noexcept
+    {
+        return prefaultBytes (values.data(), sizeof (T) * N, true);
+    }
 }
 
 PluginProcessor::PluginProcessor()
@@ -109,6 +302,33 @@ PluginProcessor::PluginProcessor()
     muteParam = apvts.getRawParameterValue (kParamMute);
     bypassParam = apvts.getRawParameterValue (kParamBypass);
     velocityCorrectionParam = apvts.getRawParameterValue (kParamVelocityCorrection);
+    predictiveOutputParam = apvts.getRawParameterValue (kParamPredictiveOutput);
+    autoSlackParam = apvts.getRawParameterValue (kParamAutoSlack);
+    autoSlackPercentileParam = apvts.getRawParameterValue (kParamAutoSlackPercentile);
+    followerEngineParam = apvts.getRawParameterValue (kParamFollowerEngine);
+    hostLockParam = apvts.getRawParameterValue (kParamHostLock);
+    followHostTempoParam = apvts.getRawParameterValue (kParamFollowHostTempo);
+    workBudgetParam = apvts.getRawParameterValue (kParamWorkBudget);
+    embedReferenceParam = apvts.getRawParameterValue (kParamEmbedReference);
+    linkGroupParam = apvts.getRawParameterValue (kParamLinkGroup);
+
+    for (auto* parameter : getParameters())
+    {
+        if (auto* withId = dynamic_cast<juce::AudioProcessorParameterWithID*> (parameter))
+            apvts.addParameterListener (withId->paramID, this);
+    }
+}
+
+PluginProcessor::~PluginProcessor()
+{
+    // Stop background reference work before the state it publishes to goes away.
+    referenceCache.stop();
+
+    for (auto* parameter : getParameters())
+    {
+        if (auto* withId = dynamic_cast<juce::AudioProcessorParameterWithID*> (parameter))
+            apvts.removeParameterListener (withId->paramID, this);
+    }
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout PluginProcessor::createParameterLayout()
@@ -175,6 +395,64 @@ juce::AudioProcessorValueTreeState::ParameterLayout PluginProcessor::createParam
         true
     ));
 
+    layout.add (std::make_unique<juce::AudioParameterBool>(
+        juce::ParameterID { kParamPredictiveOutput, 1 },
+        "Predictive Output",
+        false
+    ));
+
+    layout.add (std::make_unique<juce::AudioParameterBool>(
+        juce::ParameterID { kParamAutoSlack, 1 },
+        "Auto Slack",
+        false
+    ));
+
+    layout.add (std::make_unique<juce::AudioParameterFloat>(
+        juce::ParameterID { kParamAutoSlackPercentile, 1 },
+        "Auto Slack Target (%)",
+        juce::NormalisableRange<float> { 50.0f, 100.0f, 0.5f },
+        98.0f
+    ));
+
+    layout.add (std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID { kParamFollowerEngine, 1 },
+        "Follower Engine",
+        juce::StringArray { "Cluster", "HMM", "DTW" },
+        0
+    ));
+
+    layout.add (std::make_unique<juce::AudioParameterBool>(
+        juce::ParameterID { kParamHostLock, 1 },
+        "Host Lock",
+        false
+    ));
+
+    layout.add (std::make_unique<juce::AudioParameterBool>(
+        juce::ParameterID { kParamFollowHostTempo, 1 },
+        "Follow Host Tempo",
+        false
+    ));
+
+    layout.add (std::make_unique<juce::AudioParameterFloat>(
+        juce::ParameterID { kParamWorkBudget, 1 },
+        "Work Budget (ops)",
+        juce::NormalisableRange<float> { 64.0f, 65536.0f, 1.0f },
+        4096.0f
+    ));
+
+    layout.add (std::make_unique<juce::AudioParameterBool>(
+        juce::ParameterID { kParamEmbedReference, 1 },
+        "Embed Reference",
+        false
+    ));
+
+    layout.add (std::make_unique<juce::AudioParameterFloat>(
+        juce::ParameterID { kParamLinkGroup, 1 },
+        "Link Group",
+        juce::NormalisableRange<float> { 0.0f, static_cast<float> (FollowerLink::kNumGroups), 1.0f },
+        0.0f
+    ));
+
     return layout;
 }
 
@@ -213,28 +491,82 @@ uint32_t PluginProcessor::getMissedNoteOnCounter() const noexcept
     return missedNoteOnCounter.load (std::memory_order_relaxed);
 }
 
-int PluginProcessor::popUiNoteEvents (std::vector<UiNoteEvent>& dest, int maxEvents)
+int PluginProcessor::popUiNoteEvents (std::vector<UiNoteEvent>& dest, UiNoteSnapshot& snapshot)
 {
     dest.clear();
-    const int available = uiNoteFifo.getNumReady();
-    const int toRead = juce::jlimit (0, maxEvents, available);
-    if (toRead <= 0)
+    snapshot.valid = false;
+    snapshot.heldNotes.clear();
+
+    const juce::ScopedLock lock (realtimeBufferLock);
+    const int available = uiEventFifo.getNumReady();
+    if (available <= 0)
         return 0;
 
     int start1 = 0;
     int size1 = 0;
     int start2 = 0;
     int size2 = 0;
-    uiNoteFifo.prepareToRead (toRead, start1, size1, start2, size2);
+    uiEventFifo.prepareToRead (available, start1, size1, start2, size2);
+    const int totalWords = size1 + size2;
+
+    auto wordAt = [&](int index)
+    {
+        return index < size1 ? uiEventWords[static_cast<size_t> (start1 + index)]
+                             : uiEventWords[static_cast<size_t> (start2 + index - size1)];
+    };
+
+    // Records are published whole, so the ready region always ends on a record boundary.
+    int index = 0;
+    while (index + kUiRecordHeaderWords <= totalWords)
+    {
+        const uint64_t header = wordAt (index);
+        const uint64_t baseSample = wordAt (index + 1);
+        const int count = static_cast<int> (header & 0xffffffffu);
+        index += kUiRecordHeaderWords;
+        if (count < 0 || index + count > totalWords)
+            break;
+
+        if ((header >> 32) == kUiRecordSnapshot)
+        {
+            snapshot.valid = true;
+            snapshot.sample = baseSample;
+            snapshot.eventIndex = dest.size();
+            snapshot.heldNotes.clear();
+            for (int i = 0; i < count; ++i)
+                snapshot.heldNotes.push_back (unpackUiNote (wordAt (index + i), baseSample));
+        }
+        else
+        {
+            for (int i = 0; i < count; ++i)
+                dest.push_back (unpackUiNote (wordAt (index + i), baseSample));
+        }
+
+        index += count;
+    }
+
+    uiEventFifo.finishedRead (totalWords);
+    return static_cast<int> (dest.size());
+}
+
+uint32_t PluginProcessor::getDroppedUiNoteEventCount() const noexcept
+{
+    return droppedUiNoteEvents.load (std::memory_order_relaxed);
+}
+
+uint32_t PluginProcessor::getDegradedEventCount() const noexcept
+{
+    return degradedEventCounter.load (std::memory_order_relaxed);
+}
 
-    dest.reserve (static_cast<size_t> (size1 + size2));
-    for (int i = 0; i < size1; ++i)
-        dest.push_back (uiNoteEvents[static_cast<size_t> (start1 + i)]);
-    for (int i = 0; i < size2; ++i)
-        dest.push_back (uiNoteEvents[static_cast<size_t> (start2 + i)]);
+uint16_t PluginProcessor::getBypassChannelMask() const noexcept
+{
+    return bypassChannelMask.load (std::memory_order_relaxed);
+}
 
-    uiNoteFifo.finishedRead (size1 + size2);
-    return size1 + size2;
+void PluginProcessor::setBypassChannelMask (uint16_t mask)
+{
+    bypassChannelMask.store (mask, std::memory_order_relaxed);
+    apvts.state.setProperty (kBypassChannelsProperty, static_cast<int> (mask), nullptr);
 }
 
 uint64_t PluginProcessor::getTimelineSampleForUi() const noexcept
@@ -257,6 +589,27 @@ std::shared_ptr<const PluginProcessor::ReferenceDisplayData> PluginProcessor::ge
     return std::atomic_load (&referenceDisplayData);
 }
 
+uint32_t PluginProcessor::getUiChangeSequence() const noexcept
+{
+    return uiChangeSequence.load (std::memory_order_acquire);
+}
+
+uint32_t PluginProcessor::getReferenceChangeSequence() const noexcept
+{
+    return referenceChangeSequence.load (std::memory_order_acquire);
+}
+
+uint32_t PluginProcessor::getParameterChangeSequence() const noexcept
+{
+    return parameterChangeSequence.load (std::memory_order_acquire);
+}
+
+void PluginProcessor::parameterChanged (const juce::String&, float)
+{
+    // May arrive on the audio thread during automation, so only touch the counter.
+    parameterChangeSequence.fetch_add (1, std::memory_order_release);
+}
+
 bool PluginProcessor::isTransportPlaying() const noexcept
 {
     return transportPlaying.load (std::memory_order_relaxed);
@@ -279,7 +632,7 @@ float PluginProcessor::getReferenceBpm() const noexcept
 
 float PluginProcessor::getReferenceIoiMinMs() const noexcept
 {
-    if (auto reference = std::atomic_load (&referenceData))
+    if (auto reference = std::atomic_load (&pendingReference))
     {
         if (reference->minIoiSeconds > 0.0)
             return static_cast<float> (reference->minIoiSeconds * 1000.0);
@@ -289,7 +642,7 @@ float PluginProcessor::getReferenceIoiMinMs() const noexcept
 
 float PluginProcessor::getReferenceIoiMedianMs() const noexcept
 {
-    if (auto reference = std::atomic_load (&referenceData))
+    if (auto reference = std::atomic_load (&pendingReference))
     {
         if (reference->medianIoiSeconds > 0.0)
             return static_cast<float> (reference->medianIoiSeconds * 1000.0);
@@ -299,7 +652,7 @@ float PluginProcessor::getReferenceIoiMedianMs() const noexcept
 
 float PluginProcessor::getClusterWindowMs() const noexcept
 {
-    if (auto reference = std::atomic_load (&referenceData))
+    if (auto reference = std::atomic_load (&pendingReference))
         return static_cast<float> (reference->clusterWindowSeconds * 1000.0);
     return 0.0f;
 }
@@ -319,14 +672,51 @@ bool PluginProcessor::hasStartOffset() const noexcept
     return startOffsetValid.load (std::memory_order_relaxed);
 }
 
+float PluginProcessor::getCurrentSlackMs() const noexcept
+{
+    return currentSlackMs.load (std::memory_order_relaxed);
+}
+
+bool PluginProcessor::hasTempoEstimate() const noexcept
+{
+    return tempoEstimateValid.load (std::memory_order_relaxed);
+}
+
+float PluginProcessor::getTempoEstimateRatio() const noexcept
+{
+    return tempoEstimateRatio.load (std::memory_order_relaxed);
+}
+
+float PluginProcessor::getTempoEstimateDriftMs() const noexcept
+{
+    return tempoEstimateDriftMs.load (std::memory_order_relaxed);
+}
+
+float PluginProcessor::getTempoEstimateSpreadMs() const noexcept
+{
+    return tempoEstimateSpreadMs.load (std::memory_order_relaxed);
+}
+
 juce::String PluginProcessor::createMissLogReport() const
 {
     juce::String report;
     report << "Personalities Miss Log\n";
     report << "Reference: " << (referencePath.isNotEmpty() ? referencePath : "None") << "\n";
 
-    const auto count = missLogCount.load (std::memory_order_acquire);
+    const juce::ScopedLock lock (realtimeBufferLock);
+    const auto count = juce::jmin (missLogCount.load (std::memory_order_acquire),
+                                   static_cast<uint32_t> (missLog.capacity()));
     const bool overflow = missLogOverflow.load (std::memory_order_relaxed);
+    report << "Degraded events: " << static_cast<int> (degradedEventCounter.load (std::memory_order_relaxed)) << "\n";
+    report << "Thinned controller events: "
+           << static_cast<int> (thinnedControllerCounter.load (std::memory_order_relaxed)) << "\n";
+    report << "Dropped long messages: "
+           << static_cast<int> (droppedLongMessageCounter.load (std::memory_order_relaxed)) << "\n";
+    report << "Warm-up: " << juce::String (warmUpMs.load (std::memory_order_relaxed), 2) << " ms ("
+           << static_cast<int> (warmUpKiloBytes.load (std::memory_order_relaxed)) << " KB"
+           << (realtimeMemoryLocked.load (std::memory_order_relaxed) ? ", locked" : "") << "), reference "
+           << juce::String (referenceWarmUpMs.load (std::memory_order_relaxed), 2) << " ms ("
+           << static_cast<int> (referenceWarmUpKiloBytes.load (std::memory_order_relaxed)) << " KB)\n";
     report << "Entries: " << static_cast<int> (count);
     if (overflow)
         report << " (overflow)";
@@ -369,17 +759,7 @@ bool PluginProcessor::rebuildReferenceClusters (float clusterWindowMs, juce::Str
         ? static_cast<double> (clusterWindowMs) / 1000.0
         : 0.0;
 
-    auto baseReference = buildReferenceFromFile (juce::File (referencePath),
-        clusterWindowSeconds,
-        errorMessage);
-    if (baseReference == nullptr)
-        return false;
-
-    std::atomic_store (&referenceData, baseReference);
-    std::atomic_store (&referenceDisplayData, buildReferenceDisplayData (*baseReference));
-    referenceTempoIndex = 0;
-    clearMissLog();
-    resetPlaybackState();
+    requestReference (juce::File (referencePath), clusterWindowSeconds);
     return true;
 }
 
@@ -393,23 +773,23 @@ bool PluginProcessor::resetToDefaults (juce::String& errorMessage)
 
     referencePath.clear();
     apvts.state.setProperty (kReferencePathProperty, referencePath, nullptr);
-    pendingReferencePath.clear();
+    setBypassChannelMask (0);
     lastReferenceLoadError.clear();
 
-    std::atomic_store (&referenceData, std::shared_ptr<ReferenceData>());
-    std::atomic_store (&referenceDisplayData, std::shared_ptr<ReferenceDisplayData>());
+    referenceRequestSequence.fetch_add (1, std::memory_order_acq_rel);
+    queueReferenceSwap (nullptr);
+    publishReferenceDisplayData (nullptr);
 
-    referenceTempoIndex = 0;
-    queueSize = 0;
+    clearScheduledEvents();
     timelineSample = 0;
-    latchedSlackSamples = 0;
+    currentSlackSamples = 0;
+    resetAutoSlack (0);
+    currentSlackMs.store (0.0f, std::memory_order_relaxed);
     referenceTransportStartSample = 0;
     lastHostSample = -1;
     transportWasPlaying = false;
     userStartSampleCaptured = false;
-    uiNoteFifo.reset();
 
-    resetPlaybackState();
     clearMissLog();
     outputBuffer.clear();
 
@@ -442,22 +822,39 @@ void PluginProcessor::requestStartOffsetReset() noexcept
 
 void PluginProcessor::prepareToPlay (double newSampleRate, int samplesPerBlock)
 {
-    juce::ignoreUnused (samplesPerBlock);
-
     sampleRateHz = newSampleRate;
     sampleRateForUi.store (sampleRateHz, std::memory_order_relaxed);
+    TempoTracker::Settings trackerSettings;
+    trackerSettings.minPeriodSpan = static_cast<double> (msToSamples (sampleRateHz, kTempoTrackerMinSpanMs));
+    controllerWindowSamples = juce::jmax<uint64_t> (1, msToSamples (sampleRateHz, kControllerWindowMs));
+    tempoTracker.setSettings (trackerSettings);
+    allocateRealtimeBuffers (samplesPerBlock);
+    warmUpRealtimeMemory();
+
     timelineSample = 0;
     lastHostSample = -1;
     transportPlaying.store (false, std::memory_order_relaxed);
     transportWasPlaying = false;
     resetPlaybackState();
+    checkpointCount = 0;
     cpuLoadPercent.store (0.0f, std::memory_order_relaxed);
     hostBpm.store (-1.0f, std::memory_order_relaxed);
     referenceBpm.store (-1.0f, std::memory_order_relaxed);
     clearMissLog();
 
     outputBuffer.clear();
-    outputBuffer.ensureSize (kMaxOutputEvents * (kMaxMidiBytes + kMidiEventOverheadBytes));
+    outputBuffer.ensureSize (maxOutputEvents * (kMaxMidiBytes + kMidiEventOverheadBytes)
+                             + longMessageArena.capacity());
+
+    // Processing is stopped, so a reference still waiting to be swapped in can be published here.
+    const uint32_t swapSequence = referenceSwapSequence.load (std::memory_order_acquire);
+    if (swapSequence != adoptedSwapSequence)
+    {
+        adoptedSwapSequence = swapSequence;
+        std::atomic_store (&referenceData, std::atomic_load (&pendingReference));
+    }
+    std::atomic_store (&retiredReference, std::shared_ptr<ReferenceData>());
+    retiredReferencePending.store (false, std::memory_order_release);
 
     if (auto ref = std::atomic_load (&referenceData))
     {
@@ -468,14 +865,145 @@ void PluginProcessor::prepareToPlay (double newSampleRate, int samplesPerBlock)
             ref->matched.assign (ref->notes.size(), 0);
         if (ref->clusterMatchedCounts.size() != ref->clusters.size())
             ref->clusterMatchedCounts.assign (ref->clusters.size(), 0);
-
-        std::atomic_store (&referenceDisplayData, buildReferenceDisplayData (*ref));
+        warmUpReference (*ref);
     }
     updateUiTimelineState();
 }
 
 void PluginProcessor::releaseResources()
 {
+    releaseRealtimeBuffers();
+}
+
+void PluginProcessor::allocateRealtimeBuffers (int samplesPerBlock)
+{
+    // Everything in flight over the maximum delay plus one block, with a floor for tiny blocks.
+    const double maxDelaySeconds = kMaxSlackMs / 1000.0
+        + static_cast<double> (juce::jmax (0, samplesPerBlock)) / juce::jmax (1.0, sampleRateHz);
+    const auto capacityFor = [maxDelaySeconds] (double perSecond)
+    {
+        return juce::jmax (kMinScheduledEvents, static_cast<int> (std::ceil (maxDelaySeconds * perSecond)));
+    };
+
+    const int queueCapacity = capacityFor (kScheduledNotesPerSecond);
+    const int controlCapacity = capacityFor (kControlEventsPerSecond);
+    const int longMessageBytes = static_cast<int> (std::ceil (maxDelaySeconds * kLongMessageBytesPerSecond));
+    // The block staging area doubles as the held-note snapshot buffer, one slot per (channel, pitch).
+    const int uiBlockCapacity = juce::jmax (kUiHeldNoteSlots,
+                                            static_cast<int> (std::ceil (static_cast<double> (samplesPerBlock)
+                                                                         / juce::jmax (1.0, sampleRateHz)
+                                                                         * kScheduledNotesPerSecond)));
+
+    // One block header per block plus the notes of kUiRingSeconds, and room for a full held-note snapshot.
+    const double blocksPerSecond = juce::jmax (1.0, sampleRateHz) / juce::jmax (1, samplesPerBlock);
+    const int uiRingWords = static_cast<int> (std::ceil (kUiRingSeconds * (blocksPerSecond * kUiRecordHeaderWords
+                                                                           + kScheduledNotesPerSecond)))
+        + kUiHeldNoteSlots + kUiRecordHeaderWords;
+
+    const juce::ScopedLock lock (realtimeBufferLock);
+    realtimeArena.beginLayout();
+    const auto queueSlot = realtimeArena.add<ScheduledMidiEvent> (queueCapacity);
+    const auto controlSlot = realtimeArena.add<ScheduledMidiEvent> (controlCapacity);
+    const auto activeNoteSlot = realtimeArena.add<ActiveNote> (kMaxActiveNotes);
+    const auto uiBlockSlot = realtimeArena.add<UiNoteEvent> (uiBlockCapacity);
+    const auto missLogSlot = realtimeArena.add<MissLogEntry> (static_cast<int> (kMaxMissLogEntries));
+    const auto longMessageSlot = realtimeArena.add<uint8_t> (longMessageBytes);
+    const auto controllerSlot = realtimeArena.add<uint64_t> (kControllerKeyCount);
+    const auto controllerWindowSlot = realtimeArena.add<uint64_t> (kControllerKeyCount);
+    const auto uiRingSlot = realtimeArena.add<uint64_t> (uiRingWords);
+    const auto uiHeldSlot = realtimeArena.add<UiHeldNote> (kUiHeldNoteSlots);
+    const auto checkpointSlot = realtimeArena.add<FollowerCheckpoint> (kMaxCheckpoints);
+    realtimeArena.allocate();
+
+    queue = realtimeArena.bind (queueSlot);
+    controlQueue = realtimeArena.bind (controlSlot);
+    activeNotes = realtimeArena.bind (activeNoteSlot);
+    uiBlockNotes = realtimeArena.bind (uiBlockSlot);
+    missLog = realtimeArena.bind (missLogSlot);
+    longMessageArena = realtimeArena.bind (longMessageSlot);
+    controllerSlots = realtimeArena.bind (controllerSlot);
+    controllerSlotWindows = realtimeArena.bind (controllerWindowSlot);
+    uiEventWords = realtimeArena.bind (uiRingSlot);
+    uiHeldNotes = realtimeArena.bind (uiHeldSlot);
+    checkpoints = realtimeArena.bind (checkpointSlot);
+    uiEventFifo.setTotalSize (uiEventWords.capacity());
+    uiEventFifo.reset();
+    maxOutputEvents = queueCapacity + controlCapacity;
+
+    queueHead = 0;
+    queueSize = 0;
+    controlPopCount = controlPushCount;
+    longMessageWritePosition = 0;
+    longMessageReadPosition = 0;
+    activeNoteCount = 0;
+    uiBlockNoteCount = 0;
+    checkpointCount = 0;
+    missLogCount.store (0, std::memory_order_release);
+}
+
+void PluginProcessor::warmUpRealtimeMemory() noexcept
+{
+    // Runs before processing starts, so the audio-thread buffers can be written back freely.
+    const double startMs = juce::Time::getMillisecondCounterHiRes();
+    const bool locked = realtimeArena.prefault (kLockRealtimeMemory);
+    size_t bytes = realtimeArena.getAllocatedBytes();
+    bytes += prefaultArray (requiredDelayHistory);
+    bytes += prefaultArray (requiredDelayScratch);
+    bytes += prefaultArray (relocaliseCandidates);
+
+    warmUpMs.store (static_cast<float> (juce::Time::getMillisecondCounterHiRes() - startMs), std::memory_order_relaxed);
+    warmUpKiloBytes.store (static_cast<uint32_t> (bytes / 1024), std::memory_order_relaxed);
+    realtimeMemoryLocked.store (locked, std::memory_order_relaxed);
+}
+
+void PluginProcessor::warmUpReference (ReferenceData& reference) noexcept
+{
+    // Call before the reference is published (or with processing stopped): matched and the
+    // cluster counts are written back here and by the audio thread.
+    const double startMs = juce::Time::getMillisecondCounterHiRes();
+    size_t bytes = prefaultVector (reference.notes, false);
+    bytes += prefaultVector (reference.clusters, false);
+    bytes += prefaultVector (reference.tempoEvents, false);
+    bytes += prefaultVector (reference.matched, true);
+    bytes += prefaultVector (reference.clusterMatchedCounts, true);
+    if (reference.pitchIndex != nullptr)
+        reference.pitchIndex->forEachBuffer ([&bytes] (const void* data, size_t size)
+        {
+            bytes += prefaultBytes (data, size, false);
+        });
+
+    referenceWarmUpMs.store (static_cast<float> (juce::Time::getMillisecondCounterHiRes() - startMs),
+                             std::memory_order_relaxed);
+    referenceWarmUpKiloBytes.store (static_cast<uint32_t> (bytes / 1024), std::memory_order_relaxed);
+}
+
+void PluginProcessor::releaseRealtimeBuffers() noexcept
+{
+    // Idle instances give their buffers back; prepareToPlay allocates them again.
+    const juce::ScopedLock lock (realtimeBufferLock);
+    missLogCount.store (0, std::memory_order_release);
+    queueHead = 0;
+    queueSize = 0;
+    controlPopCount = controlPushCount;
+    longMessageWritePosition = 0;
+    longMessageReadPosition = 0;
+    activeNoteCount = 0;
+    uiBlockNoteCount = 0;
+    maxOutputEvents = 0;
+    queue = {};
+    controlQueue = {};
+    activeNotes = {};
+    uiBlockNotes = {};
+    missLog = {};
+    longMessageArena = {};
+    controllerSlots = {};
+    controllerSlotWindows = {};
+    uiEventWords = {};
+    uiHeldNotes = {};
+    checkpoints = {};
+    checkpointCount = 0;
+    uiEventFifo.reset();
+    realtimeArena.release();
 }
 
 bool PluginProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
@@ -504,7 +1032,7 @@ void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::Midi
     const bool isMuted = (muteParam != nullptr) && (muteParam->load() >= 0.5f);
     const bool isBypassed = (bypassParam != nullptr) && (bypassParam->load() >= 0.5f);
     if (isMuted || isBypassed)
-        queueSize = 0;
+        clearScheduledEvents();
 
     const int numSamples = buffer.getNumSamples();
     auto updateCpuLoad = [this, cpuStartTick, numSamples]()
@@ -528,6 +1056,8 @@ void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::Midi
     bool isPlaying = false;
     int64_t hostSample = -1;
     float hostBpmValue = -1.0f;
+    double hostPpqPosition = 0.0;
+    bool hasHostPpqPosition = false;
 
     if (auto* playhead = getPlayHead())
     {
@@ -540,6 +1070,12 @@ void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::Midi
 
             if (auto bpm = position->getBpm())
                 hostBpmValue = static_cast<float> (*bpm);
+
+            if (auto ppq = position->getPpqPosition())
+            {
+                hostPpqPosition = *ppq;
+                hasHostPpqPosition = true;
+            }
         }
     }
 
@@ -550,6 +1086,8 @@ void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::Midi
     {
         userStartSampleCaptured = false;
         userStartSample = 0;
+        tempoTracker.reset();
+        tempoEstimator.reset();
         startOffsetMs.store (0.0f, std::memory_order_relaxed);
         startOffsetBars.store (0.0f, std::memory_order_relaxed);
         startOffsetValid.store (false, std::memory_order_relaxed);
@@ -566,24 +1104,69 @@ void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::Midi
         ? static_cast<int> (std::lround (pitchToleranceParam->load()))
         : 0;
 
+    auto reference = std::atomic_load (&referenceData);
+    adoptPendingReference (reference);
+    const bool hostLocked = hostSample >= 0
+        && hostLockParam != nullptr
+        && hostLockParam->load() >= 0.5f;
+
+    // Follow Host Tempo: reference time runs in quarter notes at the host tempo instead of in seconds.
+    const bool followHostTempo = reference != nullptr
+        && reference->sampleTimesValid
+        && ! reference->tempoEvents.empty()
+        && hostBpmValue > 0.0f
+        && sampleRateHz > 0.0
+        && followHostTempoParam != nullptr
+        && followHostTempoParam->load() >= 0.5f;
+
+    // Where the host playhead sits in the reference, for Host Lock seeks.
+    auto hostReferenceSeconds = [&](uint64_t position)
+    {
+        if (followHostTempo && hasHostPpqPosition)
+            return referenceBeatsToSeconds (*reference, hostPpqPosition);
+        return sampleRateHz > 0.0 ? static_cast<double> (position) / sampleRateHz : 0.0;
+    };
+
+    const uint32_t referenceSequence = referenceChangeSequence.load (std::memory_order_acquire);
+    if (referenceSequence != checkpointReferenceSequence)
+    {
+        checkpointReferenceSequence = referenceSequence;
+        checkpointCount = 0;
+    }
+
     if (isPlaying)
     {
         if (! transportWasPlaying)
         {
             resetPlaybackState();
             clearMissLog();
-            latchedSlackSamples = msToSamples (sampleRateHz, slackMs);
+            resetAutoSlack (msToSamples (sampleRateHz, slackMs));
             timelineSample = (hostSample >= 0) ? static_cast<uint64_t> (hostSample) : 0;
-            referenceTransportStartSample = timelineSample;
+            anchorReferenceAt (reference.get(), timelineSample, reference != nullptr ? reference->firstNoteTimeSeconds : 0.0);
             playbackStartSample = timelineSample;
+            linkFollowAfterSample = timelineSample;
+            if (hostLocked)
+                seekToHostSample (reference.get(), timelineSample, hostReferenceSeconds (timelineSample));
         }
         else if (hostSample >= 0 && lastHostSample >= 0 && hostSample < lastHostSample)
         {
             resetPlaybackState();
             clearMissLog();
             timelineSample = static_cast<uint64_t> (hostSample);
-            referenceTransportStartSample = timelineSample;
+            anchorReferenceAt (reference.get(), timelineSample, reference != nullptr ? reference->firstNoteTimeSeconds : 0.0);
+            playbackStartSample = timelineSample;
+            linkFollowAfterSample = timelineSample;
+            if (hostLocked)
+                seekToHostSample (reference.get(), timelineSample, hostReferenceSeconds (timelineSample));
+        }
+        else if (hostLocked && static_cast<uint64_t> (hostSample) > timelineSample + static_cast<uint64_t> (numSamples))
+        {
+            // Jumped forward: hosts do not report this as a restart.
+            resetPlaybackState();
+            timelineSample = static_cast<uint64_t> (hostSample);
             playbackStartSample = timelineSample;
+            linkFollowAfterSample = timelineSample;
+            seekToHostSample (reference.get(), timelineSample, hostReferenceSeconds (timelineSample));
         }
     }
     else if (transportWasPlaying)
@@ -592,16 +1175,39 @@ void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::Midi
         referenceTransportStartSample = 0;
     }
 
+    // Engines only switch between blocks; a newly selected follower starts from the cluster cursor.
+    const auto requestedEngine = static_cast<FollowerEngine> ((followerEngineParam != nullptr)
+        ? juce::jlimit (0, 2, static_cast<int> (std::lround (followerEngineParam->load())))
+        : 0);
+    if (requestedEngine != activeFollowerEngine)
+    {
+        activeFollowerEngine = requestedEngine;
+        hmmFollower.reset (referenceClusterCursor);
+        dtwFollower.reset (referenceClusterCursor);
+        clusterMissStreak = 0;
+    }
+
     const uint64_t blockStart = (isPlaying && hostSample >= 0)
         ? static_cast<uint64_t> (hostSample)
         : timelineSample;
     const uint64_t blockEnd = blockStart + static_cast<uint64_t> (numSamples);
 
+    // Joining, leaving or switching link group starts from this instance's own position.
+    const int linkGroup = (linkGroupParam != nullptr)
+        ? juce::jlimit (0, FollowerLink::kNumGroups, static_cast<int> (std::lround (linkGroupParam->load())))
+        : 0;
+    if (linkGroup != activeLinkGroup)
+    {
+        activeLinkGroup = linkGroup;
+        linkedChannelMask = 0;
+        linkFollowAfterSample = blockStart;
+    }
+
     float correction = isPlaying && (correctionParam != nullptr) ? correctionParam->load() : 0.0f;
     correction = juce::jlimit (0.0f, 1.0f, correction);
 
-    const uint64_t slackSamples = isPlaying ? latchedSlackSamples : msToSamples (sampleRateHz, slackMs);
-    auto reference = std::atomic_load (&referenceData);
+    const uint64_t maxSlackSamples = msToSamples (sampleRateHz, slackMs);
+    uint64_t targetSlackSamples = maxSlackSamples;
     const bool hasReference = isPlaying
         && reference != nullptr
         && reference->sampleTimesValid
@@ -609,507 +1215,1161 @@ void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::Midi
         && ! reference->clusters.empty();
     const float effectiveCorrection = hasReference ? correction : 0.0f;
     const uint64_t referenceStartSample = hasReference ? reference->firstNoteSample : 0;
-    const bool velocityCorrectionEnabled = (velocityCorrectionParam == nullptr)
-        || (velocityCorrectionParam->load() >= 0.5f);
-    const bool dropExtraNotes = hasReference;
-    const int clampedExtraNoteBudget = juce::jmax (0, extraNoteBudget);
-    const float clusterWindowMs = hasReference
-        ? static_cast<float> (reference->clusterWindowSeconds * 1000.0)
-        : 0.0f;
-    int maxLookaheadClusters = 0;
-    if (hasReference && clusterWindowMs > 0.0f)
+
+    // Carry the beat anchor to the block start at the tempo it ran at. Turning the mode on or off
+    // re-derives one anchor from the other so alignment does not jump.
+    if (hasReference)
     {
-        float slackMsForLookahead = slackMs;
-        if (sampleRateHz > 0.0 && isPlaying)
+        if (tempoAnchorSample < blockStart)
         {
-            slackMsForLookahead = static_cast<float> (1000.0
-                * (static_cast<double> (latchedSlackSamples) / sampleRateHz));
+            tempoAnchorBeat += static_cast<double> (blockStart - tempoAnchorSample) * tempoAnchorBeatsPerSample;
+            tempoAnchorSample = blockStart;
         }
 
-        const double lookaheadMs = static_cast<double> (slackMsForLookahead)
-            + static_cast<double> (clusterWindowMs);
-        const int slackBased = static_cast<int> (
-            std::ceil (lookaheadMs / static_cast<double> (clusterWindowMs)));
-        maxLookaheadClusters = juce::jlimit (1, kMaxClusterLookahead, slackBased);
+        if (followHostTempo && ! followingHostTempo)
+        {
+            const double elapsedSeconds = (static_cast<double> (blockStart)
+                - static_cast<double> (referenceTransportStartSample)) / sampleRateHz;
+            anchorReferenceAt (reference.get(), blockStart, reference->firstNoteTimeSeconds + elapsedSeconds);
+        }
+        else if (! followHostTempo && followingHostTempo)
+        {
+            anchorReferenceAt (reference.get(), blockStart, referenceBeatsToSeconds (*reference, tempoAnchorBeat));
+        }
     }
-    const ReferenceData* referenceForOffset = hasReference ? reference.get() : nullptr;
-    auto captureStartOffsetIfNeeded = [&](uint64_t userSample)
-    {
-        if (! isPlaying || userStartSampleCaptured)
-            return;
 
-        userStartSampleCaptured = true;
-        userStartSample = userSample;
-        referenceTransportStartSample = userSample;
-        referenceTempoIndex = 0;
+    followingHostTempo = hasReference && followHostTempo;
+    tempoAnchorBeatsPerSample = followingHostTempo
+        ? static_cast<double> (hostBpmValue) / (60.0 * sampleRateHz)
+        : 0.0;
 
-        double offsetSeconds = 0.0;
-        if (sampleRateHz > 0.0 && userSample >= playbackStartSample)
+    // Host Lock: host time is reference time, so each reference note plays at its own position.
+    if (hasReference && hostLocked)
+    {
+        referenceTransportStartSample = referenceStartSample;
+        if (followingHostTempo && hasHostPpqPosition)
         {
-            offsetSeconds = static_cast<double> (userSample - playbackStartSample) / sampleRateHz;
+            tempoAnchorSample = blockStart;
+            tempoAnchorBeat = hostPpqPosition;
         }
+        recordCheckpoint (blockStart);
+    }
 
-        startOffsetMs.store (static_cast<float> (offsetSeconds * 1000.0), std::memory_order_relaxed);
+    // Linked instances share host time, so only follow the group with a host position.
+    const bool linked = hasReference && linkGroup > 0 && hostSample >= 0;
+    if (linked)
+        followLinkedPosition (*reference, linkGroup, blockEnd);
 
-        float offsetBarsValue = 0.0f;
-        if (referenceForOffset != nullptr && referenceForOffset->barDurationSeconds > 0.0)
-            offsetBarsValue = static_cast<float> (offsetSeconds / referenceForOffset->barDurationSeconds);
+    const bool predictiveOutput = hasReference
+        && predictiveOutputParam != nullptr
+        && predictiveOutputParam->load() >= 0.5f;
 
-        startOffsetBars.store (offsetBarsValue, std::memory_order_relaxed);
-        startOffsetValid.store (true, std::memory_order_relaxed);
-    };
+    const bool autoSlackEnabled = isPlaying
+        && autoSlackParam != nullptr
+        && autoSlackParam->load() >= 0.5f;
+
+    // Predictive mode only holds notes back by as much as the tracker's recent lateness needs.
+    if (predictiveOutput)
+    {
+        targetSlackSamples = static_cast<uint64_t> (std::llround (tempoTracker.getPredictiveSlack (
+            static_cast<double> (effectiveCorrection),
+            static_cast<double> (maxSlackSamples))));
+    }
+    else if (autoSlackEnabled)
+    {
+        // Retarget between phrases; Slack stays the ceiling.
+        const bool phraseGap = activeNoteCount == 0
+            && blockStart >= lastNoteInputSample + msToSamples (sampleRateHz, kAutoSlackPhraseGapMs);
+        if (autoSlackRetargetPending && phraseGap && requiredDelayCount >= kMinAutoSlackHistory)
+        {
+            const float percentile = (autoSlackPercentileParam != nullptr)
+                ? autoSlackPercentileParam->load()
+                : 98.0f;
+            autoSlackTargetSamples = computeRequiredDelayPercentile (percentile);
+            autoSlackRetargetPending = false;
+        }
+
+        targetSlackSamples = juce::jmin (autoSlackTargetSamples, maxSlackSamples);
+    }
 
+    // Queued events hold their pre-slack time and pick up the slack in effect when they are emitted.
+    // With nothing queued the slack can jump; otherwise it slews linearly across the block.
+    if (! hasScheduledEvents())
+        currentSlackSamples = targetSlackSamples;
+
+    const uint64_t slackStartSamples = currentSlackSamples;
+    const uint64_t maxSlackStep = static_cast<uint64_t> (
+        std::floor (static_cast<double> (numSamples) * kSlackSlewRate));
+    uint64_t slackEndSamples = slackStartSamples;
+    if (targetSlackSamples > slackStartSamples)
+        slackEndSamples += juce::jmin (maxSlackStep, targetSlackSamples - slackStartSamples);
+    else
+        slackEndSamples -= juce::jmin (maxSlackStep, slackStartSamples - targetSlackSamples);
+
+    currentSlackMs.store (sampleRateHz > 0.0
+        ? static_cast<float> (1000.0 * static_cast<double> (slackEndSamples) / sampleRateHz)
+        : 0.0f, std::memory_order_relaxed);
+
+    BlockContext context;
+    context.reference = hasReference ? reference.get() : nullptr;
+    context.blockStart = blockStart;
+    context.referenceStartSample = referenceStartSample;
+    context.slackMs = slackMs;
+    context.missingTimeoutMs = missingTimeoutMs;
+    context.correction = correction;
+    context.effectiveCorrection = effectiveCorrection;
+    context.hostBpm = hostBpmValue;
+    context.pitchTolerance = pitchTolerance;
+    context.extraNoteBudget = juce::jmax (0, extraNoteBudget);
+    context.bypassChannelMask = bypassChannelMask.load (std::memory_order_relaxed);
+    context.linkGroup = linked ? linkGroup : 0;
+    context.workRemaining = (workBudgetParam != nullptr)
+        ? static_cast<int> (std::lround (workBudgetParam->load()))
+        : 4096;
+    context.isPlaying = isPlaying;
+    context.isMuted = isMuted;
+    context.isBypassed = isBypassed;
+    context.hostLocked = hasReference && hostLocked;
+    context.followHostTempo = followingHostTempo;
+    context.hostBeatsPerSample = tempoAnchorBeatsPerSample;
+    context.predictiveOutput = predictiveOutput;
+    context.velocityCorrection = (velocityCorrectionParam == nullptr)
+        || (velocityCorrectionParam->load() >= 0.5f);
+    context.clusterWindowMs = hasReference
+        ? static_cast<float> (reference->clusterWindowSeconds * 1000.0)
+        : 0.0f;
     float referenceBpmValue = -1.0f;
     if (hasReference && sampleRateHz > 0.0 && ! reference->tempoEvents.empty())
     {
         const double elapsedSeconds = (blockStart >= referenceTransportStartSample)
             ? static_cast<double> (blockStart - referenceTransportStartSample) / sampleRateHz
             : 0.0;
-        const double referenceTimeSeconds = reference->firstNoteTimeSeconds + elapsedSeconds;
+        // The beat anchor sits at the block start once carried forward.
+        const double referenceTimeSeconds = followingHostTempo
+            ? referenceBeatsToSeconds (*reference, tempoAnchorBeat)
+            : reference->firstNoteTimeSeconds + elapsedSeconds;
         const auto& tempoEvents = reference->tempoEvents;
-        const int numTempoEvents = static_cast<int> (tempoEvents.size());
-
-        if (referenceTempoIndex >= numTempoEvents)
-            referenceTempoIndex = numTempoEvents - 1;
-        if (referenceTempoIndex < 0)
-            referenceTempoIndex = 0;
-
-        while (referenceTempoIndex + 1 < numTempoEvents
-            && referenceTimeSeconds >= tempoEvents[static_cast<size_t> (referenceTempoIndex + 1)].timeSeconds)
-        {
-            ++referenceTempoIndex;
-        }
-
-        while (referenceTempoIndex > 0
-            && referenceTimeSeconds < tempoEvents[static_cast<size_t> (referenceTempoIndex)].timeSeconds)
-        {
-            --referenceTempoIndex;
-        }
-
+        referenceTempoIndex = findTempoSegment (tempoEvents, referenceTimeSeconds, referenceTempoIndex,
+            [](const ReferenceTempoEvent& event) { return event.timeSeconds; });
         referenceBpmValue = static_cast<float> (tempoEvents[static_cast<size_t> (referenceTempoIndex)].bpm);
     }
 
     referenceBpm.store (referenceBpmValue, std::memory_order_relaxed);
+    context.referenceBpm = referenceBpmValue;
 
-    auto markCurrentClusterMissing = [&](ReferenceData& ref) -> bool
+    // Once primed, the tempo estimate stands in for raw elapsed time (Host Lock and Follow Host
+    // Tempo pin reference time to the host instead). Its spread at the cursor widens the windows.
+    if (hasReference && sampleRateHz > 0.0 && ! hostLocked && ! followingHostTempo && tempoEstimator.isPrimed())
     {
-        const auto totalClusters = static_cast<int> (ref.clusters.size());
-        if (referenceClusterCursor >= totalClusters)
-            return false;
-        if (ref.matched.size() != ref.notes.size())
-            return false;
-        if (ref.clusterMatchedCounts.size() != ref.clusters.size())
-            return false;
+        const int totalClusters = static_cast<int> (reference->clusters.size());
+        const int cursor = juce::jlimit (0, juce::jmax (0, totalClusters - 1), referenceClusterCursor);
+        const double cursorSeconds = totalClusters > 0
+            ? reference->clusters[static_cast<size_t> (cursor)].startTimeSeconds
+                - static_cast<double> (referenceStartSample) / sampleRateHz
+            : 0.0;
+        context.useTempoEstimate = true;
+        context.tempoRatio = tempoEstimator.getTempoRatio();
+        context.estimateSpreadSamples = juce::jmin (msToSamples (sampleRateHz, kMaxTempoSpreadMs),
+            static_cast<uint64_t> (std::llround (tempoEstimator.getSpread (cursorSeconds) * sampleRateHz)));
+    }
 
-        const int totalNotes = static_cast<int> (ref.notes.size());
-        const auto& cluster = ref.clusters[static_cast<size_t> (referenceClusterCursor)];
-        const int startIndex = cluster.startIndex;
-        const int endIndex = startIndex + cluster.noteCount;
-        if (startIndex < 0 || endIndex > totalNotes)
-            return false;
+    if (hasReference && context.clusterWindowMs > 0.0f)
+    {
+        // Under Follow Host Tempo or a tempo estimate a cluster window lasts longer or shorter
+        // on the user's timeline.
+        const double tempoScale = (followingHostTempo && referenceBpmValue > 0.0f)
+            ? static_cast<double> (referenceBpmValue) / static_cast<double> (hostBpmValue)
+            : context.tempoRatio;
+        const double windowMs = static_cast<double> (context.clusterWindowMs) * tempoScale;
+        const double spreadMs = sampleRateHz > 0.0
+            ? 1000.0 * static_cast<double> (context.estimateSpreadSamples) / sampleRateHz
+            : 0.0;
+        const double lookaheadMs = static_cast<double> (slackMs) + spreadMs + windowMs;
+        const int slackBased = static_cast<int> (std::ceil (lookaheadMs / windowMs));
+        context.maxLookaheadClusters = juce::jlimit (1, kMaxClusterLookahead, slackBased);
+    }
 
-        int missingCount = 0;
-        for (int i = startIndex; i < endIndex; ++i)
-        {
-            if (ref.matched[static_cast<size_t> (i)] == 0)
+    processMidiEvents (context, midi);
+
+    if (isBypassed)
+    {
+        if (isMuted)
+            midi.clear();
+
+        timelineSample = blockEnd;
+        lastHostSample = hostSample;
+        transportWasPlaying = isPlaying;
+        flushUiNoteEvents (blockStart);
+        updateCpuLoad();
+        updateUiTimelineState();
+        return;
+    }
+
+    // An event is due at the first offset k where base + slack(k) <= blockStart + k. Slack changes
+    // by less than one sample per sample, so due offsets stay in base order and the scan stops early.
+    const double slackSlope = (numSamples > 0)
+        ? (static_cast<double> (slackEndSamples) - static_cast<double> (slackStartSamples))
+            / static_cast<double> (numSamples)
+        : 0.0;
+
+    while (! isMuted)
+    {
+        // Merge the note and control queues by base sample, then arrival order.
+        const bool hasNote = queueSize > 0;
+        const bool hasControl = controlPushCount > controlPopCount;
+        if (! hasNote && ! hasControl)
+            break;
+
+        const auto& controlHead = controlQueue[static_cast<size_t> (controlPopCount % static_cast<uint64_t> (controlQueue.capacity()))];
+        const auto& noteHead = scheduledEventAt (0);
+        const bool takeControl = hasControl
+            && (! hasNote
+                || controlHead.baseSample < noteHead.baseSample
+                || (controlHead.baseSample == noteHead.baseSample && controlHead.order < noteHead.order));
+        const auto& event = takeControl ? controlHead : noteHead;
+
+        const double lead = static_cast<double> (event.baseSample)
+            + static_cast<double> (slackStartSamples)
+            - static_cast<double> (blockStart);
+        const double dueOffset = (lead > 0.0) ? std::ceil (lead / (1.0 - slackSlope)) : 0.0;
+        if (dueOffset >= static_cast<double> (numSamples))
+            break;
+
+        const int sampleOffset = static_cast<int> (dueOffset);
+
+        if ((event.flags & kScheduledEventArenaFlag) != 0)
+        {
+            // The output buffer reserves the whole arena, so this never allocates.
+            const auto* bytes = longMessageArena.data()
+                + event.arenaStart % static_cast<uint64_t> (longMessageArena.capacity());
+            if (context.outputEventCount < maxOutputEvents)
             {
-                ref.matched[static_cast<size_t> (i)] = 1;
-                ++missingCount;
+                outputBuffer.addEvent (bytes, static_cast<int> (event.arenaSize), sampleOffset);
+                ++context.outputEventCount;
             }
+            longMessageReadPosition = event.arenaStart + event.arenaSize;
+        }
+        else if (context.outputEventCount < maxOutputEvents)
+        {
+            outputBuffer.addEvent (event.data, event.size, sampleOffset);
+            countOutputNoteOn (event.data, event.size);
+            ++context.outputEventCount;
         }
 
-        if (missingCount > 0)
-            missedNoteOnCounter.fetch_add (missingCount, std::memory_order_relaxed);
+        if (takeControl)
+        {
+            ++controlPopCount;
+            continue;
+        }
 
-        ref.clusterMatchedCounts[static_cast<size_t> (referenceClusterCursor)] = cluster.noteCount;
-        clusterMissStreak = 0;
-        advanceClusterCursor (ref);
-        extraNoteStreak = 0;
-        return true;
-    };
+        queueHead = (queueHead + 1) % queue.capacity();
+        --queueSize;
+    }
+
+    currentSlackSamples = slackEndSamples;
+    midi.swapWith (outputBuffer);
+    timelineSample = blockEnd;
+    lastHostSample = hostSample;
+    transportWasPlaying = isPlaying;
+    flushUiNoteEvents (blockStart);
+    updateCpuLoad();
+    updateUiTimelineState();
+}
 
-    auto skipExpiredClusters = [&]()
+//==============================================================================
+struct PluginProcessor::ClusterCursorMatch
+{
+    template <typename PitchPolicy>
+    static int match (PluginProcessor& processor,
+                      ReferenceData& reference,
+                      int noteNumber,
+                      int channel,
+                      const BlockContext& context) noexcept
     {
-        if (! hasReference || missingTimeoutMs <= 0.0f || sampleRateHz <= 0.0)
-            return;
+        return processor.matchReferenceNoteInCluster<PitchPolicy> (noteNumber,
+            channel,
+            context.pitchTolerance,
+            reference,
+            context.maxLookaheadClusters);
+    }
+
+    static int cost (const BlockContext& context) noexcept
+    {
+        return context.maxLookaheadClusters + 1;
+    }
+};
+
+struct PluginProcessor::HmmMatch
+{
+    template <typename PitchPolicy>
+    static int match (PluginProcessor& processor,
+                      ReferenceData& reference,
+                      int noteNumber,
+                      int channel,
+                      const BlockContext& context) noexcept
+    {
+        return processor.matchReferenceNoteWithFollower (processor.hmmFollower,
+            noteNumber,
+            channel,
+            PitchPolicy::tolerance (context.pitchTolerance),
+            reference);
+    }
+
+    static int cost (const BlockContext&) noexcept
+    {
+        return HmmFollower<ReferenceData>::kBeamWidth;
+    }
+};
 
-        const uint64_t timeoutSamples = msToSamples (sampleRateHz, missingTimeoutMs);
-        const auto totalClusters = static_cast<int> (reference->clusters.size());
+struct PluginProcessor::DtwMatch
+{
+    template <typename PitchPolicy>
+    static int match (PluginProcessor& processor,
+                      ReferenceData& reference,
+                      int noteNumber,
+                      int channel,
+                      const BlockContext& context) noexcept
+    {
+        return processor.matchReferenceNoteWithFollower (processor.dtwFollower,
+            noteNumber,
+            channel,
+            PitchPolicy::tolerance (context.pitchTolerance),
+            reference);
+    }
 
-        while (referenceClusterCursor < totalClusters)
+    static int cost (const BlockContext&) noexcept
+    {
+        return DtwFollower<ReferenceData>::kBandWidth;
+    }
+};
+
+// The cursor gives up on a cluster after kMaxClusterMissStreak unmatched notes.
+struct PluginProcessor::ClusterMissStreak
+{
+    static void onMiss (PluginProcessor& processor, ReferenceData& reference) noexcept
+    {
+        processor.handleClusterMiss (reference);
+    }
+};
+
+// The HMM and DTW followers account for extra notes themselves.
+struct PluginProcessor::FollowerAbsorbsMisses
+{
+    static void onMiss (PluginProcessor&, ReferenceData&) noexcept {}
+};
+
+struct PluginProcessor::NoMissingTimeout
+{
+    static void skipExpiredClusters (PluginProcessor&, const BlockContext&) noexcept {}
+};
+
+struct PluginProcessor::MissingTimeout
+{
+    static void skipExpiredClusters (PluginProcessor& processor, const BlockContext& context) noexcept
+    {
+        auto& reference = *context.reference;
+        // The timeout is in reference time; stretch it to the user's tempo and allow for the estimate's spread.
+        const uint64_t timeoutSamples = msToSamples (processor.sampleRateHz,
+                static_cast<float> (context.missingTimeoutMs * context.tempoRatio))
+            + context.estimateSpreadSamples;
+        const auto totalClusters = static_cast<int> (reference.clusters.size());
+
+        while (processor.referenceClusterCursor < totalClusters)
         {
-            const auto& cluster = reference->clusters[static_cast<size_t> (referenceClusterCursor)];
+            const auto& cluster = reference.clusters[static_cast<size_t> (processor.referenceClusterCursor)];
             const uint64_t clusterEndSample = static_cast<uint64_t> (
-                std::llround (cluster.endTimeSeconds * sampleRateHz));
-            uint64_t alignedClusterEnd = referenceTransportStartSample;
-            if (clusterEndSample >= referenceStartSample)
-                alignedClusterEnd += (clusterEndSample - referenceStartSample);
+                std::llround (cluster.endTimeSeconds * processor.sampleRateHz));
+            const uint64_t alignedClusterEnd = processor.alignReferenceSample (context,
+                clusterEndSample,
+                processor.referenceTransportStartSample);
 
-            if (blockStart <= alignedClusterEnd + timeoutSamples)
+            if (context.blockStart <= alignedClusterEnd + timeoutSamples)
                 break;
 
-            if (! markCurrentClusterMissing (*reference))
+            if (! processor.markCurrentClusterMissing (reference))
                 break;
         }
-    };
+    }
+};
 
-    skipExpiredClusters();
+struct PluginProcessor::ExactPitch
+{
+    static constexpr bool allowsNeighbours = false;
 
-    if (isBypassed)
+    static int tolerance (int) noexcept
     {
-        for (const auto metadata : midi)
-        {
-            if (metadata.numBytes < 3)
-                continue;
+        return 0;
+    }
+};
 
-            const int sampleOffset = metadata.samplePosition;
-            const int clampedOffset = juce::jmax (0, sampleOffset);
-            const uint64_t userSample = blockStart + static_cast<uint64_t> (clampedOffset);
+struct PluginProcessor::TolerantPitch
+{
+    static constexpr bool allowsNeighbours = true;
 
-            const uint8_t* data = metadata.data;
-            const uint8_t status = static_cast<uint8_t> (data[0] & 0xF0);
+    static int tolerance (int pitchTolerance) noexcept
+    {
+        return juce::jmax (0, pitchTolerance);
+    }
+};
 
-            if (status == 0x90 && data[2] > 0)
-            {
-                captureStartOffsetIfNeeded (userSample);
-                inputNoteOnCounter.fetch_add (1, std::memory_order_relaxed);
-                lastTimingDeltaMs.store (0.0f, std::memory_order_relaxed);
-                lastVelocityDelta.store (0.0f, std::memory_order_relaxed);
-                if (! isMuted)
-                    outputNoteOnCounter.fetch_add (1, std::memory_order_relaxed);
+template <typename Strategy, typename MissPolicy, typename TimeoutPolicy, typename PitchPolicy>
+struct PluginProcessor::Matcher
+{
+    static int match (PluginProcessor& processor,
+                      ReferenceData& reference,
+                      int noteNumber,
+                      int channel,
+                      const BlockContext& context) noexcept
+    {
+        return Strategy::template match<PitchPolicy> (processor, reference, noteNumber, channel, context);
+    }
 
-                const int channel = (data[0] & 0x0F) + 1;
-                int refIndex = -1;
-                int referenceVelocityForStats = -1;
+    // Takes the cost of matching one note-on from the block's budget; false once it runs out.
+    static bool spendMatchWork (BlockContext& context) noexcept
+    {
+        const int cost = Strategy::cost (context);
+        if (context.workRemaining < cost)
+            return false;
+        context.workRemaining -= cost;
+        return true;
+    }
 
-                if (hasReference)
-                {
-                    refIndex = matchReferenceNoteInCluster (static_cast<int> (data[1]),
-                        channel,
-                        pitchTolerance,
-                        *reference,
-                        maxLookaheadClusters);
-                    if (refIndex >= 0)
-                    {
-                        matchedNoteOnCounter.fetch_add (1, std::memory_order_relaxed);
-                        const uint64_t noteOrder = noteOnOrderCounter++;
-                        if (activeNoteCount < kMaxActiveNotes)
-                            activeNotes[activeNoteCount++] = { static_cast<int> (data[1]), channel, refIndex, noteOrder };
-                        if (refIndex < static_cast<int> (reference->notes.size()))
-                            referenceVelocityForStats = reference->notes[static_cast<size_t> (refIndex)].onVelocity;
-                    }
-                    else
-                    {
-                        missedNoteOnCounter.fetch_add (1, std::memory_order_relaxed);
-                        logMiss (static_cast<int> (data[1]),
-                            static_cast<int> (data[2]),
-                            channel,
-                            userSample,
-                            slackMs,
-                            clusterWindowMs,
-                            correction,
-                            hostBpmValue,
-                            referenceBpmValue);
-                        handleClusterMiss (*reference);
-                    }
-                }
+    static void onMiss (PluginProcessor& processor, ReferenceData& reference) noexcept
+    {
+        MissPolicy::onMiss (processor, reference);
+    }
 
-                pushUiNoteEvent (userSample, static_cast<int> (data[1]), channel, refIndex, true);
-                updateVelocityStats (data[2], referenceVelocityForStats);
-            }
-            else if (status == 0x80 || (status == 0x90 && data[2] == 0))
-            {
-                lastNoteOffDeltaMs.store (0.0f, std::memory_order_relaxed);
-                const int channel = (data[0] & 0x0F) + 1;
-                int refIndex = -1;
-                if (hasReference)
-                    refIndex = removeOldestActiveNote (static_cast<int> (data[1]), channel);
-                pushUiNoteEvent (userSample, static_cast<int> (data[1]), channel, refIndex, false);
-            }
-        }
+    static void skipExpiredClusters (PluginProcessor& processor, const BlockContext& context) noexcept
+    {
+        TimeoutPolicy::skipExpiredClusters (processor, context);
+    }
+};
 
-        if (isMuted)
-            midi.clear();
+struct PluginProcessor::ReferenceClockAlignment
+{
+    static constexpr bool predictive = false;
 
-        timelineSample = blockEnd;
-        lastHostSample = hostSample;
-        transportWasPlaying = isPlaying;
-        updateCpuLoad();
-        updateUiTimelineState();
-        return;
+    static uint64_t align (PluginProcessor& processor, const BlockContext&, uint64_t referenceOffset, uint64_t) noexcept
+    {
+        return processor.referenceTransportStartSample + referenceOffset;
     }
+};
 
-    int outputEventCount = 0;
+struct PluginProcessor::TempoEstimateAlignment
+{
+    static constexpr bool predictive = false;
 
-    auto countOutputNoteOn = [&](const uint8_t* data, uint8_t size)
+    static uint64_t align (PluginProcessor& processor, const BlockContext&, uint64_t referenceOffset, uint64_t) noexcept
     {
-        if (size < 3)
-            return;
-        if ((data[0] & 0xF0) == 0x90 && data[2] > 0)
-            outputNoteOnCounter.fetch_add (1, std::memory_order_relaxed);
-    };
+        const double sampleRate = processor.sampleRateHz;
+        const double estimated = processor.tempoEstimator.predict (static_cast<double> (referenceOffset) / sampleRate) * sampleRate;
+        return estimated > 0.0 ? static_cast<uint64_t> (std::llround (estimated)) : 0;
+    }
+};
 
-    auto enqueueEvent = [&](const uint8_t* data, uint8_t size, uint64_t dueSample, int passThroughOffset)
+struct PluginProcessor::HostTempoAlignment
+{
+    static constexpr bool predictive = false;
+
+    static uint64_t align (PluginProcessor& processor, const BlockContext& context, uint64_t, uint64_t refSample) noexcept
     {
-        if (isMuted)
-            return;
-        if (queueSize < kMaxQueuedEvents)
-        {
-            ScheduledMidiEvent event;
-            event.dueSample = dueSample;
-            event.order = orderCounter++;
-            event.size = size;
-            std::memcpy (event.data, data, static_cast<size_t> (size));
-            event.flags = 0;
-
-            insertScheduledEvent (event);
-        }
-        else if (outputEventCount < kMaxOutputEvents)
-        {
-            // Queue overflow: pass through without delay.
-            outputBuffer.addEvent (data, size, passThroughOffset);
-            countOutputNoteOn (data, size);
-            ++outputEventCount;
-        }
-    };
+        const double beat = processor.referenceSecondsToBeats (*context.reference,
+            static_cast<double> (refSample) / processor.sampleRateHz);
+        const double aligned = static_cast<double> (processor.tempoAnchorSample)
+            + (beat - processor.tempoAnchorBeat) / context.hostBeatsPerSample;
+        return aligned > 0.0 ? static_cast<uint64_t> (std::llround (aligned)) : 0;
+    }
+};
+
+// Until the tracker has seen enough notes the block's other alignment applies.
+struct PluginProcessor::PredictiveAlignment
+{
+    static constexpr bool predictive = true;
 
-    auto enqueueNoteEvent = [&](const uint8_t* data,
-                                uint8_t size,
-                                uint64_t dueSample,
-                                int passThroughOffset,
-                                int refIndex,
-                                bool isNoteOn,
-                                int channel)
+    static uint64_t align (PluginProcessor& processor, const BlockContext& context, uint64_t referenceOffset, uint64_t refSample) noexcept
     {
-        if (isMuted)
-            return;
+        if (! processor.tempoTracker.isPrimed())
+            return processor.alignUnpredictedReferenceSample (context, referenceOffset, refSample);
 
-        if (queueSize < kMaxQueuedEvents)
-        {
-            ScheduledMidiEvent event;
-            event.dueSample = dueSample;
-            event.order = orderCounter++;
-            event.size = size;
-            std::memcpy (event.data, data, static_cast<size_t> (size));
-            event.refIndex = refIndex;
-            event.noteNumber = data[1];
-            event.channel = static_cast<uint8_t> (juce::jlimit (1, 16, channel));
-            event.flags = static_cast<uint8_t> (kScheduledEventNoteFlag
-                | (isNoteOn ? kScheduledEventNoteOnFlag : 0));
-
-            insertScheduledEvent (event);
-        }
-        else if (outputEventCount < kMaxOutputEvents)
-        {
-            // Queue overflow: pass through without delay.
-            outputBuffer.addEvent (data, size, passThroughOffset);
-            countOutputNoteOn (data, size);
-            ++outputEventCount;
-        }
-    };
+        const double predicted = processor.tempoTracker.predict (static_cast<double> (referenceOffset));
+        return predicted > 0.0 ? static_cast<uint64_t> (std::llround (predicted)) : 0;
+    }
+};
+
+template <bool HasReference, bool Bypassed, bool Muted, bool VelocityCorrection, typename Alignment>
+struct PluginProcessor::EventLoopMode
+{
+    static constexpr bool hasReference = HasReference;
+    static constexpr bool bypassed = Bypassed;
+    static constexpr bool muted = Muted;
+    static constexpr bool velocityCorrection = VelocityCorrection;
+    using TimeAlignment = Alignment;
+};
+
+template <typename Strategy, typename MissPolicy>
+void PluginProcessor::processMidiEventsWithTimeout (BlockContext& context, juce::MidiBuffer& midi) noexcept
+{
+    if (context.reference != nullptr && context.missingTimeoutMs > 0.0f && sampleRateHz > 0.0)
+        processMidiEventsWithPitch<Strategy, MissPolicy, MissingTimeout> (context, midi);
+    else
+        processMidiEventsWithPitch<Strategy, MissPolicy, NoMissingTimeout> (context, midi);
+}
+
+template <typename Strategy, typename MissPolicy, typename TimeoutPolicy>
+void PluginProcessor::processMidiEventsWithPitch (BlockContext& context, juce::MidiBuffer& midi) noexcept
+{
+    if (context.pitchTolerance > 0)
+        processMidiEventsForMode<Matcher<Strategy, MissPolicy, TimeoutPolicy, TolerantPitch>, true> (context, midi);
+    else
+        processMidiEventsForMode<Matcher<Strategy, MissPolicy, TimeoutPolicy, ExactPitch>, true> (context, midi);
+}
+
+template <typename MatcherType, bool HasReference>
+void PluginProcessor::processMidiEventsForMode (BlockContext& context, juce::MidiBuffer& midi) noexcept
+{
+    // Bypass never retimes, and without a reference nothing is aligned.
+    if (context.isBypassed)
+    {
+        if (context.isMuted)
+            processMidiEventsWith<MatcherType, EventLoopMode<HasReference, true, true, false, ReferenceClockAlignment>> (context, midi);
+        else
+            processMidiEventsWith<MatcherType, EventLoopMode<HasReference, true, false, false, ReferenceClockAlignment>> (context, midi);
+    }
+    else if (! HasReference)
+        processMidiEventsWithAlignment<MatcherType, HasReference, ReferenceClockAlignment> (context, midi);
+    else if (context.predictiveOutput)
+        processMidiEventsWithAlignment<MatcherType, HasReference, PredictiveAlignment> (context, midi);
+    else if (context.followHostTempo)
+        processMidiEventsWithAlignment<MatcherType, HasReference, HostTempoAlignment> (context, midi);
+    else if (context.useTempoEstimate)
+        processMidiEventsWithAlignment<MatcherType, HasReference, TempoEstimateAlignment> (context, midi);
+    else
+        processMidiEventsWithAlignment<MatcherType, HasReference, ReferenceClockAlignment> (context, midi);
+}
+
+template <typename MatcherType, bool HasReference, typename Alignment>
+void PluginProcessor::processMidiEventsWithAlignment (BlockContext& context, juce::MidiBuffer& midi) noexcept
+{
+    const bool velocityCorrection = HasReference && context.velocityCorrection;
+
+    if (context.isMuted)
+    {
+        if (velocityCorrection)
+            processMidiEventsWith<MatcherType, EventLoopMode<HasReference, false, true, true, Alignment>> (context, midi);
+        else
+            processMidiEventsWith<MatcherType, EventLoopMode<HasReference, false, true, false, Alignment>> (context, midi);
+    }
+    else
+    {
+        if (velocityCorrection)
+            processMidiEventsWith<MatcherType, EventLoopMode<HasReference, false, false, true, Alignment>> (context, midi);
+        else
+            processMidiEventsWith<MatcherType, EventLoopMode<HasReference, false, false, false, Alignment>> (context, midi);
+    }
+}
+
+// One event loop for every mode. Bypass only tracks notes for the follower and the UI and leaves
+// the buffer alone; otherwise every event goes through the delay line. Mode flags are constants
+// here, so each instantiation carries only the work its mode needs.
+template <typename MatcherType, typename Mode>
+void PluginProcessor::processMidiEventsWith (BlockContext& context, juce::MidiBuffer& midi) noexcept
+{
+    auto* reference = context.reference;
+    if constexpr (Mode::hasReference)
+    {
+        clearPendingMatches (*reference, juce::jmax (getMatchReach(), pendingClearFrom + kClearedClustersPerBlock - 1));
+        MatcherType::skipExpiredClusters (*this, context);
+    }
 
     for (const auto metadata : midi)
     {
         const int sampleOffset = metadata.samplePosition;
         const int clampedOffset = juce::jmax (0, sampleOffset);
-        const uint64_t userSample = blockStart + static_cast<uint64_t> (clampedOffset);
+        const uint64_t userSample = context.blockStart + static_cast<uint64_t> (clampedOffset);
+        const uint8_t* data = metadata.data;
 
-        if (metadata.numBytes > kMaxMidiBytes)
+        if constexpr (Mode::bypassed)
         {
-            // Drop oversized messages (e.g. long SysEx) to avoid heap allocation on the audio thread.
-            continue;
+            if (metadata.numBytes < 3)
+                continue;
+        }
+        else
+        {
+            // Long messages (e.g. SysEx) take the control path, their bytes held in the arena.
+            if (metadata.numBytes < 3 || metadata.numBytes > kMaxMidiBytes)
+            {
+                enqueueEvent (context, data, metadata.numBytes, userSample, clampedOffset);
+                continue;
+            }
         }
 
-        const uint8_t* data = metadata.data;
-        const uint8_t size = static_cast<uint8_t> (metadata.numBytes);
+        const uint8_t status = static_cast<uint8_t> (data[0] & 0xF0);
+        const int channel = (data[0] & 0x0F) + 1;
 
-        if (size >= 3)
+        if (status == 0x90 && data[2] > 0 && ((context.bypassChannelMask >> (channel - 1)) & 1u) != 0)
         {
-            const uint8_t status = static_cast<uint8_t> (data[0] & 0xF0);
-            const int channel = (data[0] & 0x0F) + 1;
+            inputNoteOnCounter.fetch_add (1, std::memory_order_relaxed);
+
+            // Recorded so the note-off leaves the same way even if the channel mask changes meanwhile.
+            if (activeNoteCount < activeNotes.capacity())
+                activeNotes[activeNoteCount++] = { static_cast<int> (data[1]), channel, kBypassedRefIndex, noteOnOrderCounter++, userSample };
+            else if constexpr (! Mode::bypassed)
+                countUntrackedNoteOn (static_cast<int> (data[1]), channel);
 
-            if (status == 0x90 && data[2] > 0)
+            if constexpr (Mode::bypassed)
             {
-                captureStartOffsetIfNeeded (userSample);
-                inputNoteOnCounter.fetch_add (1, std::memory_order_relaxed);
-                int refIndex = -1;
-                const ReferenceNote* refNote = nullptr;
-                bool shouldDropNote = false;
+                if constexpr (! Mode::muted)
+                    outputNoteOnCounter.fetch_add (1, std::memory_order_relaxed);
+                pushUiNoteEvent (userSample, static_cast<int> (data[1]), channel, -1, true);
+            }
+            else
+            {
+                passBypassedChannelNote (context, data, userSample, clampedOffset, channel, true);
+            }
+            continue;
+        }
 
-                if (hasReference)
+        if (status == 0x90 && data[2] > 0)
+        {
+            captureStartOffsetIfNeeded (context, userSample);
+            inputNoteOnCounter.fetch_add (1, std::memory_order_relaxed);
+            if constexpr (Mode::bypassed)
+            {
+                lastTimingDeltaMs.store (0.0f, std::memory_order_relaxed);
+                lastVelocityDelta.store (0.0f, std::memory_order_relaxed);
+                if constexpr (! Mode::muted)
+                    outputNoteOnCounter.fetch_add (1, std::memory_order_relaxed);
+            }
+
+            int refIndex = -1;
+            const ReferenceNote* refNote = nullptr;
+            ActiveNote* activeNote = nullptr;
+
+            if constexpr (Mode::hasReference)
+            {
+                // Bypass only follows the performance; nothing is held back, so nothing degrades.
+                if constexpr (! Mode::bypassed)
                 {
-                    refIndex = matchReferenceNoteInCluster (static_cast<int> (data[1]),
-                        channel,
-                        pitchTolerance,
-                        *reference,
-                        maxLookaheadClusters);
-                    if (refIndex >= 0 && refIndex < static_cast<int> (reference->notes.size()))
-                        refNote = &reference->notes[refIndex];
-                    if (refIndex >= 0)
+                    if (! MatcherType::spendMatchWork (context))
                     {
-                        matchedNoteOnCounter.fetch_add (1, std::memory_order_relaxed);
+                        passDegradedNoteOn (context, data, userSample, clampedOffset, channel);
+                        continue;
+                    }
+                }
+
+                pushRecentOnset (context, static_cast<int> (data[1]), userSample);
+                if (context.linkGroup > 0)
+                    linkedChannelMask = static_cast<uint16_t> (linkedChannelMask | (1u << (channel - 1)));
+                clearPendingMatches (*reference, getMatchReach());
+                refIndex = MatcherType::match (*this, *reference, static_cast<int> (data[1]), channel, context);
+                if (refIndex < 0 && relocaliseIfLost (context, *reference, userSample, ! Mode::bypassed)
+                    && (Mode::bypassed || MatcherType::spendMatchWork (context)))
+                    refIndex = MatcherType::match (*this, *reference, static_cast<int> (data[1]), channel, context);
+                if (refIndex >= 0 && refIndex < static_cast<int> (reference->notes.size()))
+                    refNote = &reference->notes[refIndex];
+
+                if (refIndex >= 0)
+                {
+                    matchedNoteOnCounter.fetch_add (1, std::memory_order_relaxed);
+                    if (context.linkGroup > 0)
+                        publishLinkedPosition (context, *reference, refIndex, userSample);
+                    if constexpr (! Mode::bypassed)
                         extraNoteStreak = 0;
-                        if (activeNoteCount < kMaxActiveNotes)
-                        {
-                            const uint64_t noteOrder = noteOnOrderCounter++;
-                            activeNotes[activeNoteCount++] = { static_cast<int> (data[1]), channel, refIndex, noteOrder };
-                        }
-                        else
-                        {
-                            ++noteOnOrderCounter;
-                        }
+                    lostNoteCount = 0;
+                    const uint64_t noteOrder = noteOnOrderCounter++;
+                    if (activeNoteCount < activeNotes.capacity())
+                    {
+                        activeNote = &activeNotes[activeNoteCount++];
+                        *activeNote = { static_cast<int> (data[1]), channel, refIndex, noteOrder };
                     }
-                    else
+                    else if constexpr (! Mode::bypassed)
                     {
-                        missedNoteOnCounter.fetch_add (1, std::memory_order_relaxed);
-                        logMiss (static_cast<int> (data[1]),
-                            static_cast<int> (data[2]),
-                            channel,
-                            userSample,
-                            slackMs,
-                            clusterWindowMs,
-                            correction,
-                            hostBpmValue,
-                            referenceBpmValue);
-                        if (dropExtraNotes)
-                        {
-                            ++extraNoteStreak;
-                            if (clampedExtraNoteBudget > 0 && extraNoteStreak >= clampedExtraNoteBudget)
-                                markCurrentClusterMissing (*reference);
-                            shouldDropNote = true;
-                        }
-                        else
-                        {
-                            handleClusterMiss (*reference);
-                        }
+                        countUntrackedNoteOn (static_cast<int> (data[1]), channel);
                     }
                 }
-
-                if (shouldDropNote)
-                    continue;
-
-                const uint64_t alignedRefSample = (refNote != nullptr && refNote->onSample >= referenceStartSample)
-                    ? referenceTransportStartSample + (refNote->onSample - referenceStartSample)
-                    : userSample;
-                const uint64_t correctedSample = lerpSamples (userSample, alignedRefSample, effectiveCorrection);
-                pushUiNoteEvent (correctedSample, static_cast<int> (data[1]), channel, refIndex, true);
-                const uint64_t dueSample = slackSamples + correctedSample;
-                const uint8_t inputVelocity = data[2];
-                uint8_t outVelocity = inputVelocity;
-                if (velocityCorrectionEnabled)
+                else
                 {
-                    const uint8_t targetVelocity = (refNote != nullptr)
-                        ? scaleReferenceVelocity (refNote->onVelocity)
-                        : inputVelocity;
-                    outVelocity = lerpVelocity (inputVelocity, targetVelocity, effectiveCorrection);
+                    missedNoteOnCounter.fetch_add (1, std::memory_order_relaxed);
+                    logMiss (static_cast<int> (data[1]),
+                        static_cast<int> (data[2]),
+                        channel,
+                        userSample,
+                        context.slackMs,
+                        context.clusterWindowMs,
+                        context.correction,
+                        context.hostBpm,
+                        context.referenceBpm);
+
+                    if constexpr (Mode::bypassed)
+                    {
+                        MatcherType::onMiss (*this, *reference);
+                    }
+                    else
+                    {
+                        // Extra notes are dropped; enough of them in a row give up on the cluster.
+                        ++extraNoteStreak;
+                        if (context.extraNoteBudget > 0 && extraNoteStreak >= context.extraNoteBudget)
+                            markCurrentClusterMissing (*reference);
+                        continue;
+                    }
                 }
-                updateVelocityStats (inputVelocity, (refNote != nullptr) ? refNote->onVelocity : -1);
-                lastVelocityDelta.store (static_cast<float> (static_cast<int> (outVelocity)
-                    - static_cast<int> (inputVelocity)), std::memory_order_relaxed);
+            }
 
-                const int64_t deltaSamples = static_cast<int64_t> (correctedSample)
-                    - static_cast<int64_t> (userSample);
-                const float deltaMs = sampleRateHz > 0.0
-                    ? static_cast<float> (1000.0 * (static_cast<double> (deltaSamples) / sampleRateHz))
-                    : 0.0f;
-                lastTimingDeltaMs.store (deltaMs, std::memory_order_relaxed);
+            if constexpr (Mode::bypassed)
+            {
+                if (refNote != nullptr)
+                    observeTempo (context, *refNote, userSample);
+                pushUiNoteEvent (userSample, static_cast<int> (data[1]), channel, refIndex, true);
+                updateVelocityStats (data[2], (refNote != nullptr) ? refNote->onVelocity : -1);
+                continue;
+            }
 
+            const uint64_t alignedRefSample = (refNote != nullptr)
+                ? alignReferenceSampleWith<typename Mode::TimeAlignment> (context, secondsToSample (refNote->onTimeSeconds, sampleRateHz), userSample)
+                : userSample;
+            if (refNote != nullptr)
+                observeTempo (context, *refNote, userSample);
+            const uint64_t correctedSample = lerpSamples (userSample, alignedRefSample, context.effectiveCorrection);
+            pushUiNoteEvent (correctedSample, static_cast<int> (data[1]), channel, refIndex, true);
+            if (activeNote != nullptr)
+                activeNote->onBaseSample = correctedSample;
+            if (refNote != nullptr)
+                recordRequiredDelay (userSample > correctedSample ? userSample - correctedSample : 0);
+            lastNoteInputSample = userSample;
+            autoSlackRetargetPending = true;
+            const uint8_t inputVelocity = data[2];
+            uint8_t outVelocity = inputVelocity;
+            if constexpr (Mode::velocityCorrection)
+            {
+                const uint8_t targetVelocity = (refNote != nullptr)
+                    ? scaleReferenceVelocity (refNote->onVelocity)
+                    : inputVelocity;
+                outVelocity = lerpVelocity (inputVelocity, targetVelocity, context.effectiveCorrection);
+            }
+            updateVelocityStats (inputVelocity, (refNote != nullptr) ? refNote->onVelocity : -1);
+            lastVelocityDelta.store (static_cast<float> (static_cast<int> (outVelocity)
+                - static_cast<int> (inputVelocity)), std::memory_order_relaxed);
+
+            const int64_t deltaSamples = static_cast<int64_t> (correctedSample)
+                - static_cast<int64_t> (userSample);
+            const float deltaMs = sampleRateHz > 0.0
+                ? static_cast<float> (1000.0 * (static_cast<double> (deltaSamples) / sampleRateHz))
+                : 0.0f;
+            lastTimingDeltaMs.store (deltaMs, std::memory_order_relaxed);
+
+            if constexpr (! Mode::muted)
+            {
                 uint8_t outData[3] = { static_cast<uint8_t> (0x90 | (channel - 1)),
                                        data[1],
                                        outVelocity };
-                enqueueNoteEvent (outData, 3, dueSample, clampedOffset, refIndex, true, channel);
+                enqueueNoteEvent (context, outData, 3, correctedSample, clampedOffset, refIndex, true, channel);
+            }
+        }
+        else if (status == 0x80 || (status == 0x90 && data[2] == 0))
+        {
+            int refIndex = -1;
+            uint64_t onBaseSample = 0;
+            bool heldAcrossSwap = false;
+
+            refIndex = removeOldestActiveNote (static_cast<int> (data[1]), channel, &onBaseSample);
 
+            // A note-off leaves the way its note-on came in, whatever the channel mask says now.
+            // One with no note-on on record follows the mask.
+            if (refIndex == kBypassedRefIndex
+                || (refIndex == -1 && ((context.bypassChannelMask >> (channel - 1)) & 1u) != 0))
+            {
+                if constexpr (Mode::bypassed)
+                    pushUiNoteEvent (userSample, static_cast<int> (data[1]), channel, -1, false);
+                else
+                    passBypassedChannelNote (context, data, userSample, clampedOffset, channel, false);
+                continue;
             }
-            else if (status == 0x80 || (status == 0x90 && data[2] == 0))
+
+            if constexpr (Mode::bypassed)
             {
-                int refIndex = -1;
-
-                if (hasReference)
-                    refIndex = removeOldestActiveNote (static_cast<int> (data[1]), channel);
-                const bool shouldDropNote = hasReference && dropExtraNotes && refIndex < 0;
-                if (shouldDropNote)
-                    continue;
-
-                const ReferenceNote* refNote = (refIndex >= 0 && refIndex < static_cast<int> (reference->notes.size()))
-                    ? &reference->notes[refIndex]
-                    : nullptr;
-                const uint64_t alignedRefSample = (refNote != nullptr && refNote->offSample >= referenceStartSample)
-                    ? referenceTransportStartSample + (refNote->offSample - referenceStartSample)
-                    : userSample;
-                const uint64_t correctedSample = lerpSamples (userSample, alignedRefSample, effectiveCorrection);
-                pushUiNoteEvent (correctedSample, static_cast<int> (data[1]), channel, refIndex, false);
-                const uint64_t dueSample = slackSamples + correctedSample;
-                const uint8_t inputVelocity = data[2];
-                uint8_t outVelocity = inputVelocity;
-                if (velocityCorrectionEnabled)
+                lastNoteOffDeltaMs.store (0.0f, std::memory_order_relaxed);
+                pushUiNoteEvent (userSample, static_cast<int> (data[1]), channel, refIndex, false);
+                continue;
+            }
+
+            if constexpr (Mode::hasReference)
+            {
+                // A degraded note-on passed through unmatched, so its note-off must too.
+                if (refIndex == kDegradedRefIndex)
                 {
-                    const uint8_t targetVelocity = (refNote != nullptr)
-                        ? scaleReferenceVelocity (refNote->offVelocity)
-                        : inputVelocity;
-                    outVelocity = lerpVelocity (inputVelocity, targetVelocity, effectiveCorrection);
+                    refIndex = -1;
+                    degradedEventCounter.fetch_add (1, std::memory_order_relaxed);
                 }
-                const int64_t deltaSamples = static_cast<int64_t> (correctedSample)
-                    - static_cast<int64_t> (userSample);
-                const float deltaMs = sampleRateHz > 0.0
-                    ? static_cast<float> (1000.0 * (static_cast<double> (deltaSamples) / sampleRateHz))
-                    : 0.0f;
-                lastNoteOffDeltaMs.store (deltaMs, std::memory_order_relaxed);
+                else if (refIndex == kSwappedRefIndex)
+                {
+                    refIndex = -1;
+                    heldAcrossSwap = true;
+                }
+                else if (refIndex < 0)
+                {
+                    // Only a note-on that went out without an active-note slot has its note-off passed.
+                    auto& untracked = untrackedNoteOns[static_cast<size_t> ((channel - 1) * 128 + data[1])];
+                    if (untracked == 0)
+                        continue;
+                    --untracked;
+                }
+            }
 
+            const ReferenceNote* refNote = (Mode::hasReference && refIndex >= 0
+                    && refIndex < static_cast<int> (reference->notes.size()))
+                ? &reference->notes[refIndex]
+                : nullptr;
+            const uint64_t alignedRefSample = (refNote != nullptr)
+                ? alignReferenceSampleWith<typename Mode::TimeAlignment> (context, secondsToSample (refNote->offTimeSeconds, sampleRateHz), userSample)
+                : userSample;
+            const uint64_t correctedSample = lerpSamples (userSample, alignedRefSample, context.effectiveCorrection);
+            pushUiNoteEvent (correctedSample, static_cast<int> (data[1]), channel, refIndex, false);
+            uint64_t baseSample = correctedSample;
+            // The tempo map can move between a note's on and off; never release before the on.
+            if ((Mode::TimeAlignment::predictive && refIndex >= 0) || heldAcrossSwap)
+                baseSample = juce::jmax (baseSample, onBaseSample);
+            const uint8_t inputVelocity = data[2];
+            uint8_t outVelocity = inputVelocity;
+            if constexpr (Mode::velocityCorrection)
+            {
+                const uint8_t targetVelocity = (refNote != nullptr)
+                    ? scaleReferenceVelocity (refNote->offVelocity)
+                    : inputVelocity;
+                outVelocity = lerpVelocity (inputVelocity, targetVelocity, context.effectiveCorrection);
+            }
+            const int64_t deltaSamples = static_cast<int64_t> (correctedSample)
+                - static_cast<int64_t> (userSample);
+            const float deltaMs = sampleRateHz > 0.0
+                ? static_cast<float> (1000.0 * (static_cast<double> (deltaSamples) / sampleRateHz))
+                : 0.0f;
+            lastNoteOffDeltaMs.store (deltaMs, std::memory_order_relaxed);
+
+            if constexpr (! Mode::muted)
+            {
                 uint8_t outData[3] = { static_cast<uint8_t> (0x80 | (channel - 1)),
                                        data[1],
                                        outVelocity };
-                enqueueNoteEvent (outData, 3, dueSample, clampedOffset, refIndex, false, channel);
-            }
-            else
-            {
-                const uint64_t dueSample = userSample + slackSamples;
-                enqueueEvent (data, size, dueSample, clampedOffset);
+                enqueueNoteEvent (context, outData, 3, baseSample, clampedOffset, refIndex, false, channel);
             }
         }
-        else
+        else if constexpr (! Mode::bypassed)
+        {
+            enqueueEvent (context, data, metadata.numBytes, userSample, clampedOffset);
+        }
+    }
+}
+
+void PluginProcessor::processMidiEvents (BlockContext& context, juce::MidiBuffer& midi) noexcept
+{
+    // Without a reference there is nothing to match, so the matcher choice does not matter.
+    if (context.reference == nullptr)
+    {
+        processMidiEventsForMode<Matcher<ClusterCursorMatch, ClusterMissStreak, NoMissingTimeout, ExactPitch>, false> (context, midi);
+        return;
+    }
+
+    switch (activeFollowerEngine)
+    {
+        case FollowerEngine::Hmm:
+            processMidiEventsWithTimeout<HmmMatch, FollowerAbsorbsMisses> (context, midi);
+            break;
+        case FollowerEngine::Dtw:
+            processMidiEventsWithTimeout<DtwMatch, FollowerAbsorbsMisses> (context, midi);
+            break;
+        case FollowerEngine::Cluster:
+        default:
+            processMidiEventsWithTimeout<ClusterCursorMatch, ClusterMissStreak> (context, midi);
+            break;
+    }
+}
+
+void PluginProcessor::captureStartOffsetIfNeeded (const BlockContext& context, uint64_t userSample) noexcept
+{
+    if (! context.isPlaying || context.hostLocked || userStartSampleCaptured)
+        return;
+
+    userStartSampleCaptured = true;
+    userStartSample = userSample;
+    if (context.reference != nullptr)
+        anchorReferenceAt (context.reference, userSample, context.reference->firstNoteTimeSeconds);
+    else
+        referenceTransportStartSample = userSample;
+    referenceTempoIndex = 0;
+
+    double offsetSeconds = 0.0;
+    if (sampleRateHz > 0.0 && userSample >= playbackStartSample)
+    {
+        offsetSeconds = static_cast<double> (userSample - playbackStartSample) / sampleRateHz;
+    }
+
+    startOffsetMs.store (static_cast<float> (offsetSeconds * 1000.0), std::memory_order_relaxed);
+
+    float offsetBarsValue = 0.0f;
+    if (context.reference != nullptr && context.reference->barDurationSeconds > 0.0)
+        offsetBarsValue = static_cast<float> (offsetSeconds / context.reference->barDurationSeconds);
+
+    startOffsetBars.store (offsetBarsValue, std::memory_order_relaxed);
+    startOffsetValid.store (true, std::memory_order_relaxed);
+}
+
+// Per-cluster callers (the missing timeout) pick the block's alignment at run time; the note
+// loop has it compiled in through Mode::TimeAlignment.
+uint64_t PluginProcessor::alignReferenceSample (const BlockContext& context,
+                                                uint64_t refSample,
+                                                uint64_t fallbackSample) noexcept
+{
+    if (context.predictiveOutput)
+        return alignReferenceSampleWith<PredictiveAlignment> (context, refSample, fallbackSample);
+    if (refSample < context.referenceStartSample)
+        return fallbackSample;
+    return alignUnpredictedReferenceSample (context, refSample - context.referenceStartSample, refSample);
+}
+
+template <typename Alignment>
+uint64_t PluginProcessor::alignReferenceSampleWith (const BlockContext& context,
+                                                    uint64_t refSample,
+                                                    uint64_t fallbackSample) noexcept
+{
+    if (refSample < context.referenceStartSample)
+        return fallbackSample;
+
+    return Alignment::align (*this, context, refSample - context.referenceStartSample, refSample);
+}
+
+uint64_t PluginProcessor::alignUnpredictedReferenceSample (const BlockContext& context,
+                                                           uint64_t referenceOffset,
+                                                           uint64_t refSample) noexcept
+{
+    if (context.followHostTempo)
+        return HostTempoAlignment::align (*this, context, referenceOffset, refSample);
+    if (context.useTempoEstimate)
+        return TempoEstimateAlignment::align (*this, context, referenceOffset, refSample);
+    return ReferenceClockAlignment::align (*this, context, referenceOffset, refSample);
+}
+
+void PluginProcessor::observeTempo (const BlockContext& context,
+                                    const ReferenceNote& refNote,
+                                    uint64_t userSample) noexcept
+{
+    const uint64_t refSample = secondsToSample (refNote.onTimeSeconds, sampleRateHz);
+    if (refSample < context.referenceStartSample)
+        return;
+
+    const uint64_t referenceOffset = refSample - context.referenceStartSample;
+    tempoTracker.observe (static_cast<double> (referenceOffset), static_cast<double> (userSample));
+
+    if (sampleRateHz <= 0.0)
+        return;
+
+    const double referenceSeconds = static_cast<double> (referenceOffset) / sampleRateHz;
+    tempoEstimator.observe (referenceSeconds, static_cast<double> (userSample) / sampleRateHz);
+    if (! tempoEstimator.isPrimed())
+    {
+        tempoEstimateValid.store (false, std::memory_order_relaxed);
+        return;
+    }
+
+    // Drift: where the estimate puts this note against the unscaled reference timeline.
+    const double rawSeconds = static_cast<double> (referenceTransportStartSample + referenceOffset) / sampleRateHz;
+    tempoEstimateRatio.store (static_cast<float> (tempoEstimator.getTempoRatio()), std::memory_order_relaxed);
+    tempoEstimateDriftMs.store (static_cast<float> (1000.0 * (tempoEstimator.predict (referenceSeconds) - rawSeconds)),
+        std::memory_order_relaxed);
+    tempoEstimateSpreadMs.store (static_cast<float> (1000.0 * tempoEstimator.getSpread (referenceSeconds)),
+        std::memory_order_relaxed);
+    tempoEstimateValid.store (true, std::memory_order_relaxed);
+}
+
+void PluginProcessor::passDegradedNoteOn (BlockContext& context,
+                                          const uint8_t* data,
+                                          uint64_t userSample,
+                                          int passThroughOffset,
+                                          int channel) noexcept
+{
+    degradedEventCounter.fetch_add (1, std::memory_order_relaxed);
+    if (activeNoteCount < activeNotes.capacity())
+        activeNotes[activeNoteCount++] = { static_cast<int> (data[1]), channel, kDegradedRefIndex, noteOnOrderCounter++, userSample };
+    else
+        countUntrackedNoteOn (static_cast<int> (data[1]), channel);
+
+    lastTimingDeltaMs.store (0.0f, std::memory_order_relaxed);
+    pushUiNoteEvent (userSample, static_cast<int> (data[1]), channel, -1, true);
+    enqueueNoteEvent (context, data, 3, userSample, passThroughOffset, -1, true, channel);
+}
+
+void PluginProcessor::countUntrackedNoteOn (int noteNumber, int channel) noexcept
+{
+    auto& untracked = untrackedNoteOns[static_cast<size_t> ((channel - 1) * 128 + noteNumber)];
+    if (untracked < std::numeric_limits<uint8_t>::max())
+        ++untracked;
+}
+
+void PluginProcessor::passBypassedChannelNote (BlockContext& context,
+                                               const uint8_t* data,
+                                               uint64_t userSample,
+                                               int passThroughOffset,
+                                               int channel,
+                                               bool isNoteOn) noexcept
+{
+    pushUiNoteEvent (userSample, static_cast<int> (data[1]), channel, -1, isNoteOn);
+    enqueueNoteEvent (context, data, 3, userSample, passThroughOffset, -1, isNoteOn, channel);
+}
+
+void PluginProcessor::countOutputNoteOn (const uint8_t* data, uint8_t size) noexcept
+{
+    if (size < 3)
+        return;
+    if ((data[0] & 0xF0) == 0x90 && data[2] > 0)
+        outputNoteOnCounter.fetch_add (1, std::memory_order_relaxed);
+}
+
+void PluginProcessor::enqueueEvent (BlockContext& context,
+                                    const uint8_t* data,
+                                    int size,
+                                    uint64_t baseSample,
+                                    int passThroughOffset) noexcept
+{
+    if (context.isMuted)
+        return;
+
+    const bool isLong = size > kMaxMidiBytes;
+
+    // A continuous controller already queued for this key and output window just takes the new value.
+    const int key = isLong ? -1 : continuousControllerKey (data, static_cast<uint8_t> (size));
+    const uint64_t window = baseSample / controllerWindowSamples;
+    if (key >= 0)
+    {
+        const uint64_t slot = controllerSlots[static_cast<size_t> (key)];
+        if (slot > controlPopCount && controllerSlotWindows[static_cast<size_t> (key)] == window)
         {
-            const uint64_t dueSample = userSample + slackSamples;
-            enqueueEvent (data, size, dueSample, clampedOffset);
+            auto& queued = controlQueue[static_cast<size_t> ((slot - 1) % static_cast<uint64_t> (controlQueue.capacity()))];
+            std::memcpy (queued.data, data, static_cast<size_t> (size));
+            thinnedControllerCounter.fetch_add (1, std::memory_order_relaxed);
+            return;
         }
     }
 
-    while (queueSize > 0)
-    {
-        if (isMuted)
-            break;
-        const auto& event = queue[0];
+    const bool hasSlot = controlPushCount - controlPopCount < static_cast<uint64_t> (controlQueue.capacity());
+    if (isLong)
+    {
+        // Passing a long message through early would reorder it, and the output buffer only
+        // reserves arena-sized room, so anything that does not fit is dropped and counted.
+        uint64_t arenaStart = 0;
+        if (! hasSlot || ! reserveLongMessage (size, arenaStart))
+        {
+            droppedLongMessageCounter.fetch_add (1, std::memory_order_relaxed);
+            return;
+        }
+
+        std::memcpy (longMessageArena.data() + arenaStart % static_cast<uint64_t> (longMessageArena.capacity()),
+                     data,
+                     static_cast<size_t> (size));
+        auto& event = controlQueue[static_cast<size_t> (controlPushCount % static_cast<uint64_t> (controlQueue.capacity()))];
+        event.baseSample = baseSample;
+        event.order = orderCounter++;
+        event.arenaStart = arenaStart;
+        event.arenaSize = static_cast<uint32_t> (size);
+        event.size = 0;
+        event.refIndex = -1;
+        event.flags = kScheduledEventArenaFlag;
+        ++controlPushCount;
+        return;
+    }
+
+    if (hasSlot)
+    {
+        auto& event = controlQueue[static_cast<size_t> (controlPushCount % static_cast<uint64_t> (controlQueue.capacity()))];
+        event.baseSample = baseSample;
+        event.order = orderCounter++;
+        event.size = static_cast<uint8_t> (size);
+        std::memcpy (event.data, data, static_cast<size_t> (size));
+        event.refIndex = -1;
+        event.flags = 0;
+        ++controlPushCount;
+
+        if (key >= 0)
+        {
+            controllerSlots[static_cast<size_t> (key)] = controlPushCount;
+            controllerSlotWindows[static_cast<size_t> (key)] = window;
+        }
+    }
+    else if (context.outputEventCount < maxOutputEvents)
+    {
+        // Queue overflow: pass through without delay.
+        outputBuffer.addEvent (data, size, passThroughOffset);
+        countOutputNoteOn (data, size);
+        ++context.outputEventCount;
+    }
+}
+
+bool PluginProcessor::reserveLongMessage (int size, uint64_t& arenaStart) noexcept
+{
+    const auto capacity = static_cast<uint64_t> (longMessageArena.capacity());
+    const auto bytes = static_cast<uint64_t> (size);
+    if (bytes == 0 || bytes > capacity)
+        return false;
 
-        if (event.dueSample >= blockEnd)
-            break;
+    // Keep each message contiguous: skip the tail of the ring when it would wrap.
+    uint64_t start = longMessageWritePosition;
+    if (start % capacity + bytes > capacity)
+        start += capacity - start % capacity;
 
-        const int sampleOffset = (event.dueSample > blockStart)
-            ? static_cast<int> (event.dueSample - blockStart)
-            : 0;
+    if (start + bytes - longMessageReadPosition > capacity)
+        return false;
 
-        if (outputEventCount < kMaxOutputEvents)
-        {
-            outputBuffer.addEvent (event.data, event.size, sampleOffset);
-            countOutputNoteOn (event.data, event.size);
-            ++outputEventCount;
-        }
+    arenaStart = start;
+    longMessageWritePosition = start + bytes;
+    return true;
+}
 
-        for (int i = 1; i < queueSize; ++i)
-            queue[i - 1] = queue[i];
-        --queueSize;
-    }
+void PluginProcessor::enqueueNoteEvent (BlockContext& context,
+                                        const uint8_t* data,
+                                        uint8_t size,
+                                        uint64_t baseSample,
+                                        int passThroughOffset,
+                                        int refIndex,
+                                        bool isNoteOn,
+                                        int channel) noexcept
+{
+    if (context.isMuted)
+        return;
 
-    midi.swapWith (outputBuffer);
-    timelineSample = blockEnd;
-    lastHostSample = hostSample;
-    transportWasPlaying = isPlaying;
-    updateCpuLoad();
-    updateUiTimelineState();
+    if (queueSize < queue.capacity())
+    {
+        ScheduledMidiEvent event;
+        event.baseSample = baseSample;
+        event.order = orderCounter++;
+        event.size = size;
+        std::memcpy (event.data, data, static_cast<size_t> (size));
+        event.refIndex = refIndex;
+        event.noteNumber = data[1];
+        event.channel = static_cast<uint8_t> (juce::jlimit (1, 16, channel));
+        event.flags = static_cast<uint8_t> (kScheduledEventNoteFlag
+            | (isNoteOn ? kScheduledEventNoteOnFlag : 0));
+
+        insertScheduledEvent (event);
+    }
+    else if (context.outputEventCount < maxOutputEvents)
+    {
+        // Queue overflow: pass through without delay.
+        outputBuffer.addEvent (data, size, passThroughOffset);
+        countOutputNoteOn (data, size);
+        ++context.outputEventCount;
+    }
 }
 
 void PluginProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
     auto state = apvts.copyState();
     state.setProperty (kReferencePathProperty, referencePath, nullptr);
+    state.setProperty (kBypassChannelsProperty, static_cast<int> (getBypassChannelMask()), nullptr);
+
+    if (embedReferenceParam != nullptr && embedReferenceParam->load() >= 0.5f)
+    {
+        // The last queued reference is the one referencePath names, swapped in or not.
+        if (auto reference = std::atomic_load (&pendingReference))
+            state.setProperty (kReferenceBlobProperty, getEmbeddedReferenceText (reference), nullptr);
+    }
+
     std::unique_ptr<juce::XmlElement> xml (state.createXml());
     copyXmlToBinary (*xml, destData);
 }
@@ -1121,14 +2381,55 @@ void PluginProcessor::setStateInformation (const void* data, int sizeInBytes)
     {
         apvts.replaceState (juce::ValueTree::fromXml (*xml));
         referencePath = apvts.state.getProperty (kReferencePathProperty).toString();
+        bypassChannelMask.store (static_cast<uint16_t> (static_cast<int> (
+            apvts.state.getProperty (kBypassChannelsProperty, 0)) & 0xFFFF), std::memory_order_relaxed);
+
+        const auto blobText = apvts.state.getProperty (kReferenceBlobProperty).toString();
+        apvts.state.removeProperty (kReferenceBlobProperty, nullptr);
+        const uint32_t recall = referenceRequestSequence.fetch_add (1, std::memory_order_acq_rel) + 1;
+
+        juce::MemoryBlock blob;
+        if (blobText.isNotEmpty() && blob.fromBase64Encoding (blobText))
+        {
+            // Only decoded on the cache thread; it is prepared and swapped in on the message thread,
+            // like a loaded file. The original file is only read if the blob is unusable.
+            const double clusterWindowSeconds = getClusterWindowSeconds();
+            const juce::String pathToLoad = referencePath;
+            const juce::WeakReference<PluginProcessor> weakThis (this);
+            referenceCache.post ([weakThis, blob, clusterWindowSeconds, pathToLoad, recall]
+            {
+                juce::String errorMessage;
+                std::shared_ptr<ReferenceData> reference = readReferenceBlob (blob, clusterWindowSeconds, errorMessage);
+                juce::MessageManager::callAsync ([weakThis, reference, pathToLoad, recall]
+                {
+                    auto* processor = weakThis.get();
+                    if (processor == nullptr
+                        || recall != processor->referenceRequestSequence.load (std::memory_order_acquire))
+                        return;
 
-        if (referencePath.isNotEmpty())
+                    if (reference != nullptr)
+                    {
+                        processor->prepareReference (*reference);
+                        processor->queueReferenceSwap (reference);
+                        processor->publishReferenceDisplayData (processor->buildReferenceDisplayData (reference));
+                    }
+                    else if (pathToLoad.isNotEmpty())
+                    {
+                        juce::String loadError;
+                        processor->loadReferenceFromFile (juce::File (pathToLoad), loadError);
+                    }
+                });
+            });
+        }
+        else if (referencePath.isNotEmpty())
         {
             const juce::String pathToLoad = referencePath;
-            juce::MessageManager::callAsync ([this, pathToLoad]()
+            const juce::WeakReference<PluginProcessor> weakThis (this);
+            juce::MessageManager::callAsync ([weakThis, pathToLoad]()
             {
                 juce::String errorMessage;
-                loadReferenceFromFile (juce::File (pathToLoad), errorMessage);
+                if (auto* processor = weakThis.get())
+                    processor->loadReferenceFromFile (juce::File (pathToLoad), errorMessage);
             });
         }
     }
@@ -1136,38 +2437,61 @@ void PluginProcessor::setStateInformation (const void* data, int sizeInBytes)
 
 void PluginProcessor::updateReferenceSampleTimes (ReferenceData& data, double sampleRate)
 {
-    for (auto& note : data.notes)
-    {
-        const auto onSamples = std::llround (note.onTimeSeconds * sampleRate);
-        const auto offSamples = std::llround (note.offTimeSeconds * sampleRate);
-        note.onSample = static_cast<uint64_t> (juce::jmax (0LL, onSamples));
-        note.offSample = static_cast<uint64_t> (juce::jmax (0LL, offSamples));
-    }
-
-    data.firstNoteSample = data.notes.empty() ? 0 : data.notes.front().onSample;
+    data.firstNoteSample = data.notes.empty() ? 0 : secondsToSample (data.notes.front().onTimeSeconds, sampleRate);
     data.sampleRate = sampleRate;
     data.sampleTimesValid = true;
 }
 
 std::shared_ptr<PluginProcessor::ReferenceDisplayData> PluginProcessor::buildReferenceDisplayData (
-    const ReferenceData& reference) const
+    std::shared_ptr<const ReferenceData> reference) const
 {
     auto display = std::make_shared<ReferenceDisplayData>();
-    display->sourcePath = reference.sourcePath;
-    display->firstNoteSample = reference.firstNoteSample;
-    display->notes.reserve (reference.notes.size());
+    display->reference = std::move (reference);
+    return display;
+}
 
-    for (const auto& note : reference.notes)
-    {
-        ReferenceDisplayNote displayNote;
-        displayNote.noteNumber = note.noteNumber;
-        displayNote.channel = note.channel;
-        displayNote.onSample = note.onSample;
-        displayNote.offSample = note.offSample;
-        display->notes.push_back (displayNote);
-    }
+bool PluginProcessor::ReferenceDisplayData::isEmpty() const noexcept
+{
+    return reference == nullptr || reference->notes.empty();
+}
 
-    return display;
+size_t PluginProcessor::ReferenceDisplayData::getNumNotes() const noexcept
+{
+    return reference != nullptr ? reference->notes.size() : 0;
+}
+
+int PluginProcessor::ReferenceDisplayData::getNoteNumber (size_t index) const noexcept
+{
+    return reference->notes[index].noteNumber;
+}
+
+PluginProcessor::ReferenceDisplayNote PluginProcessor::ReferenceDisplayData::getNote (size_t index,
+                                                                                     double sampleRate) const noexcept
+{
+    const auto& note = reference->notes[index];
+    ReferenceDisplayNote displayNote;
+    displayNote.noteNumber = note.noteNumber;
+    displayNote.channel = note.channel;
+    displayNote.onSample = secondsToSample (note.onTimeSeconds, sampleRate);
+    displayNote.offSample = secondsToSample (note.offTimeSeconds, sampleRate);
+    return displayNote;
+}
+
+uint64_t PluginProcessor::ReferenceDisplayData::getFirstNoteSample (double sampleRate) const noexcept
+{
+    return isEmpty() ? 0 : secondsToSample (reference->firstNoteTimeSeconds, sampleRate);
+}
+
+const juce::String& PluginProcessor::ReferenceDisplayData::getSourcePath() const noexcept
+{
+    static const juce::String none;
+    return reference != nullptr ? reference->sourcePath : none;
+}
+
+void PluginProcessor::publishReferenceDisplayData (std::shared_ptr<ReferenceDisplayData> display)
+{
+    std::atomic_store (&referenceDisplayData, std::move (display));
+    referenceChangeSequence.fetch_add (1, std::memory_order_release);
 }
 
 std::shared_ptr<PluginProcessor::ReferenceData> PluginProcessor::buildReferenceFromFile (const juce::File& file,
@@ -1180,97 +2504,113 @@ std::shared_ptr<PluginProcessor::ReferenceData> PluginProcessor::buildReferenceF
         return nullptr;
     }
 
-    juce::FileInputStream stream (file);
-    if (! stream.openedOk())
+    // Decode straight from the mapped file; no MidiMessage or sequence copies are made.
+    juce::MemoryMappedFile mappedFile (file, juce::MemoryMappedFile::readOnly);
+    if (mappedFile.getData() == nullptr)
     {
         errorMessage = "Unable to open reference file.";
         return nullptr;
     }
 
-    juce::MidiFile midiFile;
-    if (! midiFile.readFrom (stream))
+    SmfReader reader;
+    if (! reader.open (static_cast<const uint8_t*> (mappedFile.getData()), mappedFile.getSize()))
     {
         errorMessage = "Invalid MIDI file.";
         return nullptr;
     }
 
-    const int timeFormat = midiFile.getTimeFormat();
-
-    juce::MidiMessageSequence combined;
-    for (int i = 0; i < midiFile.getNumTracks(); ++i)
-        combined.addSequence (*midiFile.getTrack (i), 0.0);
-
-    combined.sort();
-    combined.updateMatchedPairs();
+    decodeTracksInParallel (reader);
+    const auto smfTempos = reader.mergeTempos();
+    const SmfReader::TempoMap tempoMap (smfTempos, reader.getTimeFormat());
 
     int timeSigNumerator = 4;
     int timeSigDenominator = 4;
-    juce::MidiMessageSequence timeSigEvents;
-    midiFile.findAllTimeSigEvents (timeSigEvents);
-    timeSigEvents.sort();
-    if (timeSigEvents.getNumEvents() > 0)
+    const auto timeSignatures = reader.mergeTimeSignatures();
+    if (! timeSignatures.empty())
+    {
+        timeSigNumerator = juce::jmax (1, timeSignatures.front().numerator);
+        timeSigDenominator = juce::jmax (1, timeSignatures.front().denominator);
+    }
+
+    const auto smfNotes = reader.mergeNotes();
+    std::vector<ReferenceNote> notes;
+    notes.reserve (smfNotes.size());
+
+    for (const auto& smfNote : smfNotes)
     {
-        int numerator = 4;
-        int denominator = 4;
-        timeSigEvents.getEventPointer (0)->message.getTimeSignatureInfo (numerator, denominator);
-        timeSigNumerator = juce::jmax (1, numerator);
-        timeSigDenominator = juce::jmax (1, denominator);
+        ReferenceNote note;
+        note.noteNumber = smfNote.noteNumber;
+        note.channel = smfNote.channel;
+        note.onVelocity = smfNote.onVelocity;
+        note.offVelocity = smfNote.offVelocity;
+        note.onTimeSeconds = tempoMap.toSeconds (smfNote.onTick);
+        note.offTimeSeconds = tempoMap.toSeconds (smfNote.offTick);
+        notes.push_back (note);
     }
 
-    juce::MidiMessageSequence tempoEvents;
-    midiFile.findAllTempoEvents (tempoEvents);
-    tempoEvents.sort();
-    if (tempoEvents.getNumEvents() == 0)
+    if (notes.empty())
     {
-        auto defaultTempo = juce::MidiMessage::tempoMetaEvent (500000);
-        defaultTempo.setTimeStamp (0.0);
-        tempoEvents.addEvent (defaultTempo);
+        errorMessage = "No note data found in reference file.";
+        return nullptr;
     }
 
     auto reference = std::make_shared<ReferenceData>();
     reference->sourcePath = file.getFullPathName();
-    reference->notes.reserve (static_cast<size_t> (combined.getNumEvents()));
-
-    for (int i = 0; i < combined.getNumEvents(); ++i)
-    {
-        const auto* event = combined.getEventPointer (i);
-        if (event == nullptr)
-            continue;
+    reference->notes = SharedVector<ReferenceNote> (std::move (notes));
 
-        const auto& message = event->message;
-        if (! message.isNoteOn())
-            continue;
+    std::vector<ReferenceTempoEvent> tempoSeconds;
+    tempoSeconds.reserve (smfTempos.size());
 
-        const auto* noteOffEvent = event->noteOffObject;
-        if (noteOffEvent == nullptr)
-            continue;
+    for (const auto& tempo : smfTempos)
+    {
+        const double secondsPerQuarter = static_cast<double> (tempo.microsPerQuarter) / 1000000.0;
+        const double bpm = secondsPerQuarter > 0.0 ? (60.0 / secondsPerQuarter) : 120.0;
+        tempoSeconds.push_back ({ tempoMap.toSeconds (tempo.tick), bpm });
+    }
 
-        const auto& noteOffMessage = noteOffEvent->message;
+    if (tempoSeconds.empty())
+        tempoSeconds.push_back ({ 0.0, 120.0 });
 
-        ReferenceNote note;
-        note.noteNumber = message.getNoteNumber();
-        note.channel = message.getChannel();
-        note.onVelocity = static_cast<uint8_t> (juce::jlimit (0, 127,
-            static_cast<int> (std::lround (message.getVelocity() * 127.0f))));
-        note.offVelocity = static_cast<uint8_t> (juce::jlimit (0, 127,
-            static_cast<int> (std::lround (noteOffMessage.getVelocity() * 127.0f))));
-        note.onTimeSeconds = convertTicksToSeconds (message.getTimeStamp(), tempoEvents, timeFormat);
-        note.offTimeSeconds = convertTicksToSeconds (noteOffMessage.getTimeStamp(), tempoEvents, timeFormat);
+    std::sort (tempoSeconds.begin(), tempoSeconds.end(),
+        [] (const ReferenceTempoEvent& a, const ReferenceTempoEvent& b)
+        {
+            return a.timeSeconds < b.timeSeconds;
+        });
 
-        reference->notes.push_back (note);
+    std::vector<ReferenceTempoEvent> collapsedTempo;
+    collapsedTempo.reserve (tempoSeconds.size());
+    for (const auto& event : tempoSeconds)
+    {
+        if (collapsedTempo.empty() || event.timeSeconds > collapsedTempo.back().timeSeconds + 1.0e-9)
+            collapsedTempo.push_back (event);
+        else
+            collapsedTempo.back() = event;
     }
 
-    if (reference->notes.empty())
+    // Piecewise-linear seconds <-> beats map; the first tempo also covers the time before it.
+    for (size_t i = 0; i < collapsedTempo.size(); ++i)
     {
-        errorMessage = "No note data found in reference file.";
-        return nullptr;
+        const auto& previous = collapsedTempo[i > 0 ? i - 1 : 0];
+        const double previousBeat = i > 0 ? previous.beat : 0.0;
+        const double previousTime = i > 0 ? previous.timeSeconds : 0.0;
+        collapsedTempo[i].beat = previousBeat + (collapsedTempo[i].timeSeconds - previousTime) * previous.bpm / 60.0;
     }
 
+    reference->tempoEvents = SharedVector<ReferenceTempoEvent> (std::move (collapsedTempo));
+    reference->timeSigNumerator = timeSigNumerator;
+    reference->timeSigDenominator = timeSigDenominator;
+    compileReference (*reference, clusterWindowSeconds);
+    return reference;
+}
+
+// Derives everything the follower needs from the notes, tempo map and time signature.
+void PluginProcessor::compileReference (ReferenceData& reference, double clusterWindowSeconds)
+{
     std::vector<double> noteDeltas;
-    noteDeltas.reserve (reference->notes.size());
-    for (size_t i = 1; i < reference->notes.size(); ++i)
+    noteDeltas.reserve (reference.notes.size());
+    for (size_t i = 1; i < reference.notes.size(); ++i)
     {
-        const double delta = reference->notes[i].onTimeSeconds - reference->notes[i - 1].onTimeSeconds;
+        const double delta = reference.notes[i].onTimeSeconds - reference.notes[i - 1].onTimeSeconds;
         if (delta > 0.0)
             noteDeltas.push_back (delta);
     }
@@ -1291,133 +2631,401 @@ std::shared_ptr<PluginProcessor::ReferenceData> PluginProcessor::buildReferenceF
         : derivedClusterWindowSeconds;
 
     const double clampedClusterWindowSeconds = juce::jlimit (0.02, 1.0, appliedClusterWindowSeconds);
-    reference->clusterWindowSeconds = clampedClusterWindowSeconds;
-    reference->minIoiSeconds = minDeltaSeconds;
-    reference->medianIoiSeconds = medianDeltaSeconds;
+    reference.clusterWindowSeconds = clampedClusterWindowSeconds;
+    reference.minIoiSeconds = minDeltaSeconds;
+    reference.medianIoiSeconds = medianDeltaSeconds;
 
-    reference->clusters.clear();
-    reference->clusters.reserve (reference->notes.size());
+    std::vector<ReferenceCluster> clusters;
+    clusters.reserve (reference.notes.size());
     ReferenceCluster cluster;
     cluster.startIndex = 0;
     cluster.noteCount = 1;
-    cluster.startTimeSeconds = reference->notes.front().onTimeSeconds;
-    cluster.endTimeSeconds = reference->notes.front().onTimeSeconds;
+    cluster.startTimeSeconds = reference.notes.front().onTimeSeconds;
+    cluster.endTimeSeconds = reference.notes.front().onTimeSeconds;
 
-    for (int i = 1; i < static_cast<int> (reference->notes.size()); ++i)
+    for (int i = 1; i < static_cast<int> (reference.notes.size()); ++i)
     {
-        const double timeSeconds = reference->notes[static_cast<size_t> (i)].onTimeSeconds;
-        if ((timeSeconds - cluster.startTimeSeconds) <= reference->clusterWindowSeconds)
+        const double timeSeconds = reference.notes[static_cast<size_t> (i)].onTimeSeconds;
+        if ((timeSeconds - cluster.startTimeSeconds) <= reference.clusterWindowSeconds)
         {
             ++cluster.noteCount;
             cluster.endTimeSeconds = timeSeconds;
         }
         else
         {
-            reference->clusters.push_back (cluster);
+            clusters.push_back (cluster);
             cluster.startIndex = i;
             cluster.noteCount = 1;
             cluster.startTimeSeconds = timeSeconds;
             cluster.endTimeSeconds = timeSeconds;
         }
     }
-    reference->clusters.push_back (cluster);
-    reference->clusterMatchedCounts.assign (reference->clusters.size(), 0);
+    clusters.push_back (cluster);
+    reference.clusters = SharedVector<ReferenceCluster> (std::move (clusters));
+    reference.clusterMatchedCounts.assign (reference.clusters.size(), 0);
 
-    std::vector<ReferenceTempoEvent> tempoSeconds;
-    tempoSeconds.reserve (static_cast<size_t> (tempoEvents.getNumEvents()));
+    std::vector<int> clusterPitches;
+    clusterPitches.reserve (reference.clusters.size());
+    for (const auto& refCluster : reference.clusters)
+    {
+        int topPitch = 0;
+        for (int i = refCluster.startIndex; i < refCluster.startIndex + refCluster.noteCount; ++i)
+            topPitch = juce::jmax (topPitch, reference.notes[static_cast<size_t> (i)].noteNumber);
+        clusterPitches.push_back (topPitch);
+    }
+    auto pitchIndex = std::make_shared<PitchNgramIndex>();
+    pitchIndex->build (clusterPitches);
+    reference.pitchIndex = std::move (pitchIndex);
+
+    reference.firstNoteTimeSeconds = reference.notes.front().onTimeSeconds;
+
+    const double bpmForBar = reference.tempoEvents.front().bpm > 0.0
+        ? reference.tempoEvents.front().bpm
+        : 120.0;
+    const double beatFactor = 4.0 / static_cast<double> (juce::jmax (1, reference.timeSigDenominator));
+    const double barBeats = static_cast<double> (juce::jmax (1, reference.timeSigNumerator)) * beatFactor;
+    reference.barDurationSeconds = barBeats * (60.0 / bpmForBar);
+
+    reference.matched.assign (reference.notes.size(), 0);
+
+    const auto identity = static_cast<uint64_t> (reference.sourcePath.hashCode64())
+        ^ (static_cast<uint64_t> (reference.notes.size()) << 24)
+        ^ static_cast<uint64_t> (reference.clusters.size());
+    reference.linkTag = static_cast<uint8_t> (identity ^ (identity >> 8) ^ (identity >> 16) ^ (identity >> 32));
+}
 
-    for (int i = 0; i < tempoEvents.getNumEvents(); ++i)
+// Compressed source data of a reference (notes, tempo map, time signature) for the plugin state.
+// Everything else is derived again by compileReference on recall.
+void PluginProcessor::writeReferenceBlob (const ReferenceData& reference, juce::MemoryBlock& blob)
+{
+    juce::MemoryOutputStream stream;
+    stream.writeString (reference.sourcePath);
+    stream.writeCompressedInt (reference.timeSigNumerator);
+    stream.writeCompressedInt (reference.timeSigDenominator);
+
+    stream.writeCompressedInt (static_cast<int> (reference.tempoEvents.size()));
+    for (const auto& event : reference.tempoEvents)
     {
-        const auto& message = tempoEvents.getEventPointer (i)->message;
-        if (! message.isTempoMetaEvent())
-            continue;
+        stream.writeDouble (event.timeSeconds);
+        stream.writeDouble (event.bpm);
+        stream.writeDouble (event.beat);
+    }
 
-        const double secondsPerQuarter = message.getTempoSecondsPerQuarterNote();
-        const double bpm = secondsPerQuarter > 0.0 ? (60.0 / secondsPerQuarter) : 120.0;
-        const double timeSeconds = convertTicksToSeconds (message.getTimeStamp(), tempoEvents, timeFormat);
-        tempoSeconds.push_back ({ timeSeconds, bpm });
+    stream.writeCompressedInt (static_cast<int> (reference.notes.size()));
+    for (const auto& note : reference.notes)
+    {
+        stream.writeByte (static_cast<char> (note.noteNumber));
+        stream.writeByte (static_cast<char> (note.channel));
+        stream.writeByte (static_cast<char> (note.onVelocity));
+        stream.writeByte (static_cast<char> (note.offVelocity));
+        stream.writeDouble (note.onTimeSeconds);
+        stream.writeDouble (note.offTimeSeconds);
     }
 
-    if (tempoSeconds.empty())
-        tempoSeconds.push_back ({ 0.0, 120.0 });
+    // The inflated size lets the reader refuse oversized data before inflating anything.
+    juce::MemoryOutputStream output (blob, false);
+    output.writeInt (kReferenceBlobVersion);
+    output.writeInt (static_cast<int> (stream.getDataSize()));
+    juce::GZIPCompressorOutputStream compressor (output, 9);
+    compressor.write (stream.getData(), stream.getDataSize());
+    compressor.flush();
+}
 
-    std::sort (tempoSeconds.begin(), tempoSeconds.end(),
-        [] (const ReferenceTempoEvent& a, const ReferenceTempoEvent& b)
-        {
-            return a.timeSeconds < b.timeSeconds;
-        });
+// Compressed once per reference; hosts save state far more often than references change.
+juce::String PluginProcessor::getEmbeddedReferenceText (const std::shared_ptr<ReferenceData>& reference)
+{
+    const juce::ScopedLock lock (embeddedReferenceLock);
+    if (embeddedReferenceSource.lock() != reference)
+    {
+        juce::MemoryBlock blob;
+        writeReferenceBlob (*reference, blob);
+        embeddedReferenceText = blob.toBase64Encoding();
+        embeddedReferenceSource = reference;
+    }
+    return embeddedReferenceText;
+}
 
-    std::vector<ReferenceTempoEvent> collapsedTempo;
-    collapsedTempo.reserve (tempoSeconds.size());
-    for (const auto& event : tempoSeconds)
+std::shared_ptr<PluginProcessor::ReferenceData> PluginProcessor::readReferenceBlob (const juce::MemoryBlock& blob,
+                                                                                   double clusterWindowSeconds,
+                                                                                   juce::String& errorMessage)
+{
+    juce::MemoryInputStream header (blob, false);
+    if (blob.getSize() < static_cast<size_t> (kReferenceBlobHeaderBytes) || header.readInt() != kReferenceBlobVersion)
     {
-        if (collapsedTempo.empty() || event.timeSeconds > collapsedTempo.back().timeSeconds + 1.0e-9)
-            collapsedTempo.push_back (event);
-        else
-            collapsedTempo.back() = event;
+        errorMessage = "Unsupported embedded reference.";
+        return nullptr;
     }
 
-    reference->tempoEvents = std::move (collapsedTempo);
-    reference->firstNoteTimeSeconds = reference->notes.front().onTimeSeconds;
-    reference->timeSigNumerator = timeSigNumerator;
-    reference->timeSigDenominator = timeSigDenominator;
+    const auto corrupt = [&errorMessage]
+    {
+        errorMessage = "Corrupt embedded reference.";
+        return std::shared_ptr<ReferenceData>();
+    };
 
-    const double bpmForBar = reference->tempoEvents.front().bpm > 0.0
-        ? reference->tempoEvents.front().bpm
-        : 120.0;
-    const double beatFactor = 4.0 / static_cast<double> (juce::jmax (1, timeSigDenominator));
-    const double barBeats = static_cast<double> (juce::jmax (1, timeSigNumerator)) * beatFactor;
-    reference->barDurationSeconds = barBeats * (60.0 / bpmForBar);
+    // Inflated up front (never past the size the header declares) so every count can be checked
+    // against the bytes actually there.
+    const int inflatedBytes = header.readInt();
+    if (inflatedBytes <= 0 || inflatedBytes > kMaxReferenceBlobBytes)
+        return corrupt();
 
-    if (sampleRateHz > 0.0)
-        updateReferenceSampleTimes (*reference, sampleRateHz);
+    juce::MemoryBlock inflated;
+    {
+        juce::MemoryInputStream input (static_cast<const char*> (blob.getData()) + kReferenceBlobHeaderBytes,
+                                       blob.getSize() - static_cast<size_t> (kReferenceBlobHeaderBytes),
+                                       false);
+        juce::GZIPDecompressorInputStream decompressor (input);
+        decompressor.readIntoMemoryBlock (inflated, inflatedBytes);
+    }
 
-    reference->matched.assign (reference->notes.size(), 0);
+    if (inflated.getSize() != static_cast<size_t> (inflatedBytes))
+    {
+        errorMessage = "Truncated embedded reference.";
+        return nullptr;
+    }
+
+    juce::MemoryInputStream stream (inflated, false);
+
+    auto reference = std::make_shared<ReferenceData>();
+    reference->sourcePath = stream.readString();
+    reference->timeSigNumerator = juce::jmax (1, stream.readCompressedInt());
+    reference->timeSigDenominator = juce::jmax (1, stream.readCompressedInt());
+
+    const int tempoCount = stream.readCompressedInt();
+    if (tempoCount <= 0 || tempoCount > kMaxReferenceBlobEvents
+        || stream.getNumBytesRemaining() < static_cast<juce::int64> (tempoCount) * kReferenceBlobTempoBytes)
+        return corrupt();
+
+    // Tempo events are the piecewise tempo map: ascending, finite, positive tempos.
+    std::vector<ReferenceTempoEvent> tempoEvents (static_cast<size_t> (tempoCount));
+    const ReferenceTempoEvent* previousEvent = nullptr;
+    for (auto& event : tempoEvents)
+    {
+        event.timeSeconds = stream.readDouble();
+        event.bpm = stream.readDouble();
+        event.beat = stream.readDouble();
+        if (! std::isfinite (event.timeSeconds) || ! std::isfinite (event.bpm) || ! std::isfinite (event.beat)
+            || event.timeSeconds < 0.0 || event.bpm <= 0.0
+            || (previousEvent != nullptr && (event.timeSeconds < previousEvent->timeSeconds || event.beat < previousEvent->beat)))
+            return corrupt();
+        previousEvent = &event;
+    }
+
+    const int noteCount = stream.readCompressedInt();
+    if (noteCount <= 0 || noteCount > kMaxReferenceBlobEvents)
+        return corrupt();
+    if (stream.getNumBytesRemaining() < static_cast<juce::int64> (noteCount) * kReferenceBlobNoteBytes)
+    {
+        errorMessage = "Truncated embedded reference.";
+        return nullptr;
+    }
+
+    // Matching relies on notes sorted by onset.
+    std::vector<ReferenceNote> notes (static_cast<size_t> (noteCount));
+    double previousOnSeconds = 0.0;
+    for (auto& note : notes)
+    {
+        note.noteNumber = static_cast<uint8_t> (stream.readByte()) & 0x7f;
+        note.channel = juce::jlimit (1, 16, static_cast<int> (static_cast<uint8_t> (stream.readByte())));
+        note.onVelocity = static_cast<uint8_t> (stream.readByte());
+        note.offVelocity = static_cast<uint8_t> (stream.readByte());
+        note.onTimeSeconds = stream.readDouble();
+        note.offTimeSeconds = stream.readDouble();
+        if (! std::isfinite (note.onTimeSeconds) || ! std::isfinite (note.offTimeSeconds)
+            || note.onTimeSeconds < previousOnSeconds || note.offTimeSeconds < note.onTimeSeconds)
+            return corrupt();
+        previousOnSeconds = note.onTimeSeconds;
+    }
+
+    reference->tempoEvents = SharedVector<ReferenceTempoEvent> (std::move (tempoEvents));
+    reference->notes = SharedVector<ReferenceNote> (std::move (notes));
+    compileReference (*reference, clusterWindowSeconds);
     return reference;
 }
 
 bool PluginProcessor::loadReferenceFromFile (const juce::File& file, juce::String& errorMessage)
 {
-    if (transportPlaying.load (std::memory_order_relaxed))
+    if (! file.existsAsFile())
     {
-        errorMessage = "Stop the transport before loading a reference.";
-        pendingReferencePath = file.getFullPathName();
+        errorMessage = "Reference file not found.";
+        // Supersedes any reference still being built or decoded.
+        referenceRequestSequence.fetch_add (1, std::memory_order_acq_rel);
         lastReferenceLoadError = errorMessage;
+        referenceChangeSequence.fetch_add (1, std::memory_order_release);
         return false;
     }
 
-    double clusterWindowSeconds = 0.0;
+    requestReference (file, getClusterWindowSeconds());
+    return true;
+}
+
+// Message thread. A cached reference is selected at once; otherwise the cache thread builds it
+// and the selection happens back on the message thread, unless a newer request came in meanwhile.
+void PluginProcessor::requestReference (const juce::File& file, double clusterWindowSeconds)
+{
+    const uint32_t request = referenceRequestSequence.fetch_add (1, std::memory_order_acq_rel) + 1;
+    const juce::WeakReference<PluginProcessor> weakThis (this);
+
+    auto cached = referenceCache.get (file, clusterWindowSeconds,
+        [weakThis, request] (std::shared_ptr<const ReferenceData> built, const juce::String& errorMessage)
+        {
+            juce::MessageManager::callAsync ([weakThis, request, built, errorMessage]
+            {
+                if (auto* processor = weakThis.get())
+                    processor->selectCachedReference (request, built, errorMessage);
+            });
+        });
+
+    if (cached != nullptr)
+        selectCachedReference (request, std::move (cached), {});
+}
+
+void PluginProcessor::selectCachedReference (uint32_t request,
+                                             std::shared_ptr<const ReferenceData> cached,
+                                             const juce::String& errorMessage)
+{
+    if (request != referenceRequestSequence.load (std::memory_order_acquire))
+        return;
+
+    if (cached == nullptr)
+    {
+        lastReferenceLoadError = errorMessage;
+        referenceChangeSequence.fetch_add (1, std::memory_order_release);
+        return;
+    }
+
+    auto baseReference = instantiateReference (*cached);
+    queueReferenceSwap (baseReference);
+
+    referencePath = baseReference->sourcePath;
+    apvts.state.setProperty (kReferencePathProperty, referencePath, nullptr);
+    lastReferenceLoadError.clear();
+    publishReferenceDisplayData (buildReferenceDisplayData (baseReference));
+}
+
+void PluginProcessor::preloadReferences (const juce::Array<juce::File>& files)
+{
+    referenceCache.preload (files, getClusterWindowSeconds());
+}
+
+double PluginProcessor::getClusterWindowSeconds() const noexcept
+{
     if (clusterWindowMsParam != nullptr)
     {
         const float ms = clusterWindowMsParam->load();
         if (ms > 0.0f)
-            clusterWindowSeconds = static_cast<double> (ms) / 1000.0;
+            return static_cast<double> (ms) / 1000.0;
     }
+    return 0.0;
+}
+
+// Working copy of a cached reference: the audio thread writes matched flags and cluster counts,
+// so cached references are never published directly.
+std::shared_ptr<PluginProcessor::ReferenceData> PluginProcessor::instantiateReference (const ReferenceData& base)
+{
+    auto reference = std::make_shared<ReferenceData> (base);
+    prepareReference (*reference);
+    return reference;
+}
+
+void PluginProcessor::prepareReference (ReferenceData& reference)
+{
+    if (sampleRateHz > 0.0)
+        updateReferenceSampleTimes (reference, sampleRateHz);
+    warmUpReference (reference);
+}
+
+// Every reference change goes through here, playing or not: processBlock swaps it in at the next
+// block (carrying the follower over by time while playing), so referenceData is only replaced on
+// the audio thread. nullptr clears the reference. The reference parked at the previous swap is
+// freed here, letting this swap go ahead.
+void PluginProcessor::queueReferenceSwap (std::shared_ptr<ReferenceData> reference)
+{
+    std::atomic_store (&pendingReference, std::move (reference));
+    referenceSwapSequence.fetch_add (1, std::memory_order_release);
 
-    auto baseReference = buildReferenceFromFile (file,
-        clusterWindowSeconds,
-        errorMessage);
-    if (baseReference == nullptr)
+    if (retiredReferencePending.load (std::memory_order_acquire))
     {
-        lastReferenceLoadError = errorMessage;
-        return false;
+        std::atomic_store (&retiredReference, std::shared_ptr<ReferenceData>());
+        retiredReferencePending.store (false, std::memory_order_release);
     }
+}
 
-    std::atomic_store (&referenceData, baseReference);
-    std::atomic_store (&referenceDisplayData, buildReferenceDisplayData (*baseReference));
-    referencePath = baseReference->sourcePath;
-    apvts.state.setProperty (kReferencePathProperty, referencePath, nullptr);
-    referenceTempoIndex = 0;
-    resetPlaybackState();
-    clearMissLog();
-    userStartSampleCaptured = false;
-    startOffsetMs.store (0.0f, std::memory_order_relaxed);
-    startOffsetBars.store (0.0f, std::memory_order_relaxed);
-    startOffsetValid.store (false, std::memory_order_relaxed);
-    pendingReferencePath.clear();
-    lastReferenceLoadError.clear();
+void PluginProcessor::adoptPendingReference (std::shared_ptr<ReferenceData>& reference) noexcept
+{
+    // The previous swap's reference must have been collected first; it is freed off this thread.
+    const uint32_t swapSequence = referenceSwapSequence.load (std::memory_order_acquire);
+    if (swapSequence == adoptedSwapSequence || retiredReferencePending.load (std::memory_order_acquire))
+        return;
 
-    return true;
+    // pendingReference keeps the latest queued reference, so a swap that raced a newer one just
+    // finds it already adopted.
+    adoptedSwapSequence = swapSequence;
+    auto incoming = std::atomic_load (&pendingReference);
+    if (incoming == reference)
+        return;
+
+    // Prepared before the last prepareToPlay changed the rate; only the first note sample moves.
+    if (incoming != nullptr && sampleRateHz > 0.0 && (! incoming->sampleTimesValid || incoming->sampleRate != sampleRateHz))
+        updateReferenceSampleTimes (*incoming, sampleRateHz);
+
+    // Where the performance is in the outgoing reference, in reference seconds.
+    double referenceSeconds = incoming != nullptr ? incoming->firstNoteTimeSeconds : 0.0;
+    if (transportWasPlaying && reference != nullptr && reference->sampleTimesValid && sampleRateHz > 0.0)
+    {
+        referenceSeconds = followingHostTempo
+            ? referenceBeatsToSeconds (*reference, tempoAnchorBeat)
+            : reference->firstNoteTimeSeconds
+                + (static_cast<double> (timelineSample) - static_cast<double> (referenceTransportStartSample)) / sampleRateHz;
+    }
+
+    if (reference != nullptr)
+    {
+        std::atomic_store (&retiredReference, reference);
+        retiredReferencePending.store (true, std::memory_order_release);
+    }
+    std::atomic_store (&referenceData, incoming);
+    reference = std::move (incoming);
+
+    // Stopped (or cleared): start from scratch, as a new transport start would.
+    if (reference == nullptr || ! transportWasPlaying)
+    {
+        resetPlaybackState();
+        clearMissLog();
+        return;
+    }
+
+    // Notes already matched against the old reference release as they were played.
+    for (int i = 0; i < activeNoteCount; ++i)
+    {
+        if (activeNotes[static_cast<size_t> (i)].refIndex >= 0)
+            activeNotes[static_cast<size_t> (i)].refIndex = kSwappedRefIndex;
+    }
+
+    const auto& clusters = reference->clusters;
+    const auto found = std::partition_point (clusters.begin(), clusters.end(),
+        [referenceSeconds](const ReferenceCluster& cluster) { return cluster.endTimeSeconds < referenceSeconds; });
+    const auto totalClusters = static_cast<int> (clusters.size());
+    referenceClusterCursor = static_cast<int> (found - clusters.begin());
+    referenceClusterMatchedCount = 0;
+    clusterMissStreak = 0;
+    extraNoteStreak = 0;
+    lostNoteCount = 0;
+    relocaliseCandidateCount = 0;
+    recentOnsetCount = 0;
+    pendingClearFrom = 0;
+    pendingClearTo = -1;
+    hmmFollower.reset (juce::jmax (0, juce::jmin (referenceClusterCursor, totalClusters - 1)));
+    dtwFollower.reset (juce::jmax (0, juce::jmin (referenceClusterCursor, totalClusters - 1)));
+    referenceTempoIndex = 0;
+    referenceTimeMapIndex = 0;
+    checkpointCount = 0;
+    tempoTracker.reset();
+    tempoEstimator.reset();
+    tempoEstimateValid.store (false, std::memory_order_relaxed);
+    linkFollowAfterSample = timelineSample;
+    if (transportWasPlaying)
+        anchorReferenceAt (reference.get(), timelineSample, referenceSeconds);
+    uiResyncPending = true;
 }
 
 juce::String PluginProcessor::getReferencePath() const
@@ -1430,16 +3038,6 @@ juce::String PluginProcessor::getReferenceLoadError() const
     return lastReferenceLoadError;
 }
 
-bool PluginProcessor::consumePendingReferencePath (juce::String& path)
-{
-    if (pendingReferencePath.isEmpty())
-        return false;
-
-    path = pendingReferencePath;
-    pendingReferencePath.clear();
-    return true;
-}
-
 juce::AudioProcessorEditor* PluginProcessor::createEditor()
 {
     return new PluginEditor (*this);
@@ -1455,10 +3053,15 @@ void PluginProcessor::advanceClusterCursor (ReferenceData& reference) noexcept
     {
         const auto& cluster = reference.clusters[static_cast<size_t> (referenceClusterCursor)];
         const int matchedCount = reference.clusterMatchedCounts[static_cast<size_t> (referenceClusterCursor)];
-        if (matchedCount < cluster.noteCount)
+        // Linked, the other instances play the notes on channels this one has not matched on.
+        const int requiredCount = linkedChannelMask != 0
+            ? countLinkedChannelNotes (reference, referenceClusterCursor)
+            : cluster.noteCount;
+        if (matchedCount < requiredCount)
             break;
 
         ++referenceClusterCursor;
+        clearPendingMatches (reference, referenceClusterCursor + kMatchReachClusters);
     }
 
     if (referenceClusterCursor < totalClusters
@@ -1473,7 +3076,7 @@ void PluginProcessor::advanceClusterCursor (ReferenceData& reference) noexcept
     }
 }
 
-int PluginProcessor::removeOldestActiveNote (int noteNumber, int channel) noexcept
+int PluginProcessor::removeOldestActiveNote (int noteNumber, int channel, uint64_t* onBaseSample) noexcept
 {
     if (activeNoteCount <= 0)
         return -1;
@@ -1498,11 +3101,66 @@ int PluginProcessor::removeOldestActiveNote (int noteNumber, int channel) noexce
         return -1;
 
     const int refIndex = activeNotes[matchIndex].refIndex;
+    if (onBaseSample != nullptr)
+        *onBaseSample = activeNotes[matchIndex].onBaseSample;
     activeNotes[matchIndex] = activeNotes[activeNoteCount - 1];
     --activeNoteCount;
     return refIndex;
 }
 
+template <typename Follower>
+int PluginProcessor::matchReferenceNoteWithFollower (Follower& follower,
+                                                     int noteNumber,
+                                                     int channel,
+                                                     int pitchTolerance,
+                                                     ReferenceData& reference) noexcept
+{
+    const auto totalClusters = static_cast<int> (reference.clusters.size());
+    if (reference.matched.size() != reference.notes.size())
+        return -1;
+    if (reference.clusterMatchedCounts.size() != reference.clusters.size())
+        return -1;
+
+    [[maybe_unused]] const int previousPosition = follower.getPosition();
+    const auto result = follower.observe (reference, reference.matched.data(), noteNumber, channel, pitchTolerance);
+    const int clusterIndex = result.clusterIndex;
+    const int noteIndex = result.noteIndex;
+
+    if (noteIndex < 0 || clusterIndex < 0 || clusterIndex >= totalClusters)
+        return -1;
+
+    // Only a follower that models back-jumps (HMM) can mean one; a DTW match behind the cursor
+    // just fills in a note the cursor moved past.
+    if constexpr (Follower::kJumpsBack)
+    {
+        if (clusterIndex < referenceClusterCursor || clusterIndex < previousPosition)
+        {
+            // Jumped back: forget what was matched from here on so the passage can be followed again.
+            const int lastCluster = juce::jmin (totalClusters - 1, juce::jmax (referenceClusterCursor, previousPosition));
+            for (int c = clusterIndex; c <= lastCluster; ++c)
+            {
+                const auto& cluster = reference.clusters[static_cast<size_t> (c)];
+                for (int i = cluster.startIndex; i < cluster.startIndex + cluster.noteCount; ++i)
+                    reference.matched[static_cast<size_t> (i)] = 0;
+                reference.clusterMatchedCounts[static_cast<size_t> (c)] = 0;
+            }
+
+            referenceClusterCursor = juce::jmin (referenceClusterCursor, clusterIndex);
+        }
+    }
+
+    const auto& cluster = reference.clusters[static_cast<size_t> (clusterIndex)];
+    reference.matched[static_cast<size_t> (noteIndex)] = 1;
+    auto& matchedCount = reference.clusterMatchedCounts[static_cast<size_t> (clusterIndex)];
+    if (matchedCount < cluster.noteCount)
+        ++matchedCount;
+    clusterMissStreak = 0;
+    advanceClusterCursor (reference);
+
+    return noteIndex;
+}
+
+template <typename PitchPolicy>
 int PluginProcessor::matchReferenceNoteInCluster (int noteNumber,
                                                   int channel,
                                                   int pitchTolerance,
@@ -1518,7 +3176,7 @@ int PluginProcessor::matchReferenceNoteInCluster (int noteNumber,
     if (reference.clusterMatchedCounts.size() != reference.clusters.size())
         return -1;
 
-    const int clampedTolerance = juce::jmax (0, pitchTolerance);
+    const int clampedTolerance = PitchPolicy::tolerance (pitchTolerance);
 
     auto findNoteIndexInCluster = [&](int clusterIndex) -> int
     {
@@ -1545,10 +3203,13 @@ int PluginProcessor::matchReferenceNoteInCluster (int noteNumber,
             const int delta = std::abs (refNote.noteNumber - noteNumber);
             if (delta == 0)
                 return i;
-            if (delta <= clampedTolerance && delta < bestDelta)
+            if constexpr (PitchPolicy::allowsNeighbours)
             {
-                bestDelta = delta;
-                bestIndex = i;
+                if (delta <= clampedTolerance && delta < bestDelta)
+                {
+                    bestDelta = delta;
+                    bestIndex = i;
+                }
             }
         }
 
@@ -1611,20 +3272,419 @@ void PluginProcessor::handleClusterMiss (ReferenceData& reference) noexcept
     clusterMissStreak = 0;
 }
 
+bool PluginProcessor::markCurrentClusterMissing (ReferenceData& reference) noexcept
+{
+    const auto totalClusters = static_cast<int> (reference.clusters.size());
+    if (referenceClusterCursor >= totalClusters)
+        return false;
+    if (reference.matched.size() != reference.notes.size())
+        return false;
+    if (reference.clusterMatchedCounts.size() != reference.clusters.size())
+        return false;
+
+    const int totalNotes = static_cast<int> (reference.notes.size());
+    const auto& cluster = reference.clusters[static_cast<size_t> (referenceClusterCursor)];
+    const int startIndex = cluster.startIndex;
+    const int endIndex = startIndex + cluster.noteCount;
+    if (startIndex < 0 || endIndex > totalNotes)
+        return false;
+
+    int missingCount = 0;
+    for (int i = startIndex; i < endIndex; ++i)
+    {
+        if (reference.matched[static_cast<size_t> (i)] == 0)
+        {
+            reference.matched[static_cast<size_t> (i)] = 1;
+            const int noteChannel = reference.notes[static_cast<size_t> (i)].channel;
+            if (linkedChannelMask == 0 || ((linkedChannelMask >> (noteChannel - 1)) & 1u) != 0)
+                ++missingCount;
+        }
+    }
+
+    if (missingCount > 0)
+        missedNoteOnCounter.fetch_add (missingCount, std::memory_order_relaxed);
+
+    reference.clusterMatchedCounts[static_cast<size_t> (referenceClusterCursor)] = cluster.noteCount;
+    clusterMissStreak = 0;
+    advanceClusterCursor (reference);
+    extraNoteStreak = 0;
+    return true;
+}
+
+void PluginProcessor::pushRecentOnset (const BlockContext& context, int noteNumber, uint64_t userSample) noexcept
+{
+    // Notes within the cluster window form one onset, represented by its highest pitch as in the index.
+    const uint64_t windowSamples = msToSamples (sampleRateHz, context.clusterWindowMs);
+    if (recentOnsetCount > 0 && userSample <= lastOnsetSample + windowSamples)
+    {
+        auto& top = recentOnsetPitches[static_cast<size_t> (recentOnsetCount - 1)];
+        top = juce::jmax (top, noteNumber);
+        return;
+    }
+
+    if (recentOnsetCount == PitchNgramIndex::kLength)
+    {
+        std::copy (recentOnsetPitches.begin() + 1, recentOnsetPitches.end(), recentOnsetPitches.begin());
+        --recentOnsetCount;
+    }
+
+    recentOnsetPitches[static_cast<size_t> (recentOnsetCount++)] = noteNumber;
+    lastOnsetSample = userSample;
+}
+
+bool PluginProcessor::relocaliseIfLost (BlockContext& context, ReferenceData& reference, uint64_t userSample,
+                                        bool spendsWork) noexcept
+{
+    if (++lostNoteCount < kMaxClusterMissStreak)
+        return false;
+    if (recentOnsetCount < PitchNgramIndex::kLength || reference.pitchIndex == nullptr || reference.pitchIndex->isEmpty())
+        return false;
+
+    // Paid from the block's work budget like matching; without it the next lost note tries again.
+    if (spendsWork)
+    {
+        if (context.workRemaining < kRelocaliseWork)
+            return false;
+        context.workRemaining -= kRelocaliseWork;
+    }
+
+    std::array<int, kMaxRelocaliseCandidates> found {};
+    const int foundCount = reference.pitchIndex->find (recentOnsetPitches.data(),
+        referenceClusterCursor,
+        found.data(),
+        kMaxRelocaliseCandidates);
+
+    // A candidate is confirmed when the next onset's n-gram lands just after it.
+    int target = -1;
+    for (int i = 0; i < foundCount && target < 0; ++i)
+    {
+        for (int j = 0; j < relocaliseCandidateCount; ++j)
+        {
+            const int step = found[static_cast<size_t> (i)] - relocaliseCandidates[static_cast<size_t> (j)];
+            if (step > 0 && step <= kMaxRelocaliseStep)
+            {
+                target = found[static_cast<size_t> (i)];
+                break;
+            }
+        }
+    }
+
+    std::copy_n (found.begin(), foundCount, relocaliseCandidates.begin());
+    relocaliseCandidateCount = foundCount;
+
+    if (target < 0)
+        return false;
+
+    jumpToCluster (reference, target);
+    linkFollowAfterSample = userSample;
+
+    // Re-anchor the reference so the target cluster lines up with the note that confirmed it.
+    if (! context.hostLocked)
+        anchorReferenceAt (&reference, userSample, reference.clusters[static_cast<size_t> (target)].startTimeSeconds);
+
+    tempoTracker.reset();
+    tempoEstimator.reset();
+    return true;
+}
+
+void PluginProcessor::jumpToCluster (ReferenceData& reference, int clusterIndex) noexcept
+{
+    const auto totalClusters = static_cast<int> (reference.clusters.size());
+    if (clusterIndex < 0 || clusterIndex >= totalClusters)
+        return;
+    if (reference.matched.size() != reference.notes.size())
+        return;
+    if (reference.clusterMatchedCounts.size() != reference.clusters.size())
+        return;
+
+    // Forget matches from the target up to wherever matching may have reached, so the passage can
+    // be followed again. Only what matching can reach from the target is cleared now.
+    const int lastCluster = juce::jmin (totalClusters - 1, getMatchReach());
+    if (pendingClearFrom <= pendingClearTo)
+    {
+        pendingClearFrom = juce::jmin (pendingClearFrom, clusterIndex);
+        pendingClearTo = juce::jmax (pendingClearTo, lastCluster);
+    }
+    else
+    {
+        pendingClearFrom = clusterIndex;
+        pendingClearTo = lastCluster;
+    }
+
+    referenceClusterCursor = clusterIndex;
+    referenceClusterMatchedCount = 0;
+    clusterMissStreak = 0;
+    extraNoteStreak = 0;
+    lostNoteCount = 0;
+    relocaliseCandidateCount = 0;
+    hmmFollower.reset (clusterIndex);
+    dtwFollower.reset (clusterIndex);
+    clearPendingMatches (reference, getMatchReach());
+}
+
+// Clears pending clusters up to throughCluster. Each is cleared once, so the cost of a long jump
+// back is spread over the blocks and note-ons that follow it.
+void PluginProcessor::clearPendingMatches (ReferenceData& reference, int throughCluster) noexcept
+{
+    static_assert (kMatchReachClusters >= kMaxClusterLookahead + HmmFollower<ReferenceData>::kBeamWidth
+                   && kMatchReachClusters >= kMaxClusterLookahead + DtwFollower<ReferenceData>::kBandWidth);
+
+    const int lastCluster = juce::jmin (throughCluster, pendingClearTo);
+    if (pendingClearFrom > lastCluster)
+        return;
+
+    if (reference.matched.size() == reference.notes.size()
+        && reference.clusterMatchedCounts.size() == reference.clusters.size()
+        && lastCluster < static_cast<int> (reference.clusters.size()))
+    {
+        for (int c = pendingClearFrom; c <= lastCluster; ++c)
+        {
+            const auto& cluster = reference.clusters[static_cast<size_t> (c)];
+            std::fill_n (reference.matched.begin() + cluster.startIndex, cluster.noteCount, uint8_t { 0 });
+            reference.clusterMatchedCounts[static_cast<size_t> (c)] = 0;
+        }
+    }
+
+    pendingClearFrom = lastCluster + 1;
+}
+
+int PluginProcessor::getMatchReach() const noexcept
+{
+    return juce::jmax (referenceClusterCursor, hmmFollower.getPosition(), dtwFollower.getPosition()) + kMatchReachClusters;
+}
+
+void PluginProcessor::followLinkedPosition (ReferenceData& reference, int linkGroup, uint64_t nowSample) noexcept
+{
+    // Trail the group by a cluster, so a note played a little after the other part's next one still matches.
+    const auto position = followerLink->read (linkGroup);
+    const int target = position.cluster - 1;
+    const auto totalClusters = static_cast<int> (reference.clusters.size());
+    if (target <= referenceClusterCursor || target >= totalClusters)
+        return;
+    if (position.referenceTag != reference.linkTag)
+        return;
+    if (reference.matched.size() != reference.notes.size())
+        return;
+    if (reference.clusterMatchedCounts.size() != reference.clusters.size())
+        return;
+
+    // Only recent positions matched since this instance last restarted, sought or relocalised, and
+    // not later than now: after a host loop back, the other members' positions from before it are.
+    if (! FollowerLink::isRecent (position.time, nowSample, msToSamples (sampleRateHz, kLinkedPositionStaleMs))
+        || FollowerLink::elapsed (position.time, nowSample) < 0
+        || FollowerLink::elapsed (position.time, linkFollowAfterSample) > 0)
+        return;
+
+    // The group has played past these; what is left in them is not this instance's miss.
+    clearPendingMatches (reference, target + kMatchReachClusters);
+    for (int c = referenceClusterCursor; c < target; ++c)
+    {
+        const auto& cluster = reference.clusters[static_cast<size_t> (c)];
+        for (int i = cluster.startIndex; i < cluster.startIndex + cluster.noteCount; ++i)
+            reference.matched[static_cast<size_t> (i)] = 1;
+        reference.clusterMatchedCounts[static_cast<size_t> (c)] = cluster.noteCount;
+    }
+
+    referenceClusterCursor = target;
+    clusterMissStreak = 0;
+    extraNoteStreak = 0;
+    lostNoteCount = 0;
+    if (hmmFollower.getPosition() < target)
+        hmmFollower.reset (target);
+    if (dtwFollower.getPosition() < target)
+        dtwFollower.reset (target);
+    advanceClusterCursor (reference);
+}
+
+void PluginProcessor::publishLinkedPosition (const BlockContext& context,
+                                             const ReferenceData& reference,
+                                             int refIndex,
+                                             uint64_t userSample) noexcept
+{
+    // Clusters are consecutive runs of notes: the match is in the last one starting at or before it.
+    const auto& clusters = reference.clusters;
+    const auto after = std::upper_bound (clusters.begin(), clusters.end(), refIndex,
+        [](int index, const ReferenceCluster& cluster) { return index < cluster.startIndex; });
+    if (after == clusters.begin())
+        return;
+
+    followerLink->publish (context.linkGroup,
+        reference.linkTag,
+        static_cast<int> (after - clusters.begin()) - 1,
+        userSample,
+        msToSamples (sampleRateHz, kLinkedPositionStaleMs));
+}
+
+int PluginProcessor::countLinkedChannelNotes (const ReferenceData& reference, int clusterIndex) const noexcept
+{
+    const auto& cluster = reference.clusters[static_cast<size_t> (clusterIndex)];
+    int count = 0;
+    for (int i = cluster.startIndex; i < cluster.startIndex + cluster.noteCount; ++i)
+    {
+        const int channel = reference.notes[static_cast<size_t> (i)].channel;
+        if (((linkedChannelMask >> (channel - 1)) & 1u) != 0)
+            ++count;
+    }
+    return count;
+}
+
+void PluginProcessor::recordCheckpoint (uint64_t hostSamplePosition) noexcept
+{
+    if (checkpointCount > 0)
+    {
+        const auto& last = checkpoints[static_cast<size_t> (checkpointCount - 1)];
+        if (hostSamplePosition < last.hostSample + checkpointIntervalSamples)
+            return;
+    }
+    else
+    {
+        checkpointIntervalSamples = juce::jmax<uint64_t> (1, msToSamples (sampleRateHz, kCheckpointIntervalMs));
+    }
+
+    if (checkpoints.isEmpty())
+        return;
+
+    if (checkpointCount == checkpoints.capacity())
+    {
+        // Keep every other checkpoint and space new ones twice as far apart.
+        for (int i = 0; i < checkpoints.capacity() / 2; ++i)
+            checkpoints[static_cast<size_t> (i)] = checkpoints[static_cast<size_t> (i * 2)];
+        checkpointCount = checkpoints.capacity() / 2;
+        checkpointIntervalSamples *= 2;
+    }
+
+    auto& checkpoint = checkpoints[static_cast<size_t> (checkpointCount++)];
+    checkpoint.hostSample = hostSamplePosition;
+    checkpoint.clusterCursor = referenceClusterCursor;
+    checkpoint.clusterMissStreak = clusterMissStreak;
+    checkpoint.extraNoteStreak = extraNoteStreak;
+    checkpoint.userVelocityEma = userVelocityEma;
+    checkpoint.referenceVelocityEma = referenceVelocityEma;
+    checkpoint.userVelocityEmaValid = userVelocityEmaValid;
+    checkpoint.referenceVelocityEmaValid = referenceVelocityEmaValid;
+    checkpoint.tempoTracker = tempoTracker;
+    checkpoint.tempoEstimator = tempoEstimator;
+}
+
+void PluginProcessor::seekToHostSample (ReferenceData* reference,
+                                        uint64_t hostSamplePosition,
+                                        double referenceSeconds) noexcept
+{
+    if (reference == nullptr || ! reference->sampleTimesValid || reference->clusters.empty() || sampleRateHz <= 0.0)
+        return;
+
+    referenceTransportStartSample = reference->firstNoteSample;
+
+    // Latest checkpoint at or before the new position.
+    const auto checkpointsEnd = checkpoints.data() + checkpointCount;
+    const auto after = std::upper_bound (checkpoints.data(), checkpointsEnd, hostSamplePosition,
+        [](uint64_t position, const FollowerCheckpoint& checkpoint) { return position < checkpoint.hostSample; });
+    checkpointCount = static_cast<int> (after - checkpoints.data());
+
+    int cursor = 0;
+    if (checkpointCount > 0)
+    {
+        const auto& checkpoint = checkpoints[static_cast<size_t> (checkpointCount - 1)];
+        cursor = checkpoint.clusterCursor;
+        clusterMissStreak = checkpoint.clusterMissStreak;
+        extraNoteStreak = checkpoint.extraNoteStreak;
+        userVelocityEma = checkpoint.userVelocityEma;
+        referenceVelocityEma = checkpoint.referenceVelocityEma;
+        userVelocityEmaValid = checkpoint.userVelocityEmaValid;
+        referenceVelocityEmaValid = checkpoint.referenceVelocityEmaValid;
+        tempoTracker = checkpoint.tempoTracker;
+        tempoEstimator = checkpoint.tempoEstimator;
+    }
+    else
+    {
+        // First cluster that has not finished by the new position.
+        const auto& clusters = reference->clusters;
+        const auto found = std::partition_point (clusters.begin(), clusters.end(),
+            [referenceSeconds](const ReferenceCluster& cluster) { return cluster.endTimeSeconds < referenceSeconds; });
+        cursor = static_cast<int> (found - clusters.begin());
+    }
+
+    const auto totalClusters = static_cast<int> (reference->clusters.size());
+    referenceClusterCursor = juce::jlimit (0, totalClusters, cursor);
+    referenceClusterMatchedCount = 0;
+    hmmFollower.reset (juce::jmin (referenceClusterCursor, totalClusters - 1));
+    dtwFollower.reset (juce::jmin (referenceClusterCursor, totalClusters - 1));
+    clearPendingMatches (*reference, getMatchReach());
+}
+
+void PluginProcessor::anchorReferenceAt (const ReferenceData* reference,
+                                         uint64_t userSample,
+                                         double referenceSeconds) noexcept
+{
+    if (reference == nullptr || sampleRateHz <= 0.0)
+    {
+        referenceTransportStartSample = userSample;
+        return;
+    }
+
+    const double offsetSamples = (referenceSeconds - reference->firstNoteTimeSeconds) * sampleRateHz;
+    const auto offset = static_cast<int64_t> (std::llround (offsetSamples));
+    const auto start = static_cast<int64_t> (userSample) - offset;
+    referenceTransportStartSample = start > 0 ? static_cast<uint64_t> (start) : 0;
+
+    tempoAnchorSample = userSample;
+    if (! reference->tempoEvents.empty())
+        tempoAnchorBeat = referenceSecondsToBeats (*reference, referenceSeconds);
+}
+
+double PluginProcessor::referenceSecondsToBeats (const ReferenceData& reference, double seconds) noexcept
+{
+    const auto& events = reference.tempoEvents;
+    if (events.empty())
+        return seconds * 2.0;
+
+    referenceTimeMapIndex = findTempoSegment (events, seconds, referenceTimeMapIndex,
+        [](const ReferenceTempoEvent& event) { return event.timeSeconds; });
+    const auto& event = events[static_cast<size_t> (referenceTimeMapIndex)];
+    return event.beat + (seconds - event.timeSeconds) * event.bpm / 60.0;
+}
+
+double PluginProcessor::referenceBeatsToSeconds (const ReferenceData& reference, double beat) noexcept
+{
+    const auto& events = reference.tempoEvents;
+    if (events.empty())
+        return beat * 0.5;
+
+    referenceTimeMapIndex = findTempoSegment (events, beat, referenceTimeMapIndex,
+        [](const ReferenceTempoEvent& event) { return event.beat; });
+    const auto& event = events[static_cast<size_t> (referenceTimeMapIndex)];
+    const double bpm = event.bpm > 0.0 ? event.bpm : 120.0;
+    return event.timeSeconds + (beat - event.beat) * 60.0 / bpm;
+}
+
 void PluginProcessor::resetPlaybackState() noexcept
 {
-    queueSize = 0;
+    clearScheduledEvents();
     orderCounter = 0;
     activeNoteCount = 0;
+    untrackedNoteOns.fill (0);
     referenceClusterCursor = 0;
     referenceClusterMatchedCount = 0;
     clusterMissStreak = 0;
+    hmmFollower.reset (0);
+    dtwFollower.reset (0);
     referenceTempoIndex = 0;
+    referenceTimeMapIndex = 0;
+    followingHostTempo = false;
+    tempoTracker.reset();
+    tempoEstimator.reset();
+    tempoEstimateValid.store (false, std::memory_order_relaxed);
     noteOnOrderCounter = 0;
     playbackStartSample = 0;
     userStartSample = 0;
     userStartSampleCaptured = false;
     extraNoteStreak = 0;
+    recentOnsetCount = 0;
+    lastOnsetSample = 0;
+    lostNoteCount = 0;
+    relocaliseCandidateCount = 0;
+    pendingClearFrom = 0;
+    pendingClearTo = -1;
     startOffsetMs.store (0.0f, std::memory_order_relaxed);
     startOffsetBars.store (0.0f, std::memory_order_relaxed);
     startOffsetValid.store (false, std::memory_order_relaxed);
@@ -1634,7 +3694,10 @@ void PluginProcessor::resetPlaybackState() noexcept
     lastNoteOffDeltaMs.store (0.0f, std::memory_order_relaxed);
     lastVelocityDelta.store (0.0f, std::memory_order_relaxed);
     resetVelocityStats();
-    uiNoteFifo.reset();
+    uiBlockNoteCount = 0;
+    std::fill_n (uiHeldNotes.data(), uiHeldNotes.capacity(), UiHeldNote {});
+    uiResyncPending = true;
+    uiChangeSequence.fetch_add (1, std::memory_order_release);
 
     if (auto ref = std::atomic_load (&referenceData))
     {
@@ -1646,6 +3709,37 @@ void PluginProcessor::resetPlaybackState() noexcept
 
 }
 
+void PluginProcessor::resetAutoSlack (uint64_t initialSlackSamples) noexcept
+{
+    requiredDelayCount = 0;
+    requiredDelayWriteIndex = 0;
+    autoSlackTargetSamples = initialSlackSamples;
+    lastNoteInputSample = 0;
+    autoSlackRetargetPending = false;
+}
+
+void PluginProcessor::recordRequiredDelay (uint64_t delaySamples) noexcept
+{
+    requiredDelayHistory[static_cast<size_t> (requiredDelayWriteIndex)] = static_cast<uint32_t> (
+        juce::jmin<uint64_t> (delaySamples, std::numeric_limits<uint32_t>::max()));
+    requiredDelayWriteIndex = (requiredDelayWriteIndex + 1) % kRequiredDelayHistorySize;
+    requiredDelayCount = juce::jmin (requiredDelayCount + 1, kRequiredDelayHistorySize);
+}
+
+uint64_t PluginProcessor::computeRequiredDelayPercentile (float percentile) noexcept
+{
+    if (requiredDelayCount <= 0)
+        return 0;
+
+    std::copy_n (requiredDelayHistory.begin(), requiredDelayCount, requiredDelayScratch.begin());
+    const double fraction = juce::jlimit (0.0, 1.0, static_cast<double> (percentile) / 100.0);
+    const int index = juce::jlimit (0, requiredDelayCount - 1,
+        static_cast<int> (std::ceil (fraction * static_cast<double> (requiredDelayCount))) - 1);
+    auto* begin = requiredDelayScratch.data();
+    std::nth_element (begin, begin + index, begin + requiredDelayCount);
+    return requiredDelayScratch[static_cast<size_t> (index)];
+}
+
 void PluginProcessor::resetVelocityStats() noexcept
 {
     userVelocityEma = 64.0f;
@@ -1711,22 +3805,102 @@ void PluginProcessor::pushUiNoteEvent (uint64_t sample,
                                        int refIndex,
                                        bool isNoteOn) noexcept
 {
+    const int slot = (juce::jlimit (1, 16, channel) - 1) * 128 + (noteNumber & 0x7f);
+    auto& held = uiHeldNotes[static_cast<size_t> (slot)];
+    if (isNoteOn)
+    {
+        if (held.count < std::numeric_limits<uint16_t>::max())
+            ++held.count;
+        held.onSample = sample;
+        held.refIndex = refIndex;
+    }
+    else if (held.count > 0)
+    {
+        --held.count;
+    }
+
+    if (uiBlockNoteCount >= uiBlockNotes.capacity())
+    {
+        droppedUiNoteEvents.fetch_add (1, std::memory_order_relaxed);
+        uiResyncPending = true;
+        return;
+    }
+
+    uiBlockNotes[static_cast<size_t> (uiBlockNoteCount++)] = { sample, noteNumber, channel, refIndex, isNoteOn };
+    uiEventsPushedThisBlock = true;
+}
+
+bool PluginProcessor::writeUiRecord (uint64_t header,
+                                     uint64_t baseSample,
+                                     const UiNoteEvent* notes,
+                                     int count) noexcept
+{
+    const int needed = kUiRecordHeaderWords + count;
+    if (uiEventFifo.getFreeSpace() < needed)
+        return false;
+
     int start1 = 0;
     int size1 = 0;
     int start2 = 0;
     int size2 = 0;
-    uiNoteFifo.prepareToWrite (1, start1, size1, start2, size2);
+    uiEventFifo.prepareToWrite (needed, start1, size1, start2, size2);
+    if (size1 + size2 < needed)
+        return false;
+
+    auto setWord = [&](int index, uint64_t value)
+    {
+        if (index < size1)
+            uiEventWords[static_cast<size_t> (start1 + index)] = value;
+        else
+            uiEventWords[static_cast<size_t> (start2 + index - size1)] = value;
+    };
+
+    setWord (0, header);
+    setWord (1, baseSample);
+    for (int i = 0; i < count; ++i)
+        setWord (kUiRecordHeaderWords + i, packUiNote (notes[i], baseSample));
 
-    if (size1 > 0)
+    uiEventFifo.finishedWrite (needed);
+    return true;
+}
+
+bool PluginProcessor::writeUiHeldNoteSnapshot (uint64_t baseSample) noexcept
+{
+    // Reuses the block staging area, which has one slot per (channel, pitch).
+    int heldCount = 0;
+    for (int slot = 0; slot < kUiHeldNoteSlots; ++slot)
     {
-        uiNoteEvents[static_cast<size_t> (start1)] = { sample, noteNumber, channel, refIndex, isNoteOn };
+        const auto& held = uiHeldNotes[static_cast<size_t> (slot)];
+        if (held.count == 0)
+            continue;
+
+        uiBlockNotes[static_cast<size_t> (heldCount++)] = { held.onSample, slot % 128, slot / 128 + 1, held.refIndex, true };
     }
-    else if (size2 > 0)
+
+    return writeUiRecord (makeUiRecordHeader (kUiRecordSnapshot, heldCount), baseSample, uiBlockNotes.data(), heldCount);
+}
+
+void PluginProcessor::flushUiNoteEvents (uint64_t baseSample) noexcept
+{
+    if (uiBlockNoteCount > 0)
     {
-        uiNoteEvents[static_cast<size_t> (start2)] = { sample, noteNumber, channel, refIndex, isNoteOn };
+        if (! writeUiRecord (makeUiRecordHeader (kUiRecordBlock, uiBlockNoteCount),
+                baseSample,
+                uiBlockNotes.data(),
+                uiBlockNoteCount))
+        {
+            droppedUiNoteEvents.fetch_add (static_cast<uint32_t> (uiBlockNoteCount), std::memory_order_relaxed);
+            uiResyncPending = true;
+        }
+
+        uiBlockNoteCount = 0;
     }
 
-    uiNoteFifo.finishedWrite (size1 + size2);
+    if (uiResyncPending && writeUiHeldNoteSnapshot (baseSample))
+    {
+        uiResyncPending = false;
+        uiEventsPushedThisBlock = true;
+    }
 }
 
 void PluginProcessor::updateUiTimelineState() noexcept
@@ -1734,6 +3908,13 @@ void PluginProcessor::updateUiTimelineState() noexcept
     timelineSampleForUi.store (timelineSample, std::memory_order_relaxed);
     referenceTransportStartSampleForUi.store (referenceTransportStartSample, std::memory_order_relaxed);
     sampleRateForUi.store (sampleRateHz, std::memory_order_relaxed);
+
+    // While playing the piano roll scrolls every block; when stopped only new note events matter.
+    if (uiEventsPushedThisBlock || transportPlaying.load (std::memory_order_relaxed))
+    {
+        uiEventsPushedThisBlock = false;
+        uiChangeSequence.fetch_add (1, std::memory_order_release);
+    }
 }
 
 void PluginProcessor::logMiss (int noteNumber,
@@ -1750,7 +3931,7 @@ void PluginProcessor::logMiss (int noteNumber,
         return;
 
     const uint32_t index = missLogCount.load (std::memory_order_relaxed);
-    if (index >= kMaxMissLogEntries)
+    if (index >= static_cast<uint32_t> (missLog.capacity()))
     {
         missLogOverflow.store (true, std::memory_order_relaxed);
         return;
@@ -1778,27 +3959,46 @@ void PluginProcessor::logMiss (int noteNumber,
     missLogCount.store (index + 1, std::memory_order_release);
 }
 
+PluginProcessor::ScheduledMidiEvent& PluginProcessor::scheduledEventAt (int index) const noexcept
+{
+    return queue[static_cast<size_t> ((queueHead + index) % juce::jmax (1, queue.capacity()))];
+}
+
+// Events arrive nearly in base-sample order, so the insertion point is usually at the tail.
 void PluginProcessor::insertScheduledEvent (const ScheduledMidiEvent& event) noexcept
 {
     int insertIndex = queueSize;
 
     while (insertIndex > 0)
     {
-        const auto& prev = queue[insertIndex - 1];
+        const auto& prev = scheduledEventAt (insertIndex - 1);
 
-        if (prev.dueSample < event.dueSample)
+        if (prev.baseSample < event.baseSample)
             break;
-        if (prev.dueSample == event.dueSample && prev.order <= event.order)
+        if (prev.baseSample == event.baseSample && prev.order <= event.order)
             break;
 
-        queue[insertIndex] = prev;
+        scheduledEventAt (insertIndex) = prev;
         --insertIndex;
     }
 
-    queue[insertIndex] = event;
+    scheduledEventAt (insertIndex) = event;
     ++queueSize;
 }
 
+void PluginProcessor::clearScheduledEvents() noexcept
+{
+    queueHead = 0;
+    queueSize = 0;
+    controlPopCount = controlPushCount;
+    longMessageReadPosition = longMessageWritePosition;
+}
+
+bool PluginProcessor::hasScheduledEvents() const noexcept
+{
+    return queueSize > 0 || controlPushCount > controlPopCount;
+}
+
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
     return new PluginProcessor();
@@ -1,16 +1,27 @@
 #pragma once
 #include <JuceHeader.h>
+#include "DtwFollower.h"
+#include "FollowerLink.h"
+#include "HmmFollower.h"
+#include "PitchNgramIndex.h"
+#include "RealtimeArena.h"
+#include "ReferenceCache.h"
+#include "TempoEstimator.h"
+#include "TempoTracker.h"
 #include <array>
 #include <atomic>
 #include <cstdint>
 #include <memory>
 #include <vector>
 
-class PluginProcessor final : public juce::AudioProcessor
+class PluginProcessor final : public juce::AudioProcessor,
+                              private juce::AudioProcessorValueTreeState::Listener
 {
+    struct ReferenceData;
+
 public:
     PluginProcessor();
-    ~PluginProcessor() override = default;
+    ~PluginProcessor() override;
 
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
@@ -42,7 +53,11 @@ public:
     void getStateInformation (juce::MemoryBlock&) override;
     void setStateInformation (const void*, int) override;
 
+    // False if the file can't be selected at all. Uncached references are built in the background,
+    // and build errors are reported through getReferenceLoadError.
     bool loadReferenceFromFile (const juce::File& file, juce::String& errorMessage);
+    // Builds these references in the background so selecting one later is instant.
+    void preloadReferences (const juce::Array<juce::File>& files);
     juce::String getReferencePath() const;
     uint32_t getInputNoteOnCounter() const noexcept;
     uint32_t getOutputNoteOnCounter() const noexcept;
@@ -61,6 +76,11 @@ public:
     float getStartOffsetMs() const noexcept;
     float getStartOffsetBars() const noexcept;
     bool hasStartOffset() const noexcept;
+    float getCurrentSlackMs() const noexcept;
+    bool hasTempoEstimate() const noexcept;
+    float getTempoEstimateRatio() const noexcept;
+    float getTempoEstimateDriftMs() const noexcept;
+    float getTempoEstimateSpreadMs() const noexcept;
     juce::String createMissLogReport() const;
     bool rebuildReferenceClusters (float clusterWindowMs, juce::String& errorMessage);
     void requestStartOffsetReset() noexcept;
@@ -82,20 +102,49 @@ public:
         uint64_t offSample = 0;
     };
 
-    struct ReferenceDisplayData
+    // Read-only view of the loaded reference for the editor. It shares the engine's immutable note
+    // storage and derives sample positions on demand, so it holds no copy and survives sample
+    // rate changes.
+    class ReferenceDisplayData
     {
-        juce::String sourcePath;
-        std::vector<ReferenceDisplayNote> notes;
-        uint64_t firstNoteSample = 0;
+    public:
+        bool isEmpty() const noexcept;
+        size_t getNumNotes() const noexcept;
+        int getNoteNumber (size_t index) const noexcept;
+        ReferenceDisplayNote getNote (size_t index, double sampleRate) const noexcept;
+        uint64_t getFirstNoteSample (double sampleRate) const noexcept;
+        const juce::String& getSourcePath() const noexcept;
+
+    private:
+        friend class PluginProcessor;
+        std::shared_ptr<const ReferenceData> reference;
     };
 
-    int popUiNoteEvents (std::vector<UiNoteEvent>& dest, int maxEvents);
+    struct UiNoteSnapshot
+    {
+        uint64_t sample = 0;
+        size_t eventIndex = 0;
+        std::vector<UiNoteEvent> heldNotes;
+        bool valid = false;
+    };
+
+    // Drains every complete record. If the audio thread had to drop events it follows up
+    // with a snapshot of the held notes; eventIndex is where it falls within dest.
+    int popUiNoteEvents (std::vector<UiNoteEvent>& dest, UiNoteSnapshot& snapshot);
+    uint32_t getDroppedUiNoteEventCount() const noexcept;
+    uint32_t getDegradedEventCount() const noexcept;
+    uint16_t getBypassChannelMask() const noexcept;
+    void setBypassChannelMask (uint16_t mask);
     uint64_t getTimelineSampleForUi() const noexcept;
     uint64_t getReferenceTransportStartSampleForUi() const noexcept;
     double getSampleRateForUi() const noexcept;
     std::shared_ptr<const ReferenceDisplayData> getReferenceDisplayDataForUi() const noexcept;
     juce::String getReferenceLoadError() const;
-    bool consumePendingReferencePath (juce::String& path);
+
+    // Change sequence numbers let the editor skip ticks where nothing it shows has moved.
+    uint32_t getUiChangeSequence() const noexcept;
+    uint32_t getReferenceChangeSequence() const noexcept;
+    uint32_t getParameterChangeSequence() const noexcept;
 
     // Parameters
     juce::AudioProcessorValueTreeState apvts;
@@ -103,6 +152,8 @@ public:
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
 private:
+    // Sample positions are derived from the times at the instance's rate, so notes never change
+    // once built.
     struct ReferenceNote
     {
         int noteNumber = 0;
@@ -111,14 +162,14 @@ private:
         uint8_t offVelocity = 0;
         double onTimeSeconds = 0.0;
         double offTimeSeconds = 0.0;
-        uint64_t onSample = 0;
-        uint64_t offSample = 0;
     };
 
     struct ReferenceTempoEvent
     {
         double timeSeconds = 0.0;
         double bpm = 120.0;
+        // Quarter notes from the start of the file; the tempo map in beats.
+        double beat = 0.0;
     };
 
     struct ReferenceCluster
@@ -129,14 +180,45 @@ private:
         double endTimeSeconds = 0.0;
     };
 
+    // Read-only array shared by a cached reference and every working copy made from it.
+    template <typename T>
+    class SharedVector
+    {
+    public:
+        SharedVector() = default;
+        explicit SharedVector (std::vector<T>&& source)
+            : items (std::make_shared<const std::vector<T>> (std::move (source))),
+              first (items->data()),
+              count (items->size())
+        {
+        }
+
+        size_t size() const noexcept { return count; }
+        bool empty() const noexcept { return count == 0; }
+        const T* data() const noexcept { return first; }
+        const T* begin() const noexcept { return first; }
+        const T* end() const noexcept { return first + count; }
+        const T& front() const noexcept { return first[0]; }
+        const T& back() const noexcept { return first[count - 1]; }
+        const T& operator[] (size_t index) const noexcept { return first[index]; }
+
+    private:
+        std::shared_ptr<const std::vector<T>> items;
+        const T* first = nullptr;
+        size_t count = 0;
+    };
+
+    // Copying one shares notes, clusters, tempo map and pitch index; only matched and the cluster
+    // counts are per instance.
     struct ReferenceData
     {
         juce::String sourcePath;
-        std::vector<ReferenceNote> notes;
+        SharedVector<ReferenceNote> notes;
         std::vector<uint8_t> matched;
-        std::vector<ReferenceCluster> clusters;
+        SharedVector<ReferenceCluster> clusters;
         std::vector<int> clusterMatchedCounts;
-        std::vector<ReferenceTempoEvent> tempoEvents;
+        SharedVector<ReferenceTempoEvent> tempoEvents;
+        std::shared_ptr<const PitchNgramIndex> pitchIndex;
         int timeSigNumerator = 4;
         int timeSigDenominator = 4;
         double barDurationSeconds = 0.0;
@@ -147,6 +229,8 @@ private:
         bool sampleTimesValid = false;
         uint64_t firstNoteSample = 0;
         double firstNoteTimeSeconds = 0.0;
+        // Tells linked instances' references apart (source, note and cluster counts).
+        uint8_t linkTag = 0;
     };
 
     struct ActiveNote
@@ -155,12 +239,17 @@ private:
         int channel = 1;
         int refIndex = -1;
         uint64_t onOrder = 0;
+        uint64_t onBaseSample = 0;
     };
 
     struct ScheduledMidiEvent
     {
-        uint64_t dueSample = 0;
+        // Output time before slack; the slack in effect at emission is added on top.
+        uint64_t baseSample = 0;
         uint64_t order = 0;
+        // Messages longer than data live in longMessageArena at [arenaStart, arenaStart + arenaSize).
+        uint64_t arenaStart = 0;
+        uint32_t arenaSize = 0;
         uint8_t size = 0;
         uint8_t data[8] = {};
         int refIndex = -1;
@@ -169,6 +258,28 @@ private:
         uint8_t flags = 0;
     };
 
+    struct UiHeldNote
+    {
+        uint64_t onSample = 0;
+        int refIndex = -1;
+        uint16_t count = 0;
+    };
+
+    // Follower state at a host position, restored when Host Lock sees the host loop back.
+    struct FollowerCheckpoint
+    {
+        uint64_t hostSample = 0;
+        int clusterCursor = 0;
+        int clusterMissStreak = 0;
+        int extraNoteStreak = 0;
+        float userVelocityEma = 64.0f;
+        float referenceVelocityEma = 64.0f;
+        bool userVelocityEmaValid = false;
+        bool referenceVelocityEmaValid = false;
+        TempoTracker tempoTracker;
+        TempoEstimator tempoEstimator;
+    };
+
     struct MissLogEntry
     {
         float timeMs = 0.0f;
@@ -184,32 +295,208 @@ private:
         int referenceClusterIndex = 0;
     };
 
-    static constexpr int kMaxQueuedEvents = 4096;
+    // Thinned controller streams: CC (16 x 128), poly aftertouch (16 x 128), channel pressure, pitch bend.
+    static constexpr int kControllerKeyCount = 2 * 16 * 128 + 2 * 16;
     static constexpr int kMaxMidiBytes = 8;
     static constexpr int kMidiEventOverheadBytes = sizeof (std::int32_t) + sizeof (std::uint16_t);
-    static constexpr int kMaxOutputEvents = kMaxQueuedEvents;
-    static constexpr int kMaxActiveNotes = 2048;
+    static constexpr int kMaxActiveNotes = 16 * 128;
     static constexpr uint32_t kMaxMissLogEntries = 4096;
     static constexpr int kMaxClusterMissStreak = 4;
     static constexpr int kMaxClusterLookahead = 24;
-    static constexpr int kMaxUiNoteEvents = 4096;
+    static constexpr int kUiHeldNoteSlots = 16 * 128;
+    static constexpr int kRequiredDelayHistorySize = 512;
+    static constexpr int kMinAutoSlackHistory = 16;
+    static constexpr int kMaxRelocaliseCandidates = 8;
+    // ActiveNote::refIndex of a note-on that skipped matching because the block's work budget ran out.
+    static constexpr int kDegradedRefIndex = -2;
+    // ActiveNote::refIndex of a note held across a reference swap; its note-off passes through.
+    static constexpr int kSwappedRefIndex = -3;
+    // ActiveNote::refIndex of a note-on on a bypassed channel; its note-off passes through unretimed.
+    static constexpr int kBypassedRefIndex = -4;
+    static constexpr int kReferenceCacheEntries = 8;
+    static constexpr int kMaxRelocaliseStep = 2;
+    // Work budget charged for one relocalisation lookup (candidates checked against the last ones).
+    static constexpr int kRelocaliseWork = kMaxRelocaliseCandidates * kMaxRelocaliseCandidates;
+    // How far past the cluster cursor or a follower's position matching reads or marks matches:
+    // the lookahead plus the widest follower window.
+    static constexpr int kMatchReachClusters = kMaxClusterLookahead + 64;
+    // Clusters left over from a relocalisation jump that each block clears beyond that reach.
+    static constexpr int kClearedClustersPerBlock = 256;
+    static constexpr int kMaxCheckpoints = 256;
     static constexpr float kVelocityEmaAlpha = 0.05f;
 
+    enum class FollowerEngine
+    {
+        Cluster = 0,
+        Hmm,
+        Dtw
+    };
+
+    // Per-block settings and state shared by the note loop and the matcher policies.
+    struct BlockContext
+    {
+        ReferenceData* reference = nullptr;
+        uint64_t blockStart = 0;
+        uint64_t referenceStartSample = 0;
+        float slackMs = 0.0f;
+        float missingTimeoutMs = 0.0f;
+        float clusterWindowMs = 0.0f;
+        float correction = 0.0f;
+        float effectiveCorrection = 0.0f;
+        float hostBpm = -1.0f;
+        float referenceBpm = -1.0f;
+        int pitchTolerance = 0;
+        int maxLookaheadClusters = 0;
+        int extraNoteBudget = 0;
+        int outputEventCount = 0;
+        // Matching work left this block, in cluster scans; note-ons beyond it pass through with slack.
+        int workRemaining = 0;
+        // Bit (channel - 1) set: notes on that channel skip matching and pass through with slack.
+        uint16_t bypassChannelMask = 0;
+        // Follower link group this block publishes matches to; 0 when not linked.
+        int linkGroup = 0;
+        bool isPlaying = false;
+        bool isMuted = false;
+        bool isBypassed = false;
+        bool hostLocked = false;
+        bool followHostTempo = false;
+        double hostBeatsPerSample = 0.0;
+        // Tempo estimate: user/reference tempo ratio and the uncertainty of the aligned position.
+        bool useTempoEstimate = false;
+        double tempoRatio = 1.0;
+        uint64_t estimateSpreadSamples = 0;
+        bool predictiveOutput = false;
+        bool velocityCorrection = true;
+    };
+
+    // Matcher policies, combined by Matcher<Strategy, MissPolicy, TimeoutPolicy, PitchPolicy>.
+    // processBlock picks one combination per block, so the note loop is compiled for it and
+    // never branches on these options per event. Defined in PluginProcessor.cpp.
+    struct ClusterCursorMatch;
+    struct HmmMatch;
+    struct DtwMatch;
+    struct ClusterMissStreak;
+    struct FollowerAbsorbsMisses;
+    struct NoMissingTimeout;
+    struct MissingTimeout;
+    struct ExactPitch;
+    struct TolerantPitch;
+    template <typename Strategy, typename MissPolicy, typename TimeoutPolicy, typename PitchPolicy>
+    struct Matcher;
+    // How a reference time lands on the user's timeline this block: the tempo tracker's
+    // prediction, the host tempo, the tempo estimate, or the reference clock as anchored.
+    struct PredictiveAlignment;
+    struct HostTempoAlignment;
+    struct TempoEstimateAlignment;
+    struct ReferenceClockAlignment;
+    // Per-block mode flags the event loop is instantiated for (see processMidiEventsForMode).
+    template <bool HasReference, bool Bypassed, bool Muted, bool VelocityCorrection, typename Alignment>
+    struct EventLoopMode;
+
     void insertScheduledEvent (const ScheduledMidiEvent& event) noexcept;
-    int removeOldestActiveNote (int noteNumber, int channel) noexcept;
+    ScheduledMidiEvent& scheduledEventAt (int index) const noexcept;
+    void allocateRealtimeBuffers (int samplesPerBlock);
+    void releaseRealtimeBuffers() noexcept;
+    void warmUpRealtimeMemory() noexcept;
+    void warmUpReference (ReferenceData& reference) noexcept;
+    void clearScheduledEvents() noexcept;
+    bool hasScheduledEvents() const noexcept;
+    void passBypassedChannelNote (BlockContext& context,
+                                  const uint8_t* data,
+                                  uint64_t userSample,
+                                  int passThroughOffset,
+                                  int channel,
+                                  bool isNoteOn) noexcept;
+    int removeOldestActiveNote (int noteNumber, int channel, uint64_t* onBaseSample = nullptr) noexcept;
+    void countUntrackedNoteOn (int noteNumber, int channel) noexcept;
+    void processMidiEvents (BlockContext& context, juce::MidiBuffer& midi) noexcept;
+    template <typename Strategy, typename MissPolicy>
+    void processMidiEventsWithTimeout (BlockContext& context, juce::MidiBuffer& midi) noexcept;
+    template <typename Strategy, typename MissPolicy, typename TimeoutPolicy>
+    void processMidiEventsWithPitch (BlockContext& context, juce::MidiBuffer& midi) noexcept;
+    template <typename MatcherType, bool HasReference>
+    void processMidiEventsForMode (BlockContext& context, juce::MidiBuffer& midi) noexcept;
+    template <typename MatcherType, bool HasReference, typename Alignment>
+    void processMidiEventsWithAlignment (BlockContext& context, juce::MidiBuffer& midi) noexcept;
+    template <typename MatcherType, typename Mode>
+    void processMidiEventsWith (BlockContext& context, juce::MidiBuffer& midi) noexcept;
+    template <typename PitchPolicy>
     int matchReferenceNoteInCluster (int noteNumber,
                                      int channel,
                                      int pitchTolerance,
                                      ReferenceData& reference,
                                      int maxLookaheadClusters) noexcept;
+    template <typename Follower>
+    int matchReferenceNoteWithFollower (Follower& follower,
+                                        int noteNumber,
+                                        int channel,
+                                        int pitchTolerance,
+                                        ReferenceData& reference) noexcept;
     void handleClusterMiss (ReferenceData& reference) noexcept;
+    bool markCurrentClusterMissing (ReferenceData& reference) noexcept;
+    void pushRecentOnset (const BlockContext& context, int noteNumber, uint64_t userSample) noexcept;
+    bool relocaliseIfLost (BlockContext& context, ReferenceData& reference, uint64_t userSample, bool spendsWork) noexcept;
+    void jumpToCluster (ReferenceData& reference, int clusterIndex) noexcept;
+    void clearPendingMatches (ReferenceData& reference, int throughCluster) noexcept;
+    int getMatchReach() const noexcept;
+    void followLinkedPosition (ReferenceData& reference, int linkGroup, uint64_t nowSample) noexcept;
+    void publishLinkedPosition (const BlockContext& context, const ReferenceData& reference, int refIndex, uint64_t userSample) noexcept;
+    int countLinkedChannelNotes (const ReferenceData& reference, int clusterIndex) const noexcept;
+    void recordCheckpoint (uint64_t hostSamplePosition) noexcept;
+    void seekToHostSample (ReferenceData* reference, uint64_t hostSamplePosition, double referenceSeconds) noexcept;
+    void anchorReferenceAt (const ReferenceData* reference, uint64_t userSample, double referenceSeconds) noexcept;
+    double referenceSecondsToBeats (const ReferenceData& reference, double seconds) noexcept;
+    double referenceBeatsToSeconds (const ReferenceData& reference, double beat) noexcept;
+    void captureStartOffsetIfNeeded (const BlockContext& context, uint64_t userSample) noexcept;
+    uint64_t alignReferenceSample (const BlockContext& context, uint64_t refSample, uint64_t fallbackSample) noexcept;
+    template <typename Alignment>
+    uint64_t alignReferenceSampleWith (const BlockContext& context, uint64_t refSample, uint64_t fallbackSample) noexcept;
+    uint64_t alignUnpredictedReferenceSample (const BlockContext& context, uint64_t referenceOffset, uint64_t refSample) noexcept;
+    void observeTempo (const BlockContext& context, const ReferenceNote& refNote, uint64_t userSample) noexcept;
+    void countOutputNoteOn (const uint8_t* data, uint8_t size) noexcept;
+    void passDegradedNoteOn (BlockContext& context,
+                             const uint8_t* data,
+                             uint64_t userSample,
+                             int passThroughOffset,
+                             int channel) noexcept;
+    void enqueueEvent (BlockContext& context,
+                       const uint8_t* data,
+                       int size,
+                       uint64_t baseSample,
+                       int passThroughOffset) noexcept;
+    void enqueueNoteEvent (BlockContext& context,
+                           const uint8_t* data,
+                           uint8_t size,
+                           uint64_t baseSample,
+                           int passThroughOffset,
+                           int refIndex,
+                           bool isNoteOn,
+                           int channel) noexcept;
+    bool reserveLongMessage (int size, uint64_t& arenaStart) noexcept;
     void advanceClusterCursor (ReferenceData& reference) noexcept;
     void resetPlaybackState() noexcept;
-    void updateReferenceSampleTimes (ReferenceData& data, double sampleRate);
-    std::shared_ptr<ReferenceData> buildReferenceFromFile (const juce::File& file,
-                                                           double clusterWindowSeconds,
-                                                           juce::String& errorMessage);
+    static void updateReferenceSampleTimes (ReferenceData& data, double sampleRate);
+    static std::shared_ptr<ReferenceData> buildReferenceFromFile (const juce::File& file,
+                                                                  double clusterWindowSeconds,
+                                                                  juce::String& errorMessage);
+    static void compileReference (ReferenceData& reference, double clusterWindowSeconds);
+    static void writeReferenceBlob (const ReferenceData& reference, juce::MemoryBlock& blob);
+    static std::shared_ptr<ReferenceData> readReferenceBlob (const juce::MemoryBlock& blob,
+                                                             double clusterWindowSeconds,
+                                                             juce::String& errorMessage);
+    juce::String getEmbeddedReferenceText (const std::shared_ptr<ReferenceData>& reference);
+    std::shared_ptr<ReferenceData> instantiateReference (const ReferenceData& base);
+    void requestReference (const juce::File& file, double clusterWindowSeconds);
+    void selectCachedReference (uint32_t request, std::shared_ptr<const ReferenceData> cached,
+                                const juce::String& errorMessage);
+    void prepareReference (ReferenceData& reference);
+    void queueReferenceSwap (std::shared_ptr<ReferenceData> reference);
+    void adoptPendingReference (std::shared_ptr<ReferenceData>& reference) noexcept;
+    double getClusterWindowSeconds() const noexcept;
     void resetVelocityStats() noexcept;
+    void resetAutoSlack (uint64_t initialSlackSamples) noexcept;
+    void recordRequiredDelay (uint64_t delaySamples) noexcept;
+    uint64_t computeRequiredDelayPercentile (float percentile) noexcept;
     void updateVelocityStats (uint8_t userVelocity, int referenceVelocity) noexcept;
     float getVelocityScale() const noexcept;
     uint8_t scaleReferenceVelocity (uint8_t referenceVelocity) const noexcept;
@@ -219,8 +506,13 @@ private:
                           int channel,
                           int refIndex,
                           bool isNoteOn) noexcept;
-    std::shared_ptr<ReferenceDisplayData> buildReferenceDisplayData (const ReferenceData& reference) const;
+    void flushUiNoteEvents (uint64_t baseSample) noexcept;
+    bool writeUiRecord (uint64_t header, uint64_t baseSample, const UiNoteEvent* notes, int count) noexcept;
+    bool writeUiHeldNoteSnapshot (uint64_t baseSample) noexcept;
+    std::shared_ptr<ReferenceDisplayData> buildReferenceDisplayData (std::shared_ptr<const ReferenceData> reference) const;
+    void publishReferenceDisplayData (std::shared_ptr<ReferenceDisplayData> display);
     void updateUiTimelineState() noexcept;
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
     void logMiss (int noteNumber,
                   int velocity,
                   int channel,
@@ -231,15 +523,70 @@ private:
                   float hostBpmValue,
                   float referenceBpmValue) noexcept;
 
-    std::array<ScheduledMidiEvent, kMaxQueuedEvents> queue {};
+    // Every buffer the audio thread fills lives in realtimeArena, sized in prepareToPlay from the
+    // sample rate, block size and maximum slack.
+    RealtimeArena realtimeArena;
+    // Held by message-thread readers of arena buffers (UI ring, miss log) and while the arena is
+    // reallocated or released; never taken on the audio thread.
+    juce::CriticalSection realtimeBufferLock;
+    int maxOutputEvents = 0;
+    // Cost of the last prefault pass over the realtime buffers and over a freshly built reference.
+    std::atomic<float> warmUpMs { 0.0f };
+    std::atomic<uint32_t> warmUpKiloBytes { 0 };
+    std::atomic<bool> realtimeMemoryLocked { false };
+    std::atomic<float> referenceWarmUpMs { 0.0f };
+    std::atomic<uint32_t> referenceWarmUpKiloBytes { 0 };
+    // Notes are scheduled in queue (sorted by base sample); every other message goes through
+    // controlQueue, a FIFO in arrival order where continuous controllers keep one slot per key
+    // and output window.
+    ArenaArray<ScheduledMidiEvent> queue;
+    // queue is a ring: entry i (in base-sample order) is at (queueHead + i) % capacity.
+    int queueHead = 0;
     int queueSize = 0;
+    ArenaArray<ScheduledMidiEvent> controlQueue;
+    uint64_t controlPushCount = 0;
+    uint64_t controlPopCount = 0;
+    ArenaArray<uint64_t> controllerSlots;
+    ArenaArray<uint64_t> controllerSlotWindows;
+    uint64_t controllerWindowSamples = 1;
+    std::atomic<uint16_t> bypassChannelMask { 0 };
+    std::atomic<uint32_t> thinnedControllerCounter { 0 };
+    // Ring of long-message (SysEx) bytes for controlQueue entries. Each message is stored
+    // contiguously; bytes are released as their event is emitted.
+    ArenaArray<uint8_t> longMessageArena;
+    uint64_t longMessageWritePosition = 0;
+    uint64_t longMessageReadPosition = 0;
+    std::atomic<uint32_t> droppedLongMessageCounter { 0 };
     uint64_t timelineSample = 0;
     uint64_t orderCounter = 0;
-    uint64_t latchedSlackSamples = 0;
+    uint64_t currentSlackSamples = 0;
+    std::array<uint32_t, kRequiredDelayHistorySize> requiredDelayHistory {};
+    std::array<uint32_t, kRequiredDelayHistorySize> requiredDelayScratch {};
+    int requiredDelayCount = 0;
+    int requiredDelayWriteIndex = 0;
+    uint64_t autoSlackTargetSamples = 0;
+    uint64_t lastNoteInputSample = 0;
+    bool autoSlackRetargetPending = false;
+    std::atomic<float> currentSlackMs { 0.0f };
+    std::atomic<bool> tempoEstimateValid { false };
+    std::atomic<float> tempoEstimateRatio { 1.0f };
+    std::atomic<float> tempoEstimateDriftMs { 0.0f };
+    std::atomic<float> tempoEstimateSpreadMs { 0.0f };
     uint64_t referenceTransportStartSample = 0;
-    std::array<UiNoteEvent, kMaxUiNoteEvents> uiNoteEvents {};
-    juce::AbstractFifo uiNoteFifo { kMaxUiNoteEvents };
+    // Sized in prepareToPlay; the editor drains it under realtimeBufferLock.
+    ArenaArray<uint64_t> uiEventWords;
+    juce::AbstractFifo uiEventFifo { 1 };
+    ArenaArray<UiNoteEvent> uiBlockNotes;
+    int uiBlockNoteCount = 0;
+    ArenaArray<UiHeldNote> uiHeldNotes;
+    bool uiResyncPending = false;
+    std::atomic<uint32_t> droppedUiNoteEvents { 0 };
+    std::atomic<uint32_t> degradedEventCounter { 0 };
     std::atomic<uint64_t> timelineSampleForUi { 0 };
+    std::atomic<uint32_t> uiChangeSequence { 0 };
+    std::atomic<uint32_t> referenceChangeSequence { 0 };
+    std::atomic<uint32_t> parameterChangeSequence { 0 };
+    bool uiEventsPushedThisBlock = false;
     std::atomic<uint64_t> referenceTransportStartSampleForUi { 0 };
     std::atomic<double> sampleRateForUi { 44100.0 };
     double sampleRateHz = 44100.0;
@@ -248,10 +595,19 @@ private:
     std::atomic<float>* correctionParam = nullptr;
     std::atomic<float>* missingTimeoutMsParam = nullptr;
     std::atomic<float>* extraNoteBudgetParam = nullptr;
+    std::atomic<float>* workBudgetParam = nullptr;
+    std::atomic<float>* embedReferenceParam = nullptr;
     std::atomic<float>* pitchToleranceParam = nullptr;
     std::atomic<float>* muteParam = nullptr;
     std::atomic<float>* bypassParam = nullptr;
     std::atomic<float>* velocityCorrectionParam = nullptr;
+    std::atomic<float>* predictiveOutputParam = nullptr;
+    std::atomic<float>* autoSlackParam = nullptr;
+    std::atomic<float>* autoSlackPercentileParam = nullptr;
+    std::atomic<float>* followerEngineParam = nullptr;
+    std::atomic<float>* hostLockParam = nullptr;
+    std::atomic<float>* followHostTempoParam = nullptr;
+    std::atomic<float>* linkGroupParam = nullptr;
     std::atomic<uint32_t> inputNoteOnCounter { 0 };
     std::atomic<uint32_t> outputNoteOnCounter { 0 };
     std::atomic<float> lastTimingDeltaMs { 0.0f };
@@ -263,14 +619,64 @@ private:
     std::atomic<float> hostBpm { -1.0f };
     std::atomic<float> referenceBpm { -1.0f };
     std::shared_ptr<ReferenceData> referenceData;
+    // Only processBlock (or prepareToPlay, while stopped) replaces referenceData: the message
+    // thread leaves the latest reference in pendingReference and bumps referenceSwapSequence. The
+    // reference a swap replaces is parked in retiredReference, flagged by retiredReferencePending,
+    // so it is never freed on the audio thread.
+    std::shared_ptr<ReferenceData> pendingReference;
+    std::shared_ptr<ReferenceData> retiredReference;
+    std::atomic<uint32_t> referenceSwapSequence { 0 };
+    uint32_t adoptedSwapSequence = 0;
+    std::atomic<bool> retiredReferencePending { false };
+    // Bumped by each reference request (loads, cluster-window rebuilds, setStateInformation) so an
+    // older build or embedded-reference decode still in flight is discarded.
+    std::atomic<uint32_t> referenceRequestSequence { 0 };
+    // Base64 reference blob for the state, kept for the reference it was written from.
+    juce::CriticalSection embeddedReferenceLock;
+    std::weak_ptr<ReferenceData> embeddedReferenceSource;
+    juce::String embeddedReferenceText;
+    ReferenceCache<ReferenceData> referenceCache { kReferenceCacheEntries, &PluginProcessor::buildReferenceFromFile };
     std::shared_ptr<ReferenceDisplayData> referenceDisplayData;
-    std::array<ActiveNote, kMaxActiveNotes> activeNotes {};
+    ArenaArray<ActiveNote> activeNotes;
     int activeNoteCount = 0;
+    // Note-ons sent while activeNotes was full, per (channel - 1) * 128 + note; their note-offs pass through.
+    std::array<uint8_t, 16 * 128> untrackedNoteOns {};
     int referenceClusterCursor = 0;
     int referenceClusterMatchedCount = 0;
     int clusterMissStreak = 0;
+    FollowerEngine activeFollowerEngine = FollowerEngine::Cluster;
+    HmmFollower<ReferenceData> hmmFollower;
+    DtwFollower<ReferenceData> dtwFollower;
     int extraNoteStreak = 0;
+    std::array<int, PitchNgramIndex::kLength> recentOnsetPitches {};
+    int recentOnsetCount = 0;
+    uint64_t lastOnsetSample = 0;
+    int lostNoteCount = 0;
+    std::array<int, kMaxRelocaliseCandidates> relocaliseCandidates {};
+    int relocaliseCandidateCount = 0;
+    // Clusters [pendingClearFrom, pendingClearTo] still hold matches from before a relocalisation
+    // jump; clearPendingMatches clears them before matching can reach them.
+    int pendingClearFrom = 0;
+    int pendingClearTo = -1;
+    // Link group of the last block (0 = not linked), the channels this instance has matched on
+    // while linked, and the earliest host sample a group position may come from to be followed.
+    juce::SharedResourcePointer<FollowerLink> followerLink;
+    int activeLinkGroup = 0;
+    uint16_t linkedChannelMask = 0;
+    uint64_t linkFollowAfterSample = 0;
+    ArenaArray<FollowerCheckpoint> checkpoints;
+    int checkpointCount = 0;
+    uint64_t checkpointIntervalSamples = 1;
+    uint32_t checkpointReferenceSequence = 0;
     int referenceTempoIndex = 0;
+    int referenceTimeMapIndex = 0;
+    // Follow Host Tempo: the reference beat at tempoAnchorSample, advancing at the host tempo.
+    uint64_t tempoAnchorSample = 0;
+    double tempoAnchorBeat = 0.0;
+    double tempoAnchorBeatsPerSample = 0.0;
+    bool followingHostTempo = false;
+    TempoTracker tempoTracker;
+    TempoEstimator tempoEstimator;
     uint64_t noteOnOrderCounter = 0;
     float userVelocityEma = 64.0f;
     float referenceVelocityEma = 64.0f;
@@ -286,13 +692,13 @@ private:
     bool transportWasPlaying = false;
     std::atomic<bool> transportPlaying { false };
     juce::String referencePath;
-    juce::String pendingReferencePath;
     juce::String lastReferenceLoadError;
     juce::MidiBuffer outputBuffer;
-    std::array<MissLogEntry, kMaxMissLogEntries> missLog {};
+    ArenaArray<MissLogEntry> missLog;
     std::atomic<uint32_t> missLogCount { 0 };
     std::atomic<bool> missLogOverflow { false };
     std::atomic<bool> startOffsetResetRequested { false };
 
+    JUCE_DECLARE_WEAK_REFERENCEABLE (PluginProcessor)
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginProcessor)
 };
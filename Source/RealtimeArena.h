@@ -0,0 +1,160 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#if defined (__unix__) || defined (__APPLE__)
+ #include <sys/mman.h>
+#endif
+
+// Fixed-capacity view of one buffer inside a RealtimeArena. Copying the view does not copy
+// the elements; indexing never allocates or checks bounds.
+template <typename T>
+class ArenaArray
+{
+public:
+    T* data() const noexcept
+    {
+        return items;
+    }
+
+    int capacity() const noexcept
+    {
+        return count;
+    }
+
+    bool isEmpty() const noexcept
+    {
+        return count == 0;
+    }
+
+    T& operator[] (size_t index) const noexcept
+    {
+        return items[index];
+    }
+
+private:
+    friend class RealtimeArena;
+
+    T* items = nullptr;
+    int count = 0;
+};
+
+// One contiguous allocation holding every buffer the audio thread writes to. Buffers are laid
+// out with add(), the block is allocated by allocate() off the audio thread (and only when its
+// size changes), then each buffer is bound to an ArenaArray. Elements must be trivially
+// destructible since the arena never runs destructors.
+class RealtimeArena
+{
+public:
+    static constexpr size_t kPageBytes = 4096;
+
+    ~RealtimeArena()
+    {
+        unlock();
+    }
+
+    template <typename T>
+    struct Slot
+    {
+        size_t offset = 0;
+        int count = 0;
+    };
+
+    void beginLayout() noexcept
+    {
+        layoutBytes = 0;
+    }
+
+    template <typename T>
+    Slot<T> add (int count) noexcept
+    {
+        static_assert (std::is_trivially_destructible<T>::value, "Arena elements are never destroyed");
+        static_assert (alignof (T) <= alignof (std::max_align_t), "Arena storage is max_align_t aligned");
+
+        Slot<T> slot;
+        slot.offset = (layoutBytes + alignof (T) - 1) / alignof (T) * alignof (T);
+        slot.count = count > 0 ? count : 0;
+        layoutBytes = slot.offset + sizeof (T) * static_cast<size_t> (slot.count);
+        return slot;
+    }
+
+    void allocate()
+    {
+        if (layoutBytes == allocatedBytes && storage != nullptr)
+            return;
+
+        unlock();
+        storage.reset (layoutBytes > 0 ? new std::max_align_t[(layoutBytes + sizeof (std::max_align_t) - 1)
+                                                              / sizeof (std::max_align_t)]
+                                        : nullptr);
+        allocatedBytes = layoutBytes;
+    }
+
+    void release() noexcept
+    {
+        unlock();
+        storage.reset();
+        allocatedBytes = 0;
+        layoutBytes = 0;
+    }
+
+    // Value-initialises the slot's elements and returns a view of them.
+    template <typename T>
+    ArenaArray<T> bind (const Slot<T>& slot) noexcept
+    {
+        ArenaArray<T> view;
+        if (storage == nullptr || slot.count == 0)
+            return view;
+
+        auto* bytes = reinterpret_cast<uint8_t*> (storage.get()) + slot.offset;
+        for (int i = 0; i < slot.count; ++i)
+            new (bytes + sizeof (T) * static_cast<size_t> (i)) T {};
+        view.items = std::launder (reinterpret_cast<T*> (bytes));
+        view.count = slot.count;
+        return view;
+    }
+
+    size_t getAllocatedBytes() const noexcept
+    {
+        return allocatedBytes;
+    }
+
+    // Writes one byte per page so no part of the storage faults on first use, and optionally
+    // locks it in RAM (POSIX only). Returns whether the storage is locked.
+    bool prefault (bool lockPages) noexcept
+    {
+        if (storage == nullptr || allocatedBytes == 0)
+            return false;
+
+        auto* bytes = reinterpret_cast<volatile uint8_t*> (storage.get());
+        for (size_t i = 0; i < allocatedBytes; i += kPageBytes)
+            bytes[i] = bytes[i];
+        bytes[allocatedBytes - 1] = bytes[allocatedBytes - 1];
+
+       #if defined (__unix__) || defined (__APPLE__)
+        if (lockPages && ! locked)
+            locked = mlock (storage.get(), allocatedBytes) == 0;
+       #else
+        (void) lockPages;
+       #endif
+        return locked;
+    }
+
+private:
+    void unlock() noexcept
+    {
+       #if defined (__unix__) || defined (__APPLE__)
+        if (locked && storage != nullptr)
+            munlock (storage.get(), allocatedBytes);
+       #endif
+        locked = false;
+    }
+
+    std::unique_ptr<std::max_align_t[]> storage;
+    size_t layoutBytes = 0;
+    size_t allocatedBytes = 0;
+    bool locked = false;
+};
@@ -0,0 +1,298 @@
+#pragma once
+#include <JuceHeader.h>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+// Bounded LRU cache of fully built references, keyed by file, modification time and cluster
+// window. Cached references are never modified; callers copy one before handing it to the
+// audio thread. Every build runs on the cache's background thread: get() requests come first,
+// then post()ed reference work (e.g. decoding saved state), then preload() files. Entries that
+// were only preloaded are evicted before ones that were actually selected.
+template <typename Reference>
+class ReferenceCache final : private juce::Thread
+{
+public:
+    using Builder = std::function<std::shared_ptr<const Reference> (const juce::File&, double, juce::String&)>;
+    // Called on the cache thread with the built reference, or nullptr and the build error.
+    using Callback = std::function<void (std::shared_ptr<const Reference>, const juce::String&)>;
+
+    ReferenceCache (int maxEntriesToUse, Builder builderToUse)
+        : juce::Thread ("Personalities Reference Preload"),
+          maxEntries (juce::jmax (1, maxEntriesToUse)),
+          builder (std::move (builderToUse))
+    {
+        startThread (juce::Thread::Priority::background);
+    }
+
+    ~ReferenceCache() override
+    {
+        stop();
+    }
+
+    // Waits for the task or build in progress; anything still queued is dropped, and queued
+    // get() callbacks are never called.
+    void stop()
+    {
+        stopThread (4000);
+        const juce::ScopedLock scopedLock (lock);
+        tasks.clear();
+        requests.clear();
+        pendingFiles.clear();
+    }
+
+    // A cached reference is returned at once and becomes the most recently used entry. Otherwise
+    // this returns nullptr and the reference is built on the cache thread, which then calls
+    // onBuilt; a request for a build already queued or in progress just waits for that one.
+    std::shared_ptr<const Reference> get (const juce::File& file, double clusterWindowSeconds, Callback onBuilt)
+    {
+        const auto modificationTime = file.getLastModificationTime().toMilliseconds();
+        {
+            const juce::ScopedLock scopedLock (lock);
+            const int index = findEntry (file, clusterWindowSeconds, modificationTime);
+            if (index >= 0)
+            {
+                auto entry = entries[static_cast<size_t> (index)];
+                entry.selected = true;
+                entries.erase (entries.begin() + index);
+                entries.insert (entries.begin(), entry);
+                return entry.reference;
+            }
+
+            if (building.matches (file, clusterWindowSeconds, modificationTime))
+            {
+                building.selected = true;
+                building.callbacks.push_back (std::move (onBuilt));
+                return nullptr;
+            }
+
+            for (auto& request : requests)
+            {
+                if (request.matches (file, clusterWindowSeconds, modificationTime))
+                {
+                    request.callbacks.push_back (std::move (onBuilt));
+                    return nullptr;
+                }
+            }
+
+            Build request { file, clusterWindowSeconds, modificationTime, true, {} };
+            request.callbacks.push_back (std::move (onBuilt));
+            requests.push_back (std::move (request));
+        }
+        notify();
+        return nullptr;
+    }
+
+    // Replaces the preload queue. Files already cached are skipped when their turn comes.
+    void preload (const juce::Array<juce::File>& files, double clusterWindowSeconds)
+    {
+        {
+            const juce::ScopedLock scopedLock (lock);
+            pendingFiles = files;
+            pendingClusterWindowSeconds = clusterWindowSeconds;
+        }
+        notify();
+    }
+
+    void post (std::function<void()> task)
+    {
+        {
+            const juce::ScopedLock scopedLock (lock);
+            tasks.push_back (std::move (task));
+        }
+        notify();
+    }
+
+    void clear()
+    {
+        const juce::ScopedLock scopedLock (lock);
+        entries.clear();
+        pendingFiles.clear();
+    }
+
+    int getNumEntries() const
+    {
+        const juce::ScopedLock scopedLock (lock);
+        return static_cast<int> (entries.size());
+    }
+
+private:
+    struct Entry
+    {
+        juce::File file;
+        double clusterWindowSeconds = 0.0;
+        juce::int64 modificationTime = 0;
+        bool selected = false;
+        std::shared_ptr<const Reference> reference;
+    };
+
+    // A queued or running build and the get() callbacks waiting for it.
+    struct Build
+    {
+        juce::File file;
+        double clusterWindowSeconds = 0.0;
+        juce::int64 modificationTime = 0;
+        bool selected = false;
+        std::vector<Callback> callbacks;
+
+        bool matches (const juce::File& otherFile, double otherClusterWindowSeconds, juce::int64 otherModificationTime) const
+        {
+            return file == otherFile
+                && clusterWindowSeconds == otherClusterWindowSeconds
+                && modificationTime == otherModificationTime;
+        }
+    };
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            std::function<void()> task;
+            bool hasBuild = false;
+            bool idle = false;
+            {
+                const juce::ScopedLock scopedLock (lock);
+                if (! requests.empty())
+                {
+                    building = std::move (requests.front());
+                    requests.erase (requests.begin());
+                    hasBuild = true;
+                }
+                else if (! tasks.empty())
+                {
+                    task = std::move (tasks.front());
+                    tasks.erase (tasks.begin());
+                }
+                else if (! pendingFiles.isEmpty())
+                {
+                    const auto file = pendingFiles.getFirst();
+                    pendingFiles.remove (0);
+                    const auto modificationTime = file.getLastModificationTime().toMilliseconds();
+                    if (findEntry (file, pendingClusterWindowSeconds, modificationTime) < 0)
+                    {
+                        building = { file, pendingClusterWindowSeconds, modificationTime, false, {} };
+                        hasBuild = true;
+                    }
+                }
+                else
+                {
+                    idle = true;
+                }
+            }
+
+            if (task != nullptr)
+            {
+                task();
+                continue;
+            }
+
+            if (hasBuild)
+            {
+                runBuild();
+                continue;
+            }
+
+            if (idle)
+                wait (-1);
+        }
+    }
+
+    void runBuild()
+    {
+        // Only this thread changes which build is in progress; get() just adds callbacks to it.
+        const auto file = building.file;
+        const auto clusterWindowSeconds = building.clusterWindowSeconds;
+        const auto modificationTime = building.modificationTime;
+
+        // A preload may have built this request's reference since it was queued.
+        std::shared_ptr<const Reference> reference;
+        {
+            const juce::ScopedLock scopedLock (lock);
+            const int index = findEntry (file, clusterWindowSeconds, modificationTime);
+            if (index >= 0)
+                reference = entries[static_cast<size_t> (index)].reference;
+        }
+
+        juce::String errorMessage;
+        if (reference == nullptr)
+            reference = builder (file, clusterWindowSeconds, errorMessage);
+
+        // Declared before the lock so evicted references are freed after it is released.
+        std::vector<std::shared_ptr<const Reference>> evicted;
+        std::vector<Callback> callbacks;
+        {
+            const juce::ScopedLock scopedLock (lock);
+            callbacks = std::move (building.callbacks);
+            if (reference != nullptr)
+                evicted = insertLocked ({ file, clusterWindowSeconds, modificationTime, building.selected, reference });
+            building = {};
+        }
+
+        for (auto& callback : callbacks)
+            callback (reference, errorMessage);
+    }
+
+    int findEntry (const juce::File& file, double clusterWindowSeconds, juce::int64 modificationTime) const
+    {
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            const auto& entry = entries[i];
+            if (entry.file == file
+                && entry.clusterWindowSeconds == clusterWindowSeconds
+                && entry.modificationTime == modificationTime)
+                return static_cast<int> (i);
+        }
+        return -1;
+    }
+
+    // Evicted references are handed back so they can be freed after the lock is released.
+    std::vector<std::shared_ptr<const Reference>> insertLocked (Entry entry)
+    {
+        std::vector<std::shared_ptr<const Reference>> evicted;
+
+        // Replace earlier builds of the same file: an older modification time, or a duplicate with
+        // the same cluster window. Builds with other cluster windows stay cached.
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            if (it->file == entry.file
+                && (it->modificationTime != entry.modificationTime || it->clusterWindowSeconds == entry.clusterWindowSeconds))
+            {
+                entry.selected = entry.selected || it->selected;
+                evicted.push_back (std::move (it->reference));
+                it = entries.erase (it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        entries.insert (entries.begin(), std::move (entry));
+        while (static_cast<int> (entries.size()) > maxEntries)
+        {
+            auto victim = std::find_if (entries.rbegin(), entries.rend(), [] (const Entry& e) { return ! e.selected; });
+            const auto index = victim != entries.rend()
+                ? static_cast<size_t> (std::distance (victim, entries.rend()) - 1)
+                : entries.size() - 1;
+            evicted.push_back (std::move (entries[index].reference));
+            entries.erase (entries.begin() + static_cast<std::ptrdiff_t> (index));
+        }
+        return evicted;
+    }
+
+    const int maxEntries;
+    const Builder builder;
+    juce::CriticalSection lock;
+    // Most recently used first.
+    std::vector<Entry> entries;
+    std::vector<std::function<void()>> tasks;
+    std::vector<Build> requests;
+    // Build in progress on the cache thread; file is empty when there is none.
+    Build building;
+    juce::Array<juce::File> pendingFiles;
+    double pendingClusterWindowSeconds = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReferenceCache)
+};
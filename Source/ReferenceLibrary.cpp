@@ -0,0 +1,374 @@
+#include "ReferenceLibrary.h"
+#include "SmfReader.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+
+namespace
+{
+    constexpr int kIndexVersion = 1;
+    constexpr int kRescanIntervalMs = 5000;
+    constexpr int kPublishIntervalMs = 1000;
+    constexpr const char* kIndexType = "ReferenceIndex";
+    constexpr const char* kEntryType = "Entry";
+
+    // FNV-1a; enough to tell edited files apart, no crypto module needed.
+    uint64_t hashBytes (const uint8_t* data, size_t size) noexcept
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= data[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    juce::String formatDuration (double seconds)
+    {
+        const int total = juce::roundToInt (seconds);
+        return juce::String (total / 60) + ":" + juce::String (total % 60).paddedLeft ('0', 2);
+    }
+}
+
+ReferenceLibrary::ReferenceLibrary()
+    : juce::Thread ("Personalities Reference Library")
+{
+    startThread (juce::Thread::Priority::background);
+}
+
+ReferenceLibrary::~ReferenceLibrary()
+{
+    stopThread (4000);
+}
+
+juce::File ReferenceLibrary::getLibraryDirectory()
+{
+    return juce::File::getSpecialLocation (juce::File::userHomeDirectory)
+        .getChildFile ("Downloads")
+        .getChildFile ("PRISM");
+}
+
+juce::File ReferenceLibrary::getIndexFile()
+{
+    return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+        .getChildFile ("Personalities")
+        .getChildFile ("ReferenceIndex.xml");
+}
+
+std::shared_ptr<const ReferenceLibrary::Snapshot> ReferenceLibrary::getSnapshot() const
+{
+    return std::atomic_load (&snapshot);
+}
+
+bool ReferenceLibrary::hasLoaded() const noexcept
+{
+    return loaded.load (std::memory_order_acquire);
+}
+
+uint32_t ReferenceLibrary::getChangeSequence() const noexcept
+{
+    return changeSequence.load (std::memory_order_acquire);
+}
+
+void ReferenceLibrary::requestRescan()
+{
+    notify();
+}
+
+std::vector<int> ReferenceLibrary::search (const Snapshot& entries, const juce::String& query)
+{
+    juce::StringArray words;
+    words.addTokens (query, " ", "");
+    words.removeEmptyStrings();
+
+    std::vector<int> matches;
+    matches.reserve (entries.size());
+    for (int i = 0; i < static_cast<int> (entries.size()); ++i)
+    {
+        const auto& entry = entries[static_cast<size_t> (i)];
+        const auto haystack = entry.name + " " + entry.trackNames.joinIntoString (" ");
+        bool matchesAll = true;
+        for (const auto& word : words)
+        {
+            if (! haystack.containsIgnoreCase (word))
+            {
+                matchesAll = false;
+                break;
+            }
+        }
+
+        if (matchesAll)
+            matches.push_back (i);
+    }
+
+    return matches;
+}
+
+juce::String ReferenceLibrary::describe (const Entry& entry)
+{
+    if (! entry.analysed)
+        return entry.name + ": indexing" + juce::String::fromUTF8 ("\xe2\x80\xa6");
+    if (! entry.valid)
+        return entry.name + ": unreadable MIDI file";
+
+    juce::String text;
+    text << entry.name << ": " << entry.noteCount << " notes, " << formatDuration (entry.durationSeconds);
+    if (std::abs (entry.maxBpm - entry.minBpm) < 0.05)
+        text << ", " << juce::String (entry.minBpm, 1) << " bpm";
+    else
+        text << ", " << juce::String (entry.minBpm, 1) << "-" << juce::String (entry.maxBpm, 1) << " bpm";
+    if (entry.medianIoiMs > 0.0)
+        text << ", IOI " << juce::String (entry.minIoiMs, 1) << "/" << juce::String (entry.medianIoiMs, 1) << " ms";
+    if (! entry.trackNames.isEmpty())
+        text << "\n" << entry.trackNames.joinIntoString (", ");
+    return text;
+}
+
+void ReferenceLibrary::run()
+{
+    loadIndex();
+
+    while (! threadShouldExit())
+    {
+        scan();
+        wait (kRescanIntervalMs);
+    }
+}
+
+void ReferenceLibrary::publish (std::shared_ptr<const Snapshot> newSnapshot)
+{
+    std::atomic_store (&snapshot, std::move (newSnapshot));
+    changeSequence.fetch_add (1, std::memory_order_release);
+}
+
+void ReferenceLibrary::loadIndex()
+{
+    auto entries = std::make_shared<Snapshot>();
+    const auto directory = getLibraryDirectory();
+
+    if (auto xml = juce::parseXML (getIndexFile()))
+    {
+        const auto index = juce::ValueTree::fromXml (*xml);
+        if (index.hasType (kIndexType) && static_cast<int> (index.getProperty ("version")) == kIndexVersion)
+        {
+            for (const auto& child : index)
+            {
+                Entry entry;
+                entry.file = directory.getChildFile (child.getProperty ("file").toString());
+                entry.name = entry.file.getFileNameWithoutExtension();
+                entry.modificationTime = static_cast<juce::int64> (child.getProperty ("modified"));
+                entry.fileSize = static_cast<juce::int64> (child.getProperty ("size"));
+                entry.contentHash = static_cast<uint64_t> (child.getProperty ("hash").toString().getHexValue64());
+                entry.analysed = true;
+                entry.valid = static_cast<bool> (child.getProperty ("valid"));
+                entry.noteCount = static_cast<int> (child.getProperty ("notes"));
+                entry.durationSeconds = static_cast<double> (child.getProperty ("duration"));
+                entry.minBpm = static_cast<double> (child.getProperty ("min_bpm"));
+                entry.maxBpm = static_cast<double> (child.getProperty ("max_bpm"));
+                entry.minIoiMs = static_cast<double> (child.getProperty ("min_ioi_ms"));
+                entry.medianIoiMs = static_cast<double> (child.getProperty ("median_ioi_ms"));
+                entry.trackNames.addLines (child.getProperty ("tracks").toString());
+                entry.trackNames.removeEmptyStrings();
+                entries->push_back (std::move (entry));
+            }
+        }
+    }
+
+    publish (std::move (entries));
+    loaded.store (true, std::memory_order_release);
+}
+
+void ReferenceLibrary::saveIndex (const Snapshot& entries) const
+{
+    juce::ValueTree index (kIndexType);
+    index.setProperty ("version", kIndexVersion, nullptr);
+    for (const auto& entry : entries)
+    {
+        // Entries still waiting for analysis are left out; the next scan picks them up again.
+        if (! entry.analysed)
+            continue;
+
+        juce::ValueTree child (kEntryType);
+        child.setProperty ("file", entry.file.getFileName(), nullptr);
+        child.setProperty ("modified", static_cast<juce::int64> (entry.modificationTime), nullptr);
+        child.setProperty ("size", static_cast<juce::int64> (entry.fileSize), nullptr);
+        child.setProperty ("hash", juce::String::toHexString (static_cast<juce::int64> (entry.contentHash)), nullptr);
+        child.setProperty ("valid", entry.valid, nullptr);
+        child.setProperty ("notes", entry.noteCount, nullptr);
+        child.setProperty ("duration", entry.durationSeconds, nullptr);
+        child.setProperty ("min_bpm", entry.minBpm, nullptr);
+        child.setProperty ("max_bpm", entry.maxBpm, nullptr);
+        child.setProperty ("min_ioi_ms", entry.minIoiMs, nullptr);
+        child.setProperty ("median_ioi_ms", entry.medianIoiMs, nullptr);
+        child.setProperty ("tracks", entry.trackNames.joinIntoString ("\n"), nullptr);
+        index.appendChild (child, nullptr);
+    }
+
+    const auto indexFile = getIndexFile();
+    if (indexFile.getParentDirectory().createDirectory().wasOk())
+    {
+        if (auto xml = index.createXml())
+            xml->writeTo (indexFile);
+    }
+}
+
+void ReferenceLibrary::scan()
+{
+    const auto previous = getSnapshot();
+    const auto directory = getLibraryDirectory();
+
+    juce::Array<juce::File> files;
+    if (directory.isDirectory())
+        directory.findChildFiles (files, juce::File::findFiles, false, "*.mid;*.midi");
+
+    std::sort (files.begin(), files.end(), [] (const juce::File& a, const juce::File& b)
+    {
+        return a.getFileName().compareIgnoreCase (b.getFileName()) < 0;
+    });
+
+    std::map<juce::String, const Entry*> known;
+    if (previous != nullptr)
+    {
+        for (const auto& entry : *previous)
+            known.emplace (entry.file.getFullPathName(), &entry);
+    }
+
+    struct Pending
+    {
+        size_t index;
+        const Entry* previous;
+    };
+
+    auto entries = std::make_shared<Snapshot>();
+    entries->reserve (static_cast<size_t> (files.size()));
+    std::vector<Pending> pending;
+    bool changed = previous == nullptr || previous->size() != static_cast<size_t> (files.size());
+
+    for (const auto& file : files)
+    {
+        const int64_t modificationTime = file.getLastModificationTime().toMilliseconds();
+        const int64_t fileSize = file.getSize();
+
+        const auto found = known.find (file.getFullPathName());
+        const Entry* knownEntry = found != known.end() ? found->second : nullptr;
+
+        if (knownEntry != nullptr && knownEntry->analysed
+            && knownEntry->modificationTime == modificationTime && knownEntry->fileSize == fileSize)
+        {
+            entries->push_back (*knownEntry);
+            continue;
+        }
+
+        Entry entry;
+        entry.file = file;
+        entry.name = file.getFileNameWithoutExtension();
+        entry.modificationTime = modificationTime;
+        entry.fileSize = fileSize;
+        pending.push_back ({ entries->size(), knownEntry != nullptr && knownEntry->analysed ? knownEntry : nullptr });
+        entries->push_back (std::move (entry));
+        changed = true;
+    }
+
+    if (! changed)
+        return;
+
+    if (pending.empty())
+    {
+        saveIndex (*entries);
+        publish (std::move (entries));
+        return;
+    }
+
+    // List new files straight away; their details follow in batches as they are analysed.
+    publish (std::make_shared<const Snapshot> (*entries));
+
+    auto lastPublish = juce::Time::getMillisecondCounter();
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+        if (threadShouldExit())
+            return;
+
+        auto& entry = (*entries)[pending[i].index];
+        entry.valid = analyseFile (entry.file, entry, pending[i].previous);
+        entry.analysed = true;
+
+        const auto now = juce::Time::getMillisecondCounter();
+        if (i + 1 < pending.size() && now - lastPublish >= static_cast<juce::uint32> (kPublishIntervalMs))
+        {
+            saveIndex (*entries);
+            publish (std::make_shared<const Snapshot> (*entries));
+            lastPublish = now;
+        }
+    }
+
+    saveIndex (*entries);
+    publish (std::move (entries));
+}
+
+bool ReferenceLibrary::analyseFile (const juce::File& file, Entry& entry, const Entry* previous)
+{
+    juce::MemoryMappedFile mappedFile (file, juce::MemoryMappedFile::readOnly);
+    if (mappedFile.getData() == nullptr)
+        return false;
+
+    const auto* data = static_cast<const uint8_t*> (mappedFile.getData());
+    entry.contentHash = hashBytes (data, mappedFile.getSize());
+
+    // Touched or copied back but unchanged: keep the previous analysis.
+    if (previous != nullptr && previous->fileSize == entry.fileSize && previous->contentHash == entry.contentHash)
+    {
+        const auto modificationTime = entry.modificationTime;
+        entry = *previous;
+        entry.modificationTime = modificationTime;
+        return entry.valid;
+    }
+
+    SmfReader reader;
+    if (! reader.open (data, mappedFile.getSize()))
+        return false;
+
+    reader.decodeAllTracks();
+    for (const auto& track : reader.getTracks())
+    {
+        if (! track.name.empty())
+            entry.trackNames.add (juce::String::fromUTF8 (track.name.data(), static_cast<int> (track.name.size())).trim());
+    }
+    entry.trackNames.removeEmptyStrings();
+
+    const auto tempos = reader.mergeTempos();
+    const SmfReader::TempoMap tempoMap (tempos, reader.getTimeFormat());
+    entry.minBpm = tempos.empty() ? 120.0 : std::numeric_limits<double>::max();
+    entry.maxBpm = tempos.empty() ? 120.0 : 0.0;
+    for (const auto& tempo : tempos)
+    {
+        const double bpm = tempo.microsPerQuarter > 0 ? 60000000.0 / tempo.microsPerQuarter : 120.0;
+        entry.minBpm = juce::jmin (entry.minBpm, bpm);
+        entry.maxBpm = juce::jmax (entry.maxBpm, bpm);
+    }
+
+    const auto notes = reader.mergeNotes();
+    entry.noteCount = static_cast<int> (notes.size());
+
+    std::vector<double> deltas;
+    deltas.reserve (notes.size());
+    double previousOnSeconds = 0.0;
+    for (size_t i = 0; i < notes.size(); ++i)
+    {
+        const double onSeconds = tempoMap.toSeconds (notes[i].onTick);
+        entry.durationSeconds = juce::jmax (entry.durationSeconds, tempoMap.toSeconds (notes[i].offTick));
+        if (i > 0 && onSeconds > previousOnSeconds)
+            deltas.push_back (onSeconds - previousOnSeconds);
+        previousOnSeconds = onSeconds;
+    }
+
+    if (! deltas.empty())
+    {
+        std::sort (deltas.begin(), deltas.end());
+        entry.minIoiMs = deltas.front() * 1000.0;
+        entry.medianIoiMs = deltas[deltas.size() / 2] * 1000.0;
+    }
+
+    return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Catalogue of the reference MIDI files in the personalities folder. A background thread
+// loads the persisted index, then polls the folder: files whose modification time or size
+// changed are re-analysed (unless their content hash is unchanged), removed files are dropped,
+// and changes publish a new immutable snapshot and rewrite the index, in batches while a
+// large folder is being analysed. The UI only reads snapshots, so listing and
+// searching never touch the disk. Shared by every editor in the process.
+class ReferenceLibrary final : private juce::Thread
+{
+public:
+    struct Entry
+    {
+        juce::File file;
+        juce::String name;
+        int64_t modificationTime = 0;
+        int64_t fileSize = 0;
+        uint64_t contentHash = 0;
+        bool analysed = false;
+        bool valid = false;
+        int noteCount = 0;
+        double durationSeconds = 0.0;
+        double minBpm = 0.0;
+        double maxBpm = 0.0;
+        double minIoiMs = -1.0;
+        double medianIoiMs = -1.0;
+        juce::StringArray trackNames;
+    };
+
+    using Snapshot = std::vector<Entry>;
+
+    ReferenceLibrary();
+    ~ReferenceLibrary() override;
+
+    static juce::File getLibraryDirectory();
+    static juce::File getIndexFile();
+
+    // Entries sorted by file name; empty until the persisted index has been read.
+    std::shared_ptr<const Snapshot> getSnapshot() const;
+    bool hasLoaded() const noexcept;
+    // Bumped whenever a new snapshot is published.
+    uint32_t getChangeSequence() const noexcept;
+    void requestRescan();
+
+    // Indices of the snapshot entries whose name or track names contain every word of query.
+    static std::vector<int> search (const Snapshot& snapshot, const juce::String& query);
+    static juce::String describe (const Entry& entry);
+
+private:
+    void run() override;
+    void loadIndex();
+    void saveIndex (const Snapshot& snapshot) const;
+    void scan();
+    void publish (std::shared_ptr<const Snapshot> snapshot);
+    // previous is the file's last analysed entry, reused when the content hash still matches.
+    static bool analyseFile (const juce::File& file, Entry& entry, const Entry* previous);
+
+    std::shared_ptr<const Snapshot> snapshot;
+    std::atomic<bool> loaded { false };
+    std::atomic<uint32_t> changeSequence { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReferenceLibrary)
+};
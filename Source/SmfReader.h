@@ -0,0 +1,388 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Standard MIDI File reader that decodes straight from a byte range (e.g. a memory-mapped
+// file) into note and tempo tables. Each track chunk is decoded independently in one pass,
+// pairing note-on/off per (channel, pitch) with an intrusive stack; tracks are then combined
+// with a k-way merge ordered by tick, then track, then position in the track - the same order
+// a stable sort of the concatenated tracks gives.
+class SmfReader
+{
+public:
+    struct Note
+    {
+        uint64_t onTick = 0;
+        uint64_t offTick = 0;
+        uint8_t noteNumber = 0;
+        uint8_t channel = 1;
+        uint8_t onVelocity = 0;
+        uint8_t offVelocity = 0;
+    };
+
+    struct Tempo
+    {
+        uint64_t tick = 0;
+        uint32_t microsPerQuarter = 500000;
+    };
+
+    struct TimeSignature
+    {
+        uint64_t tick = 0;
+        int numerator = 4;
+        int denominator = 4;
+    };
+
+    struct Track
+    {
+        std::vector<Note> notes;
+        std::vector<Tempo> tempos;
+        std::vector<TimeSignature> timeSignatures;
+        // First sequence/track name meta event, raw bytes.
+        std::string name;
+    };
+
+    struct Chunk
+    {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    // Reads the header and locates the track chunks; nothing is decoded yet.
+    bool open (const uint8_t* data, size_t size)
+    {
+        tracks.clear();
+        chunks.clear();
+        if (data == nullptr || size < 14)
+            return false;
+
+        // RMID files wrap the SMF in a RIFF container.
+        if (std::memcmp (data, "RIFF", 4) == 0)
+        {
+            size_t offset = 4;
+            while (offset + 4 <= size && std::memcmp (data + offset, "MThd", 4) != 0)
+                ++offset;
+            data += offset;
+            size -= offset;
+        }
+
+        if (size < 14 || std::memcmp (data, "MThd", 4) != 0)
+            return false;
+
+        const uint32_t headerLength = readBigEndian (data + 4, 4);
+        if (headerLength < 6 || headerLength > size - 8)
+            return false;
+
+        const int trackCount = static_cast<int> (readBigEndian (data + 10, 2));
+        timeFormat = static_cast<int16_t> (readBigEndian (data + 12, 2));
+        if ((timeFormat & 0x7fff) == 0 || (timeFormat < 0 && (timeFormat & 0xff) == 0))
+            return false;
+
+        size_t offset = 8 + headerLength;
+        while (static_cast<int> (chunks.size()) < trackCount && offset + 8 <= size)
+        {
+            const auto chunkLength = static_cast<size_t> (readBigEndian (data + offset + 4, 4));
+            const size_t available = std::min (chunkLength, size - offset - 8);
+            if (std::memcmp (data + offset, "MTrk", 4) == 0)
+                chunks.push_back ({ data + offset + 8, available });
+            offset += 8 + available;
+        }
+
+        tracks.resize (chunks.size());
+        return true;
+    }
+
+    int getTimeFormat() const noexcept
+    {
+        return timeFormat;
+    }
+
+    int getNumTracks() const noexcept
+    {
+        return static_cast<int> (chunks.size());
+    }
+
+    size_t getTrackBytes (int index) const noexcept
+    {
+        return chunks[static_cast<size_t> (index)].size;
+    }
+
+    // Decodes one track chunk. Tracks are independent, so different tracks may be decoded on
+    // different threads. A malformed event ends the track; what was decoded so far is kept.
+    void decodeTrack (int index)
+    {
+        decodeChunk (chunks[static_cast<size_t> (index)], tracks[static_cast<size_t> (index)]);
+    }
+
+    void decodeAllTracks()
+    {
+        for (int i = 0; i < getNumTracks(); ++i)
+            decodeTrack (i);
+    }
+
+    const std::vector<Track>& getTracks() const noexcept
+    {
+        return tracks;
+    }
+
+    // All paired notes in note-on order across tracks.
+    std::vector<Note> mergeNotes() const
+    {
+        return mergeTracks (&Track::notes, [] (const Note& note) { return note.onTick; });
+    }
+
+    std::vector<Tempo> mergeTempos() const
+    {
+        return mergeTracks (&Track::tempos, [] (const Tempo& tempo) { return tempo.tick; });
+    }
+
+    std::vector<TimeSignature> mergeTimeSignatures() const
+    {
+        return mergeTracks (&Track::timeSignatures, [] (const TimeSignature& sig) { return sig.tick; });
+    }
+
+    // Piecewise-linear tick -> seconds map built from the merged tempo events. Before the first
+    // tempo event the SMF default of 120 bpm applies.
+    class TempoMap
+    {
+    public:
+        TempoMap (const std::vector<Tempo>& tempos, int format)
+            : timeFormat (format)
+        {
+            if (timeFormat < 0)
+                return;
+
+            const double tickLength = 1.0 / static_cast<double> (timeFormat & 0x7fff);
+            segments.push_back ({ 0, 0.0, 0.5 * tickLength });
+            for (const auto& tempo : tempos)
+            {
+                auto& last = segments.back();
+                const double seconds = last.seconds + static_cast<double> (tempo.tick - last.tick) * last.secondsPerTick;
+                const double secondsPerTick = tickLength * static_cast<double> (tempo.microsPerQuarter) / 1000000.0;
+                if (tempo.tick == last.tick)
+                    last.secondsPerTick = secondsPerTick;
+                else
+                    segments.push_back ({ tempo.tick, seconds, secondsPerTick });
+            }
+        }
+
+        double toSeconds (uint64_t tick) const noexcept
+        {
+            if (timeFormat < 0)
+                return static_cast<double> (tick) / (-(timeFormat >> 8) * (timeFormat & 0xff));
+
+            auto segment = std::upper_bound (segments.begin(), segments.end(), tick,
+                [] (uint64_t value, const Segment& s) { return value < s.tick; });
+            const auto& active = *(segment - 1);
+            return active.seconds + static_cast<double> (tick - active.tick) * active.secondsPerTick;
+        }
+
+    private:
+        struct Segment
+        {
+            uint64_t tick = 0;
+            double seconds = 0.0;
+            double secondsPerTick = 0.0;
+        };
+
+        int timeFormat = 0;
+        std::vector<Segment> segments;
+    };
+
+private:
+    static uint32_t readBigEndian (const uint8_t* data, int bytes) noexcept
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < bytes; ++i)
+            value = (value << 8) | data[i];
+        return value;
+    }
+
+    static bool readVariableLength (const uint8_t*& data, const uint8_t* end, uint32_t& value) noexcept
+    {
+        value = 0;
+        for (int i = 0; i < 4 && data < end; ++i)
+        {
+            const uint8_t byte = *data++;
+            value = (value << 7) | (byte & 0x7f);
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    static int channelDataBytes (uint8_t status) noexcept
+    {
+        const uint8_t type = status & 0xf0;
+        return (type == 0xc0 || type == 0xd0) ? 1 : 2;
+    }
+
+    static void decodeChunk (const Chunk& chunk, Track& track)
+    {
+        track = {};
+        const uint8_t* data = chunk.data;
+        const uint8_t* const end = chunk.data + chunk.size;
+
+        // Open note-ons per (channel, pitch), most recent first; links run through openLinks.
+        std::vector<int> openHeads (16 * 128, -1);
+        std::vector<int> openLinks;
+        uint64_t tick = 0;
+        uint8_t runningStatus = 0;
+
+        while (data < end)
+        {
+            uint32_t delta = 0;
+            if (! readVariableLength (data, end, delta) || data >= end)
+                break;
+            tick += delta;
+
+            uint8_t status = *data;
+            if (status >= 0x80)
+                ++data;
+            else if (runningStatus != 0)
+                status = runningStatus;
+            else
+                break;
+
+            if (status == 0xff)
+            {
+                if (data >= end)
+                    break;
+                const uint8_t type = *data++;
+                uint32_t length = 0;
+                if (! readVariableLength (data, end, length) || length > static_cast<size_t> (end - data))
+                    break;
+
+                if (type == 0x51 && length >= 3)
+                    track.tempos.push_back ({ tick, readBigEndian (data, 3) });
+                else if (type == 0x03 && track.name.empty())
+                    track.name.assign (reinterpret_cast<const char*> (data), length);
+                else if (type == 0x58 && length >= 2)
+                    track.timeSignatures.push_back ({ tick, static_cast<int> (data[0]), 1 << (data[1] & 0x0f) });
+
+                data += length;
+                continue;
+            }
+
+            if (status == 0xf0 || status == 0xf7)
+            {
+                uint32_t length = 0;
+                if (! readVariableLength (data, end, length) || length > static_cast<size_t> (end - data))
+                    break;
+                data += length;
+                continue;
+            }
+
+            if (status > 0xf0)
+            {
+                // System common / real-time bytes do not belong in a track; skip their data.
+                const int skip = status == 0xf2 ? 2 : ((status == 0xf1 || status == 0xf3) ? 1 : 0);
+                if (skip > end - data)
+                    break;
+                data += skip;
+                continue;
+            }
+
+            runningStatus = status;
+            const int dataBytes = channelDataBytes (status);
+            if (dataBytes > end - data)
+                break;
+
+            const uint8_t type = status & 0xf0;
+            const uint8_t channel = static_cast<uint8_t> ((status & 0x0f) + 1);
+            const uint8_t data1 = data[0] & 0x7f;
+            const uint8_t data2 = dataBytes > 1 ? static_cast<uint8_t> (data[1] & 0x7f) : 0;
+            data += dataBytes;
+
+            const int key = (channel - 1) * 128 + data1;
+            if (type == 0x90 && data2 > 0)
+            {
+                openLinks.push_back (openHeads[static_cast<size_t> (key)]);
+                openHeads[static_cast<size_t> (key)] = static_cast<int> (track.notes.size());
+
+                Note note;
+                note.onTick = tick;
+                note.offTick = tick;
+                note.noteNumber = data1;
+                note.channel = channel;
+                note.onVelocity = data2;
+                track.notes.push_back (note);
+            }
+            else if (type == 0x80 || type == 0x90)
+            {
+                const int open = openHeads[static_cast<size_t> (key)];
+                if (open < 0)
+                    continue;
+
+                openHeads[static_cast<size_t> (key)] = openLinks[static_cast<size_t> (open)];
+                openLinks[static_cast<size_t> (open)] = -2;
+                auto& note = track.notes[static_cast<size_t> (open)];
+                note.offTick = tick;
+                note.offVelocity = type == 0x80 ? data2 : 0;
+            }
+        }
+
+        // Note-ons never switched off are dropped, keeping note-on order.
+        size_t kept = 0;
+        for (size_t i = 0; i < track.notes.size(); ++i)
+        {
+            if (openLinks[i] == -2)
+                track.notes[kept++] = track.notes[i];
+        }
+        track.notes.resize (kept);
+    }
+
+    template <typename T, typename TickOf>
+    std::vector<T> mergeTracks (std::vector<T> Track::* member, TickOf tickOf) const
+    {
+        // Heap of (track, position) cursors; ties on tick go to the lower track index.
+        struct Cursor
+        {
+            int track = 0;
+            size_t position = 0;
+        };
+
+        std::vector<T> merged;
+        std::vector<Cursor> heap;
+        size_t total = 0;
+        for (int i = 0; i < static_cast<int> (tracks.size()); ++i)
+        {
+            const auto& items = tracks[static_cast<size_t> (i)].*member;
+            total += items.size();
+            if (! items.empty())
+                heap.push_back ({ i, 0 });
+        }
+
+        const auto later = [this, member, &tickOf] (const Cursor& a, const Cursor& b)
+        {
+            const uint64_t tickA = tickOf ((tracks[static_cast<size_t> (a.track)].*member)[a.position]);
+            const uint64_t tickB = tickOf ((tracks[static_cast<size_t> (b.track)].*member)[b.position]);
+            return tickA != tickB ? tickA > tickB : a.track > b.track;
+        };
+
+        merged.reserve (total);
+        std::make_heap (heap.begin(), heap.end(), later);
+        while (! heap.empty())
+        {
+            std::pop_heap (heap.begin(), heap.end(), later);
+            auto& cursor = heap.back();
+            const auto& items = tracks[static_cast<size_t> (cursor.track)].*member;
+            merged.push_back (items[cursor.position]);
+
+            if (++cursor.position < items.size())
+                std::push_heap (heap.begin(), heap.end(), later);
+            else
+                heap.pop_back();
+        }
+
+        return merged;
+    }
+
+    std::vector<Chunk> chunks;
+    std::vector<Track> tracks;
+    int timeFormat = 96;
+};
@@ -0,0 +1,140 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+// Two-state Kalman filter over the user-to-reference time map: the user time of the last
+// observed reference position (offset) and the user/reference tempo ratio. Each matched
+// note-on is one measurement; the variance of the offset tells callers how far to widen
+// their search and timeout windows. Times are in seconds. No allocation, safe on the
+// audio thread.
+class TempoEstimator
+{
+public:
+    struct Settings
+    {
+        // Random walk of the offset and ratio, per second of reference time.
+        double offsetNoise = 0.02 * 0.02;
+        double ratioNoise = 0.02 * 0.02;
+        // Timing noise of a single played note.
+        double measurementNoise = 0.03 * 0.03;
+        double initialRatioVariance = 0.2 * 0.2;
+        double minRatio = 0.5;
+        double maxRatio = 2.0;
+        // Innovations beyond this many standard deviations are treated as outliers;
+        // kMaxRejects of them in a row restart the filter at the new position.
+        double gateSigmas = 4.0;
+    };
+
+    static constexpr int kMinObservations = 3;
+    static constexpr int kMaxRejects = 3;
+
+    void setSettings (const Settings& newSettings) noexcept
+    {
+        settings = newSettings;
+    }
+
+    void reset() noexcept
+    {
+        anchorReference = 0.0;
+        offset = 0.0;
+        ratio = 1.0;
+        p00 = p01 = p11 = 0.0;
+        observationCount = 0;
+        rejectCount = 0;
+    }
+
+    bool isPrimed() const noexcept
+    {
+        return observationCount >= kMinObservations;
+    }
+
+    int getObservationCount() const noexcept
+    {
+        return observationCount;
+    }
+
+    // User seconds per reference second (> 1 means the user plays slower).
+    double getTempoRatio() const noexcept
+    {
+        return ratio;
+    }
+
+    // Standard deviation of the predicted user time at the given reference time.
+    double getSpread (double referenceTime) const noexcept
+    {
+        const double dt = std::max (0.0, referenceTime - anchorReference);
+        const double variance = p00 + 2.0 * dt * p01 + dt * dt * p11
+            + dt * (settings.offsetNoise + dt * settings.ratioNoise);
+        return std::sqrt (std::max (0.0, variance));
+    }
+
+    double predict (double referenceTime) const noexcept
+    {
+        return offset + (referenceTime - anchorReference) * ratio;
+    }
+
+    void observe (double referenceTime, double userTime) noexcept
+    {
+        if (observationCount == 0)
+        {
+            restart (referenceTime, userTime);
+            return;
+        }
+
+        const double dt = referenceTime - anchorReference;
+        if (dt < 0.0)
+            return;
+
+        // Time update: x = F x, P = F P F' + Q with F = [1 dt; 0 1].
+        const double predictedOffset = offset + dt * ratio;
+        const double q00 = p00 + 2.0 * dt * p01 + dt * dt * p11 + dt * settings.offsetNoise;
+        const double q01 = p01 + dt * p11;
+        const double q11 = p11 + dt * settings.ratioNoise;
+
+        const double innovation = userTime - predictedOffset;
+        const double innovationVariance = q00 + settings.measurementNoise;
+        if (isPrimed()
+            && innovation * innovation > settings.gateSigmas * settings.gateSigmas * innovationVariance)
+        {
+            if (++rejectCount >= kMaxRejects)
+                restart (referenceTime, userTime);
+            return;
+        }
+
+        rejectCount = 0;
+
+        // Measurement update with H = [1 0].
+        const double gainOffset = q00 / innovationVariance;
+        const double gainRatio = q01 / innovationVariance;
+        anchorReference = referenceTime;
+        offset = predictedOffset + gainOffset * innovation;
+        ratio = std::clamp (ratio + gainRatio * innovation, settings.minRatio, settings.maxRatio);
+        p00 = (1.0 - gainOffset) * q00;
+        p01 = (1.0 - gainOffset) * q01;
+        p11 = q11 - gainRatio * q01;
+        ++observationCount;
+    }
+
+private:
+    void restart (double referenceTime, double userTime) noexcept
+    {
+        anchorReference = referenceTime;
+        offset = userTime;
+        ratio = 1.0;
+        p00 = settings.measurementNoise;
+        p01 = 0.0;
+        p11 = settings.initialRatioVariance;
+        observationCount = 1;
+        rejectCount = 0;
+    }
+
+    Settings settings;
+    double anchorReference = 0.0;
+    double offset = 0.0;
+    double ratio = 1.0;
+    double p00 = 0.0;
+    double p01 = 0.0;
+    double p11 = 0.0;
+    int observationCount = 0;
+    int rejectCount = 0;
+};
@@ -0,0 +1,109 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+// Coupled phase/period tracker mapping reference time onto the user's timeline
+// (after Cont 2010). Units are whatever the caller feeds in (samples or seconds);
+// the plugin and the offline sim share it. No allocation, safe on the audio thread.
+class TempoTracker
+{
+public:
+    struct Settings
+    {
+        double phaseGain = 0.5;
+        double periodGain = 0.2;
+        double minRatio = 0.5;
+        double maxRatio = 2.0;
+        // Reference spans shorter than this (e.g. chord notes) only correct phase.
+        double minPeriodSpan = 0.0;
+        double errorSmoothing = 0.2;
+        double slackSpreadScale = 2.0;
+    };
+
+    void setSettings (const Settings& newSettings) noexcept
+    {
+        settings = newSettings;
+    }
+
+    void reset() noexcept
+    {
+        anchorReference = 0.0;
+        anchorUser = 0.0;
+        ratio = 1.0;
+        lateSpread = 0.0;
+        observationCount = 0;
+    }
+
+    bool isPrimed() const noexcept
+    {
+        return observationCount > 0;
+    }
+
+    int getObservationCount() const noexcept
+    {
+        return observationCount;
+    }
+
+    // User-time units per reference-time unit (> 1 means the user plays slower).
+    double getTempoRatio() const noexcept
+    {
+        return ratio;
+    }
+
+    // Smoothed amount by which the user arrives after the prediction.
+    double getLateSpread() const noexcept
+    {
+        return lateSpread;
+    }
+
+    // Output slack needed to honour most early corrections at the given correction amount.
+    double getPredictiveSlack (double correction, double maxSlack) const noexcept
+    {
+        return std::clamp (settings.slackSpreadScale * correction * lateSpread,
+                           0.0,
+                           std::max (0.0, maxSlack));
+    }
+
+    double predict (double referenceTime) const noexcept
+    {
+        return anchorUser + (referenceTime - anchorReference) * ratio;
+    }
+
+    void observe (double referenceTime, double userTime) noexcept
+    {
+        if (observationCount == 0)
+        {
+            anchorReference = referenceTime;
+            anchorUser = userTime;
+            ++observationCount;
+            return;
+        }
+
+        const double span = referenceTime - anchorReference;
+        if (span < 0.0)
+            return;
+
+        const double predicted = predict (referenceTime);
+        const double error = userTime - predicted;
+
+        if (span > settings.minPeriodSpan && span > 0.0)
+        {
+            ratio = std::clamp (ratio + settings.periodGain * error / span,
+                                settings.minRatio,
+                                settings.maxRatio);
+        }
+
+        anchorReference = referenceTime;
+        anchorUser = predicted + settings.phaseGain * error;
+        lateSpread += settings.errorSmoothing * (std::max (0.0, error) - lateSpread);
+        ++observationCount;
+    }
+
+private:
+    Settings settings;
+    double anchorReference = 0.0;
+    double anchorUser = 0.0;
+    double ratio = 1.0;
+    double lateSpread = 0.0;
+    int observationCount = 0;
+};
@@ -1,4 +1,7 @@
 #include <JuceHeader.h>
+#include "../Source/DtwFollower.h"
+#include "../Source/HmmFollower.h"
+#include "../Source/TempoTracker.h"
 #include <algorithm>
 #include <array>
 #include <cmath>
@@ -16,6 +19,21 @@ namespace
         double offTime = 0.0;
     };
 
+    struct NoteCluster
+    {
+        int startIndex = 0;
+        int noteCount = 0;
+    };
+
+    // Same shape the followers expect from the plugin's reference data.
+    struct ClusteredReference
+    {
+        std::vector<NoteEvent> notes;
+        std::vector<NoteCluster> clusters;
+    };
+
+    enum class MatchEngine { Greedy, Hmm, Dtw };
+
     struct Stats
     {
         double min = std::numeric_limits<double>::infinity();
@@ -51,7 +69,11 @@ namespace
         int matchedInWindow = 0;
         int missedMatches = 0;
         int referenceExhausted = 0;
+        int truncatedOutputs = 0;
         Stats deltaMatched;
+        Stats outputLatency;
+        Stats truncation;
+        double finalTempoRatio = 1.0;
     };
 
     double convertTicksToSeconds (double time,
@@ -198,6 +220,37 @@ namespace
         return notes;
     }
 
+    ClusteredReference buildClusters (const std::vector<NoteEvent>& notes, double clusterWindowSeconds)
+    {
+        ClusteredReference reference;
+        reference.notes = notes;
+        if (notes.empty())
+            return reference;
+
+        NoteCluster cluster;
+        cluster.noteCount = 1;
+        double clusterStartTime = notes.front().onTime;
+
+        for (int i = 1; i < static_cast<int> (notes.size()); ++i)
+        {
+            const double timeSeconds = notes[static_cast<size_t> (i)].onTime;
+            if ((timeSeconds - clusterStartTime) <= clusterWindowSeconds)
+            {
+                ++cluster.noteCount;
+            }
+            else
+            {
+                reference.clusters.push_back (cluster);
+                cluster.startIndex = i;
+                cluster.noteCount = 1;
+                clusterStartTime = timeSeconds;
+            }
+        }
+
+        reference.clusters.push_back (cluster);
+        return reference;
+    }
+
     double findFirstNoteTime (const std::vector<NoteEvent>& notes)
     {
         if (notes.empty())
@@ -208,8 +261,11 @@ namespace
     MatchStats simulateMatching (const std::vector<NoteEvent>& referenceNotes,
                                  const std::vector<NoteEvent>& userNotes,
                                  double matchWindowSeconds,
+                                 double slackSeconds,
                                  double correction,
-                                 bool alignToFirstNote)
+                                 bool alignToFirstNote,
+                                 bool predictive,
+                                 MatchEngine engine)
     {
         MatchStats stats;
         stats.totalReferenceNotes = static_cast<int> (referenceNotes.size());
@@ -221,6 +277,25 @@ namespace
         std::vector<uint8_t> matched (referenceNotes.size(), 0);
         int referenceCursor = 0;
 
+        // The plugin clusters with its own window; the match window stands in for it here.
+        const auto clustered = buildClusters (referenceNotes, juce::jmax (0.02, matchWindowSeconds));
+        HmmFollower<ClusteredReference> hmmFollower;
+        DtwFollower<ClusteredReference> dtwFollower;
+
+        TempoTracker tempoTracker;
+        TempoTracker::Settings trackerSettings;
+        trackerSettings.minPeriodSpan = 0.08;
+        tempoTracker.setSettings (trackerSettings);
+
+        // Reference onset mapped onto the user's timeline, as the plugin does.
+        auto alignReferenceTime = [&] (double referenceTime)
+        {
+            const double offset = referenceTime - referenceStart;
+            if (predictive && tempoTracker.isPrimed())
+                return tempoTracker.predict (offset);
+            return offset;
+        };
+
         for (const auto& userNote : userNotes)
         {
             const double userTime = userNote.onTime - userStart;
@@ -234,7 +309,19 @@ namespace
             int selectedIndex = -1;
             bool matchedInWindow = false;
 
-            if (matchWindowSeconds <= 0.0)
+            if (engine != MatchEngine::Greedy)
+            {
+                selectedIndex = (engine == MatchEngine::Hmm)
+                    ? hmmFollower.observe (clustered, matched.data(), userNote.noteNumber, userNote.channel, 0).noteIndex
+                    : dtwFollower.observe (clustered, matched.data(), userNote.noteNumber, userNote.channel, 0).noteIndex;
+                if (selectedIndex < 0)
+                {
+                    ++stats.missedMatches;
+                    continue;
+                }
+                matchedInWindow = true;
+            }
+            else if (matchWindowSeconds <= 0.0)
             {
                 selectedIndex = referenceCursor;
                 matchedInWindow = true;
@@ -253,7 +340,7 @@ namespace
                         continue;
 
                     const auto& refNote = referenceNotes[static_cast<size_t> (i)];
-                    const double alignedRefTime = refNote.onTime - referenceStart;
+                    const double alignedRefTime = alignReferenceTime (refNote.onTime);
 
                     if (alignedRefTime < windowStart)
                         continue;
@@ -297,16 +384,29 @@ namespace
             }
 
             const auto& refNote = referenceNotes[static_cast<size_t> (selectedIndex)];
-            const double alignedRefTime = refNote.onTime - referenceStart;
+            const double alignedRefTime = alignReferenceTime (refNote.onTime);
             const double rawDeltaSeconds = alignedRefTime - userTime;
             const double deltaSeconds = rawDeltaSeconds * correction;
             const double deltaMs = deltaSeconds * 1000.0;
 
+            const double noteSlack = predictive
+                ? tempoTracker.getPredictiveSlack (correction, slackSeconds)
+                : slackSeconds;
+            const double targetTime = userTime + deltaSeconds + noteSlack;
+            const double outputTime = std::max (targetTime, userTime);
+            if (outputTime > targetTime)
+                ++stats.truncatedOutputs;
+            stats.outputLatency.add ((outputTime - userTime) * 1000.0);
+            stats.truncation.add ((outputTime - targetTime) * 1000.0);
+
+            tempoTracker.observe (refNote.onTime - referenceStart, userTime);
+
             if (matchedInWindow)
                 ++stats.matchedInWindow;
             stats.deltaMatched.add (deltaMs);
         }
 
+        stats.finalTempoRatio = tempoTracker.getTempoRatio();
         return stats;
     }
 
@@ -324,6 +424,16 @@ namespace
                       << ", mean " << stats.deltaMatched.mean()
                       << ", mean abs " << stats.deltaMatched.meanAbs() << "\n";
         }
+        if (stats.outputLatency.count > 0)
+        {
+            std::cout << "Output latency (ms): min " << stats.outputLatency.min
+                      << ", max " << stats.outputLatency.max
+                      << ", mean " << stats.outputLatency.mean() << "\n";
+            std::cout << "Truncated corrections: " << stats.truncatedOutputs
+                      << " (mean " << stats.truncation.mean()
+                      << " ms, max " << stats.truncation.max << " ms)\n";
+        }
+        std::cout << "Tracked tempo ratio: " << stats.finalTempoRatio << "\n";
     }
 
     void printUsage()
@@ -336,7 +446,9 @@ namespace
                   << "  --correction <value>      (default 1.0)\n"
                   << "  --user-tempo <reference|file>\n"
                   << "  --user-bpm <value> (implies fixed tempo)\n"
-                  << "  --no-align-start (use absolute timestamps)\n";
+                  << "  --no-align-start (use absolute timestamps)\n"
+                  << "  --predictive (tempo-tracked alignment with adaptive slack capped by --slack-ms)\n"
+                  << "  --engine <greedy|hmm|dtw> (default greedy; hmm/dtw cluster by --match-window-ms)\n";
     }
 }
 
@@ -353,6 +465,8 @@ int main (int argc, char* argv[])
     double slackMs = 50.0;
     double correction = 1.0;
     bool alignToFirstNote = true;
+    bool predictive = false;
+    MatchEngine engine = MatchEngine::Greedy;
     enum class UserTempoMode { Reference, File, Fixed };
     UserTempoMode userTempoMode = UserTempoMode::Reference;
     double userFixedBpm = 120.0;
@@ -397,6 +511,20 @@ int main (int argc, char* argv[])
         {
             alignToFirstNote = false;
         }
+        else if (arg == "--predictive")
+        {
+            predictive = true;
+        }
+        else if (arg == "--engine" && i + 1 < argc)
+        {
+            const juce::String name = argv[++i];
+            if (name == "hmm")
+                engine = MatchEngine::Hmm;
+            else if (name == "dtw")
+                engine = MatchEngine::Dtw;
+            else
+                engine = MatchEngine::Greedy;
+        }
         else if (arg == "--help" || arg == "-h")
         {
             printUsage();
@@ -473,7 +601,12 @@ int main (int argc, char* argv[])
     std::cout << "Reference file: " << referenceFile.getFullPathName() << "\n";
     std::cout << "User file: " << userFile.getFullPathName() << "\n";
     std::cout << "Match window: " << matchWindowMs << " ms\n";
-    std::cout << "Slack: " << slackMs << " ms (does not affect matching)\n";
+    std::cout << "Slack: " << slackMs << " ms"
+              << (predictive ? " (cap for adaptive slack)" : " (does not affect matching)") << "\n";
+    std::cout << "Output mode: " << (predictive ? "predictive" : "fixed slack") << "\n";
+    std::cout << "Engine: "
+              << (engine == MatchEngine::Hmm ? "hmm" : (engine == MatchEngine::Dtw ? "dtw" : "greedy"))
+              << "\n";
     std::cout << "Correction: " << correction << "\n";
     std::cout << "Align to first note: " << (alignToFirstNote ? "yes" : "no") << "\n";
     std::cout << "User tempo mode: "
@@ -487,8 +620,11 @@ int main (int argc, char* argv[])
     const auto stats = simulateMatching (referenceNotes,
                                          userNotes,
                                          matchWindowMs / 1000.0,
+                                         slackMs / 1000.0,
                                          correction,
-                                         alignToFirstNote);
+                                         alignToFirstNote,
+                                         predictive,
+                                         engine);
     printStats (stats);
 
     return 0;
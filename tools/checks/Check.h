@@ -0,0 +1,30 @@
+#pragma once
+#include <iostream>
+
+// Shared by the per-header check executables registered with CTest: each file runs its checks,
+// then returns finish() from main, which exits non-zero if any of them failed.
+namespace checks
+{
+    inline int failures = 0;
+
+    inline void check (bool condition, const char* what)
+    {
+        if (! condition)
+        {
+            std::cerr << "FAILED: " << what << "\n";
+            ++failures;
+        }
+    }
+
+    inline int finish (const char* name)
+    {
+        if (failures > 0)
+        {
+            std::cerr << name << ": " << failures << " check(s) failed\n";
+            return 1;
+        }
+
+        std::cout << name << ": all checks passed\n";
+        return 0;
+    }
+}
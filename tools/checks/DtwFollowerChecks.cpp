@@ -0,0 +1,75 @@
+// CTest checks for DtwFollower: in-order following and a position that never moves back.
+#include "../../Source/DtwFollower.h"
+#include "Check.h"
+#include "TestReference.h"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using checks::check;
+
+namespace
+{
+    void checkDtwFollower()
+    {
+        const auto reference = makeScale (40);
+        std::vector<uint8_t> matched (reference.notes.size(), 0);
+        DtwFollower<TestReference> follower;
+        follower.reset (0);
+
+        bool followed = true;
+        for (int i = 0; i < 20; ++i)
+        {
+            const auto result = follower.observe (reference, matched.data(), 40 + i, 1, 0);
+            followed = followed && result.clusterIndex == i && result.noteIndex == i;
+            if (result.noteIndex >= 0)
+                matched[static_cast<size_t> (result.noteIndex)] = 1;
+        }
+        check (followed && follower.getPosition() == 19, "dtw: follows a scale played in order");
+
+        // Going back is left to relocalisation: the position never drops and nothing behind it matches.
+        bool held = true;
+        for (int i = 10; i < 14; ++i)
+        {
+            const auto result = follower.observe (reference, matched.data(), 40 + i, 1, 0);
+            held = held && follower.getPosition() >= 19 && result.noteIndex < 0;
+        }
+        check (held, "dtw: back-jump does not move the position back");
+
+        // Random playing over an ambiguous reference never moves it back either.
+        std::mt19937 random (1);
+        int backwardMoves = 0;
+        for (int round = 0; round < 500; ++round)
+        {
+            TestReference ambiguous;
+            for (int c = 0; c < 60; ++c)
+            {
+                const int count = 1 + static_cast<int> (random() % 3);
+                ambiguous.clusters.push_back ({ static_cast<int> (ambiguous.notes.size()), count });
+                for (int k = 0; k < count; ++k)
+                    ambiguous.notes.push_back ({ 60 + static_cast<int> (random() % 5), 1 });
+            }
+
+            std::vector<uint8_t> flags (ambiguous.notes.size(), 0);
+            DtwFollower<TestReference> randomFollower;
+            randomFollower.reset (0);
+            int previous = 0;
+            for (int i = 0; i < 30; ++i)
+            {
+                const auto result = randomFollower.observe (ambiguous, flags.data(), 60 + static_cast<int> (random() % 6), 1, 0);
+                if (result.noteIndex >= 0)
+                    flags[static_cast<size_t> (result.noteIndex)] = 1;
+                if (randomFollower.getPosition() < previous)
+                    ++backwardMoves;
+                previous = randomFollower.getPosition();
+            }
+        }
+        check (backwardMoves == 0, "dtw: position is monotonic under random input");
+    }
+}
+
+int main()
+{
+    checkDtwFollower();
+    return checks::finish ("DtwFollower");
+}
@@ -0,0 +1,47 @@
+// CTest checks for FollowerLink: publishing rules, stale positions and host loop backs.
+#include "../../Source/FollowerLink.h"
+#include "Check.h"
+#include <cstdint>
+
+using checks::check;
+
+namespace
+{
+    void checkFollowerLink()
+    {
+        const uint64_t stale = 2 * 48000;
+        FollowerLink link;
+        check (link.read (1).cluster < 0, "link: nothing published yet");
+
+        link.publish (0, 1, 5, 48000, stale);
+        link.publish (FollowerLink::kNumGroups + 1, 1, 5, 48000, stale);
+        check (link.read (0).cluster < 0 && link.read (1).cluster < 0, "link: invalid groups are ignored");
+
+        link.publish (1, 7, 5, 48000, stale);
+        auto position = link.read (1);
+        check (position.cluster == 5 && position.referenceTag == 7, "link: first publish stored");
+        check (FollowerLink::elapsed (position.time, 48000 + 640) == 640, "link: elapsed in samples");
+
+        link.publish (1, 7, 3, 48000 + 100, stale);
+        check (link.read (1).cluster == 5, "link: lower cluster does not replace a recent one");
+        link.publish (1, 7, 9, 48000 + 200, stale);
+        check (link.read (1).cluster == 9, "link: further cluster replaces");
+        link.publish (1, 8, 2, 48000 + 300, stale);
+        check (link.read (1).cluster == 2 && link.read (1).referenceTag == 8, "link: another reference replaces");
+        link.publish (1, 8, 1, 48000 + 300 + 3 * stale, stale);
+        check (link.read (1).cluster == 1, "link: stale position is replaced");
+
+        // Host looped back 1 s: the stored position is later than the new match and must go.
+        const uint64_t beforeLoop = 10 * 48000;
+        link.publish (2, 1, 40, beforeLoop, stale);
+        link.publish (2, 1, 12, beforeLoop - 48000, stale);
+        check (link.read (2).cluster == 12, "link: position from before a loop back is replaced");
+        check (FollowerLink::elapsed (link.read (2).time, beforeLoop - 48000) == 0, "link: replacement carries the new time");
+    }
+}
+
+int main()
+{
+    checkFollowerLink();
+    return checks::finish ("FollowerLink");
+}
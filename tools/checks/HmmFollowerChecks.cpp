@@ -0,0 +1,44 @@
+// CTest checks for HmmFollower: in-order following, wrong notes and short back-jumps.
+#include "../../Source/HmmFollower.h"
+#include "Check.h"
+#include "TestReference.h"
+#include <cstdint>
+#include <vector>
+
+using checks::check;
+
+namespace
+{
+    void checkHmmFollower()
+    {
+        const auto reference = makeScale (40);
+        std::vector<uint8_t> matched (reference.notes.size(), 0);
+        HmmFollower<TestReference> follower;
+        follower.reset (0);
+
+        bool followed = true;
+        for (int i = 0; i < 20; ++i)
+        {
+            const auto result = follower.observe (reference, matched.data(), 40 + i, 1, 0);
+            followed = followed && result.clusterIndex == i && result.noteIndex == i;
+            if (result.noteIndex >= 0)
+                matched[static_cast<size_t> (result.noteIndex)] = 1;
+        }
+        check (followed && follower.getPosition() == 19, "hmm: follows a scale played in order");
+
+        // A wrong note matches nothing.
+        const auto wrong = follower.observe (reference, matched.data(), 100, 1, 0);
+        check (wrong.clusterIndex < 0 && wrong.noteIndex < 0, "hmm: wrong note matches nothing");
+
+        // Restarting a phrase a few clusters back jumps back to it.
+        for (int i = 14; i < 18; ++i)
+            follower.observe (reference, matched.data(), 40 + i, 1, 0);
+        check (follower.getPosition() == 17, "hmm: short back-jump is followed");
+    }
+}
+
+int main()
+{
+    checkHmmFollower();
+    return checks::finish ("HmmFollower");
+}
@@ -0,0 +1,108 @@
+// CTest checks for PitchNgramIndex: transposed hits, nearest-first order, repetitive material.
+#include "../../Source/PitchNgramIndex.h"
+#include "Check.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using checks::check;
+
+namespace
+{
+    void checkPitchNgramIndex()
+    {
+        // A motif in the middle of otherwise unrelated pitches, then again an octave up near the end.
+        std::vector<int> pitches { 60, 62, 64, 65, 67, 69, 71, 72, 55, 59, 62, 50, 52, 53, 55, 57 };
+        const std::vector<int> motif { 55, 59, 62, 50 };
+        for (int i = 0; i < 20; ++i)
+            pitches.push_back (70 + (i * 5) % 11);
+        for (const int pitch : motif)
+            pitches.push_back (pitch + 12);
+
+        PitchNgramIndex index;
+        check (index.isEmpty(), "ngram: empty before build");
+        index.build (pitches);
+        check (! index.isEmpty(), "ngram: built");
+
+        // The motif ends at cluster 11 and at the last cluster; transposition does not matter.
+        const int lastCluster = static_cast<int> (pitches.size()) - 1;
+        const int played[] = { 57, 61, 64, 52 };
+        int matches[4] = {};
+        int count = index.find (played, 10, matches, 4);
+        check (count == 2 && matches[0] == 11 && matches[1] == lastCluster, "ngram: transposed motif found, nearest first");
+
+        count = index.find (played, lastCluster, matches, 1);
+        check (count == 1 && matches[0] == lastCluster, "ngram: single match is the nearest");
+
+        const int unknown[] = { 60, 61, 60, 61 };
+        check (index.find (unknown, 0, matches, 4) == 0, "ngram: unknown intervals find nothing");
+    }
+
+    // A piece that is one motif over and over: lookups still return the repeats nearest the
+    // cursor, in order, the same as checking every cluster would.
+    void checkRepetitiveMaterial()
+    {
+        std::vector<int> pitches;
+        for (int i = 0; i < 4000; ++i)
+            pitches.push_back (60 + (i % 3) * 2);
+
+        PitchNgramIndex index;
+        index.build (pitches);
+
+        const int played[] = { 60, 62, 64, 60 };
+        int matches[8] = {};
+        const int count = index.find (played, 2000, matches, 8);
+        const int expected[] = { 2001, 1998, 2004, 1995, 2007, 1992, 2010, 1989 };
+        bool nearest = count == 8;
+        for (int i = 0; i < count && nearest; ++i)
+            nearest = matches[i] == expected[i];
+        check (nearest, "ngram: repeated motif returns the repeats nearest the cursor");
+
+        // Random material from few pitches against a full scan, ties going to the earlier cluster.
+        std::mt19937 random (5);
+        bool agrees = true;
+        for (int round = 0; round < 200 && agrees; ++round)
+        {
+            std::vector<int> piece (8 + random() % 400);
+            for (auto& pitch : piece)
+                pitch = 60 + static_cast<int> (random() % 4);
+
+            PitchNgramIndex pieceIndex;
+            pieceIndex.build (piece);
+            const int total = static_cast<int> (piece.size());
+            const int start = static_cast<int> (random() % static_cast<uint32_t> (total - PitchNgramIndex::kLength + 1));
+            const int near = static_cast<int> (random() % static_cast<uint32_t> (total));
+
+            std::vector<int> all;
+            for (int end = PitchNgramIndex::kLength - 1; end < total; ++end)
+            {
+                bool same = true;
+                for (int k = 1; k < PitchNgramIndex::kLength; ++k)
+                {
+                    const int gram = end - PitchNgramIndex::kLength + 1;
+                    same = same && piece[static_cast<size_t> (gram + k)] - piece[static_cast<size_t> (gram + k - 1)]
+                                       == piece[static_cast<size_t> (start + k)] - piece[static_cast<size_t> (start + k - 1)];
+                }
+                if (same)
+                    all.push_back (end);
+            }
+            std::stable_sort (all.begin(), all.end(), [near] (int a, int b) { return std::abs (a - near) < std::abs (b - near); });
+
+            int found[8] = {};
+            const int foundCount = pieceIndex.find (piece.data() + start, near, found, 8);
+            agrees = foundCount == std::min (8, static_cast<int> (all.size()));
+            for (int i = 0; i < foundCount && agrees; ++i)
+                agrees = found[i] == all[static_cast<size_t> (i)];
+        }
+        check (agrees, "ngram: lookups agree with a full scan");
+    }
+}
+
+int main()
+{
+    checkPitchNgramIndex();
+    checkRepetitiveMaterial();
+    return checks::finish ("PitchNgramIndex");
+}
@@ -0,0 +1,79 @@
+// CTest checks for RealtimeArena: layout and alignment, binding, reuse and release.
+#include "../../Source/RealtimeArena.h"
+#include "Check.h"
+#include <cstdint>
+
+using checks::check;
+
+namespace
+{
+    struct Event
+    {
+        uint64_t sample = 0;
+        int value = 7;
+    };
+
+    void checkLayoutAndBinding()
+    {
+        RealtimeArena arena;
+        arena.beginLayout();
+        const auto bytesSlot = arena.add<uint8_t> (3);
+        const auto eventSlot = arena.add<Event> (4);
+        const auto emptySlot = arena.add<int> (-1);
+        check (eventSlot.offset % alignof (Event) == 0, "arena: slots are aligned for their type");
+        check (emptySlot.count == 0, "arena: negative counts lay out nothing");
+
+        // Nothing to bind to before the storage exists.
+        check (arena.bind (eventSlot).isEmpty(), "arena: bind before allocate is empty");
+
+        arena.allocate();
+        check (arena.getAllocatedBytes() == eventSlot.offset + 4 * sizeof (Event), "arena: allocation covers the layout");
+
+        auto bytes = arena.bind (bytesSlot);
+        auto events = arena.bind (eventSlot);
+        check (bytes.capacity() == 3 && events.capacity() == 4 && arena.bind (emptySlot).isEmpty(), "arena: views have the slot counts");
+        check (reinterpret_cast<const uint8_t*> (events.data()) >= bytes.data() + bytes.capacity(), "arena: slots do not overlap");
+
+        bool initialised = bytes[0] == 0 && bytes[2] == 0;
+        for (int i = 0; i < events.capacity(); ++i)
+            initialised = initialised && events[static_cast<size_t> (i)].sample == 0 && events[static_cast<size_t> (i)].value == 7;
+        check (initialised, "arena: bind value-initialises the elements");
+
+        // Binding again resets what the previous view wrote.
+        events[1].value = 3;
+        check (arena.bind (eventSlot)[1].value == 7, "arena: rebinding re-initialises");
+    }
+
+    void checkReuseAndRelease()
+    {
+        RealtimeArena arena;
+        arena.beginLayout();
+        const auto slot = arena.add<uint64_t> (512);
+        arena.allocate();
+        const auto* first = arena.bind (slot).data();
+
+        // The same layout keeps the storage; a different size replaces it.
+        arena.beginLayout();
+        const auto sameSlot = arena.add<uint64_t> (512);
+        arena.allocate();
+        check (arena.bind (sameSlot).data() == first, "arena: unchanged layout is not reallocated");
+
+        arena.beginLayout();
+        const auto biggerSlot = arena.add<uint64_t> (1024);
+        arena.allocate();
+        check (arena.getAllocatedBytes() == 1024 * sizeof (uint64_t) && arena.bind (biggerSlot).capacity() == 1024,
+               "arena: changed layout is reallocated");
+        check (! arena.prefault (false), "arena: prefault without locking reports unlocked");
+
+        arena.release();
+        check (arena.getAllocatedBytes() == 0 && arena.bind (biggerSlot).isEmpty(), "arena: release frees the storage");
+        check (! arena.prefault (false), "arena: prefault of released storage does nothing");
+    }
+}
+
+int main()
+{
+    checkLayoutAndBinding();
+    checkReuseAndRelease();
+    return checks::finish ("RealtimeArena");
+}
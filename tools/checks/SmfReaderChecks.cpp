@@ -0,0 +1,176 @@
+// CTest checks for SmfReader: header validation, decoding, and malformed, truncated or corrupted files.
+#include "../../Source/SmfReader.h"
+#include "Check.h"
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using checks::check;
+
+namespace
+{
+    void appendVariableLength (std::vector<uint8_t>& bytes, uint32_t value)
+    {
+        uint8_t buffer[4];
+        int count = 0;
+        do
+        {
+            buffer[count++] = static_cast<uint8_t> (value & 0x7f);
+            value >>= 7;
+        } while (value != 0 && count < 4);
+
+        while (count > 0)
+        {
+            --count;
+            bytes.push_back (static_cast<uint8_t> (buffer[count] | (count > 0 ? 0x80 : 0)));
+        }
+    }
+
+    void appendBigEndian (std::vector<uint8_t>& bytes, uint32_t value, int count)
+    {
+        for (int i = count - 1; i >= 0; --i)
+            bytes.push_back (static_cast<uint8_t> (value >> (8 * i)));
+    }
+
+    // Format 0 file, 96 ticks per quarter, wrapping one track of raw events.
+    std::vector<uint8_t> makeSmf (const std::vector<uint8_t>& trackEvents, uint32_t declaredTrackLength)
+    {
+        std::vector<uint8_t> bytes { 'M', 'T', 'h', 'd' };
+        appendBigEndian (bytes, 6, 4);
+        appendBigEndian (bytes, 0, 2);
+        appendBigEndian (bytes, 1, 2);
+        appendBigEndian (bytes, 96, 2);
+        bytes.insert (bytes.end(), { 'M', 'T', 'r', 'k' });
+        appendBigEndian (bytes, declaredTrackLength, 4);
+        bytes.insert (bytes.end(), trackEvents.begin(), trackEvents.end());
+        return bytes;
+    }
+
+    std::vector<uint8_t> makeSmf (const std::vector<uint8_t>& trackEvents)
+    {
+        return makeSmf (trackEvents, static_cast<uint32_t> (trackEvents.size()));
+    }
+
+    // 60 bpm tempo, then C4 for a quarter, E4 for a quarter via running status and a
+    // velocity-0 note-off, then end of track.
+    std::vector<uint8_t> makeTwoNoteTrack()
+    {
+        std::vector<uint8_t> events;
+        const auto event = [&events] (uint32_t delta, std::initializer_list<uint8_t> data)
+        {
+            appendVariableLength (events, delta);
+            events.insert (events.end(), data);
+        };
+
+        event (0, { 0xff, 0x51, 0x03, 0x0f, 0x42, 0x40 });
+        event (0, { 0x90, 60, 100 });
+        event (96, { 0x80, 60, 40 });
+        event (0, { 0x90, 64, 90 });
+        event (96, { 64, 0 });
+        event (0, { 0xff, 0x2f, 0x00 });
+        return events;
+    }
+
+    void checkSmfReader()
+    {
+        SmfReader reader;
+        check (! reader.open (nullptr, 0), "smf: null data is rejected");
+
+        const uint8_t tooShort[] = { 'M', 'T', 'h', 'd', 0, 0 };
+        check (! reader.open (tooShort, sizeof (tooShort)), "smf: short header is rejected");
+
+        auto badMagic = makeSmf (makeTwoNoteTrack());
+        badMagic[0] = 'X';
+        check (! reader.open (badMagic.data(), badMagic.size()), "smf: wrong magic is rejected");
+
+        auto zeroDivision = makeSmf (makeTwoNoteTrack());
+        zeroDivision[12] = 0;
+        zeroDivision[13] = 0;
+        check (! reader.open (zeroDivision.data(), zeroDivision.size()), "smf: zero time division is rejected");
+
+        auto hugeHeader = makeSmf (makeTwoNoteTrack());
+        hugeHeader[4] = 0x7f;
+        check (! reader.open (hugeHeader.data(), hugeHeader.size()), "smf: header longer than the file is rejected");
+
+        const auto valid = makeSmf (makeTwoNoteTrack());
+        check (reader.open (valid.data(), valid.size()), "smf: valid file opens");
+        reader.decodeAllTracks();
+        const auto notes = reader.mergeNotes();
+        check (notes.size() == 2, "smf: both notes are decoded");
+        if (notes.size() == 2)
+        {
+            check (notes[0].noteNumber == 60 && notes[0].onTick == 0 && notes[0].offTick == 96, "smf: first note span");
+            check (notes[0].onVelocity == 100 && notes[0].offVelocity == 40, "smf: first note velocities");
+            check (notes[1].noteNumber == 64 && notes[1].onTick == 96 && notes[1].offTick == 192, "smf: running status note-off");
+        }
+
+        const auto tempos = reader.mergeTempos();
+        check (tempos.size() == 1 && tempos[0].microsPerQuarter == 1000000, "smf: tempo event");
+        const SmfReader::TempoMap tempoMap (tempos, reader.getTimeFormat());
+        check (std::abs (tempoMap.toSeconds (192) - 2.0) < 1.0e-9, "smf: ticks to seconds at 60 bpm");
+
+        // Chunk length past the end of the file: the chunk is clipped, not read past.
+        auto events = makeTwoNoteTrack();
+        const auto overlong = makeSmf (events, static_cast<uint32_t> (events.size()) + 1000);
+        check (reader.open (overlong.data(), overlong.size()), "smf: overlong chunk length still opens");
+        check (reader.getNumTracks() == 1 && reader.getTrackBytes (0) == events.size(), "smf: overlong chunk is clipped");
+
+        // A data byte before any status byte ends the track.
+        const auto noStatusFile = makeSmf ({ 0x00, 0x40, 0x00, 0x00, 0x90, 60, 100, 0x60, 0x80, 60, 0 });
+        reader.open (noStatusFile.data(), noStatusFile.size());
+        reader.decodeAllTracks();
+        check (reader.mergeNotes().empty(), "smf: data byte without status ends the track");
+
+        // A delta time that never terminates ends the track; notes before it are kept.
+        const auto badDeltaFile = makeSmf ({ 0x00, 0x90, 60, 100, 0x60, 0x80, 60, 0, 0xff, 0xff, 0xff, 0xff, 0x90, 62, 100 });
+        reader.open (badDeltaFile.data(), badDeltaFile.size());
+        reader.decodeAllTracks();
+        check (reader.mergeNotes().size() == 1, "smf: malformed delta keeps the notes before it");
+
+        // Meta event claiming more bytes than remain ends the track.
+        std::vector<uint8_t> badMeta { 0x00, 0x90, 60, 100, 0x60, 0x80, 60, 0, 0x00, 0xff, 0x03, 0x7f, 'a' };
+        const auto badMetaFile = makeSmf (badMeta);
+        reader.open (badMetaFile.data(), badMetaFile.size());
+        reader.decodeAllTracks();
+        check (reader.mergeNotes().size() == 1 && reader.getTracks()[0].name.empty(), "smf: overlong meta event is not read");
+
+        // Every truncation of a valid file: no crash, and only complete notes come out.
+        bool truncationsOk = true;
+        for (size_t length = 0; length <= valid.size(); ++length)
+        {
+            if (! reader.open (valid.data(), length))
+                continue;
+            reader.decodeAllTracks();
+            for (const auto& note : reader.mergeNotes())
+                truncationsOk = truncationsOk && note.offTick >= note.onTick;
+            truncationsOk = truncationsOk && reader.mergeNotes().size() <= 2;
+        }
+        check (truncationsOk, "smf: truncated files decode only complete notes");
+
+        // Random corruption of the track bytes must stay inside the buffer (run under a sanitizer).
+        std::mt19937 random (7);
+        bool corruptionOk = true;
+        for (int round = 0; round < 2000; ++round)
+        {
+            auto corrupted = valid;
+            for (int i = 0; i < 4; ++i)
+                corrupted[14 + random() % (corrupted.size() - 14)] = static_cast<uint8_t> (random());
+            if (! reader.open (corrupted.data(), corrupted.size()))
+                continue;
+            reader.decodeAllTracks();
+            for (const auto& note : reader.mergeNotes())
+                corruptionOk = corruptionOk && note.offTick >= note.onTick && note.channel >= 1 && note.channel <= 16;
+        }
+        check (corruptionOk, "smf: corrupted files decode consistent notes");
+    }
+
+    //==============================================================================
+    //==============================================================================
+}
+
+int main()
+{
+    checkSmfReader();
+    return checks::finish ("SmfReader");
+}
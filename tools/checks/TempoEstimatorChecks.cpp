@@ -0,0 +1,50 @@
+// CTest checks for TempoEstimator: convergence, shrinking spread and outlier gating.
+#include "../../Source/TempoEstimator.h"
+#include "Check.h"
+#include <cmath>
+#include <random>
+
+using checks::check;
+
+namespace
+{
+    void checkTempoEstimator()
+    {
+        // The user plays 25% slower than the reference, starting 2 s in, with +-10 ms of jitter.
+        TempoEstimator estimator;
+        estimator.reset();
+        std::mt19937 random (3);
+        std::uniform_real_distribution<double> jitter (-0.01, 0.01);
+
+        double firstSpread = -1.0;
+        for (int i = 0; i < 60; ++i)
+        {
+            const double referenceTime = 0.5 * i;
+            estimator.observe (referenceTime, 2.0 + 1.25 * referenceTime + jitter (random));
+            if (i == 3)
+                firstSpread = estimator.getSpread (referenceTime + 0.5);
+        }
+
+        check (estimator.isPrimed(), "tempo: primed after enough notes");
+        check (std::abs (estimator.getTempoRatio() - 1.25) < 0.02, "tempo: ratio converges");
+        check (std::abs (estimator.predict (30.0) - (2.0 + 1.25 * 30.0)) < 0.03, "tempo: prediction converges");
+        check (estimator.getSpread (30.0) < firstSpread, "tempo: spread shrinks as notes arrive");
+
+        // One outlier is gated out; kMaxRejects in a row restart at the new position.
+        const double ratio = estimator.getTempoRatio();
+        estimator.observe (30.0, 100.0);
+        check (estimator.getTempoRatio() == ratio && estimator.isPrimed(), "tempo: single outlier is rejected");
+        for (int i = 1; i < TempoEstimator::kMaxRejects; ++i)
+            estimator.observe (30.0 + 0.5 * i, 100.0 + 0.5 * i);
+        check (estimator.getObservationCount() == 1 && std::abs (estimator.predict (31.0) - 101.0) < 1.0e-9,
+               "tempo: repeated outliers restart the filter");
+    }
+
+    //==============================================================================
+}
+
+int main()
+{
+    checkTempoEstimator();
+    return checks::finish ("TempoEstimator");
+}
@@ -0,0 +1,76 @@
+// CTest checks for TempoTracker: anchoring, ratio convergence and clamping, ignored inputs.
+#include "../../Source/TempoTracker.h"
+#include "Check.h"
+#include <cmath>
+
+using checks::check;
+
+namespace
+{
+    void checkAnchoring()
+    {
+        TempoTracker tracker;
+        tracker.reset();
+        check (! tracker.isPrimed() && tracker.getTempoRatio() == 1.0, "tracker: reset is unprimed at ratio 1");
+
+        tracker.observe (10.0, 12.5);
+        check (tracker.isPrimed() && tracker.getObservationCount() == 1, "tracker: first note primes it");
+        check (std::abs (tracker.predict (14.0) - 16.5) < 1.0e-12, "tracker: first note anchors at ratio 1");
+
+        // A reference time before the anchor is ignored.
+        tracker.observe (9.0, 20.0);
+        check (tracker.getObservationCount() == 1 && std::abs (tracker.predict (14.0) - 16.5) < 1.0e-12,
+               "tracker: earlier reference time is ignored");
+    }
+
+    void checkConvergence()
+    {
+        // The user plays 25% slower than the reference, starting 2 units in.
+        TempoTracker tracker;
+        tracker.reset();
+        for (int i = 0; i < 200; ++i)
+        {
+            const double referenceTime = 0.5 * i;
+            tracker.observe (referenceTime, 2.0 + 1.25 * referenceTime);
+        }
+
+        check (std::abs (tracker.getTempoRatio() - 1.25) < 0.01, "tracker: ratio converges");
+        check (std::abs (tracker.predict (100.0) - (2.0 + 1.25 * 100.0)) < 0.1, "tracker: prediction converges");
+
+        // Playing far slower than maxRatio allows leaves the ratio at the limit.
+        TempoTracker slow;
+        slow.reset();
+        for (int i = 0; i < 200; ++i)
+            slow.observe (0.5 * i, 5.0 * i);
+        check (slow.getTempoRatio() == TempoTracker::Settings().maxRatio, "tracker: ratio is clamped");
+    }
+
+    void checkChordsAndSlack()
+    {
+        TempoTracker::Settings settings;
+        settings.minPeriodSpan = 0.05;
+        TempoTracker tracker;
+        tracker.setSettings (settings);
+        tracker.reset();
+
+        // Chord notes a few ms apart only correct phase, however late they are.
+        tracker.observe (1.0, 1.0);
+        tracker.observe (1.01, 1.2);
+        check (tracker.getTempoRatio() == 1.0, "tracker: short spans leave the ratio alone");
+        check (tracker.getLateSpread() > 0.0, "tracker: late notes raise the spread");
+
+        const double slack = tracker.getPredictiveSlack (1.0, 10.0);
+        check (std::abs (slack - settings.slackSpreadScale * tracker.getLateSpread()) < 1.0e-12,
+               "tracker: predictive slack scales the spread");
+        check (tracker.getPredictiveSlack (1.0, 0.001) == 0.001, "tracker: predictive slack is capped");
+        check (tracker.getPredictiveSlack (0.0, 10.0) == 0.0, "tracker: no correction needs no slack");
+    }
+}
+
+int main()
+{
+    checkAnchoring();
+    checkConvergence();
+    checkChordsAndSlack();
+    return checks::finish ("TempoTracker");
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+
+// Same shape the followers expect from the plugin's reference data.
+struct TestNote
+{
+    int noteNumber = 0;
+    int channel = 1;
+};
+
+struct TestCluster
+{
+    int startIndex = 0;
+    int noteCount = 0;
+};
+
+struct TestReference
+{
+    std::vector<TestNote> notes;
+    std::vector<TestCluster> clusters;
+};
+
+// One note per cluster, pitch 40 + cluster, so every cluster is told apart by pitch.
+inline TestReference makeScale (int clusterCount)
+{
+    TestReference reference;
+    for (int i = 0; i < clusterCount; ++i)
+    {
+        reference.clusters.push_back ({ i, 1 });
+        reference.notes.push_back ({ 40 + i, 1 });
+    }
+    return reference;
+}